@@ -0,0 +1,49 @@
+#ifndef SYNTHETIC_SCENE_H
+#define SYNTHETIC_SCENE_H
+
+#include "../headers/Mesh.h"
+
+#include <cmath>
+
+// Shared inputs for the microbenchmarks, generated so every run measures the same data without asset files
+
+// UV sphere of radius 1 with normals and UVs, 2 * rings * segments triangles
+inline Mesh syntheticSphere(int rings, int segments) {
+	const float pi = 3.14159265f;
+	Mesh mesh;
+	for (int r = 0; r <= rings; r++) {
+		float theta = pi * r / rings;
+		for (int s = 0; s <= segments; s++) {
+			float phi = 2.0f * pi * s / segments;
+			float n[3] = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+			float vertex[MESH_VERTEX_LEN] = { n[0], n[1], n[2], n[0], n[1], n[2], (float)s / segments, (float)r / rings };
+			mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + MESH_VERTEX_LEN);
+		}
+	}
+	for (int r = 0; r < rings; r++) {
+		for (int s = 0; s < segments; s++) {
+			unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+			unsigned int quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+	mesh.computeBounds();
+	return mesh;
+}
+
+// Column major perspective * view for a camera at (0, 0, distance) looking down -z, as glm::perspective and
+// glm::lookAt would build it
+inline void syntheticViewProjection(float distance, float* m) {
+	const float fovy = 45.0f * 3.14159265f / 180.0f, aspect = 16.0f / 9.0f, nearPlane = 0.1f, farPlane = 100.0f;
+	float f = 1.0f / std::tan(fovy * 0.5f);
+	for (int i = 0; i < 16; i++)
+		m[i] = 0.0f;
+	m[0] = f / aspect;
+	m[5] = f;
+	m[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+	m[11] = -1.0f;
+	m[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane) + m[10] * -distance;
+	m[15] = distance;
+}
+
+#endif
@@ -0,0 +1,68 @@
+// Meshlet culling: frustum and back face cone tests over the meshlets of a sphere, with the SIMD path Meshlet.h
+// was compiled with (AVX needs -DLEARNOPENGL_NATIVE=ON) against the scalar reference.
+//
+// Usage: cull_bench [--benchmark_filter=regex]
+
+#include "../headers/Meshlet.h"
+#include "SyntheticScene.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+struct CullScene
+{
+	MeshletMesh meshlets;
+	MeshletCullView view;
+
+	CullScene(int rings, float distance)
+	{
+		Mesh mesh = syntheticSphere(rings, rings * 2);
+		meshlets = buildMeshlets(mesh);
+		float viewProjection[16];
+		syntheticViewProjection(distance, viewProjection);
+		meshletFrustumPlanes(viewProjection, view);
+		view.camera[0] = 0.0f;
+		view.camera[1] = 0.0f;
+		view.camera[2] = distance;
+	}
+};
+
+// range(0): sphere rings, range(1): camera distance in tenths (under 25 the sphere fills more than the screen)
+static void BM_CullMeshlets(benchmark::State& state)
+{
+	CullScene scene((int)state.range(0), state.range(1) / 10.0f);
+	std::vector<uint32_t> visible;
+	visible.reserve(scene.meshlets.bounds.size());
+	for (auto _ : state)
+	{
+		visible.clear();
+		benchmark::DoNotOptimize(cullMeshlets(scene.meshlets.bounds, scene.view, visible));
+	}
+	state.SetItemsProcessed(state.iterations() * scene.meshlets.bounds.size());
+	state.counters["meshlets"] = (double)scene.meshlets.bounds.size();
+	state.counters["visible"] = (double)visible.size();
+}
+
+static void BM_CullMeshletsScalar(benchmark::State& state)
+{
+	CullScene scene((int)state.range(0), state.range(1) / 10.0f);
+	std::vector<uint32_t> visible;
+	visible.reserve(scene.meshlets.bounds.size());
+	for (auto _ : state)
+	{
+		visible.clear();
+		for (size_t i = 0; i < scene.meshlets.bounds.size(); i++)
+		{
+			if (meshletVisible(scene.meshlets.bounds, i, scene.view))
+				visible.push_back((uint32_t)i);
+		}
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * scene.meshlets.bounds.size());
+	state.counters["meshlets"] = (double)scene.meshlets.bounds.size();
+	state.counters["visible"] = (double)visible.size();
+}
+
+BENCHMARK(BM_CullMeshlets)->Args({ 32, 30 })->Args({ 128, 30 })->Args({ 512, 30 })->Args({ 512, 12 });
+BENCHMARK(BM_CullMeshletsScalar)->Args({ 32, 30 })->Args({ 128, 30 })->Args({ 512, 30 })->Args({ 512, 12 });
@@ -0,0 +1,127 @@
+// Decoding paths hit at load time: image decode (stb_image), block compressed texture decode, OBJ text parsing
+// and unpacking compressed vertices.
+//
+// Usage: decode_bench [--benchmark_filter=regex], run from the repository root so rsc/imgs/image.png is found
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../headers/stb_image.h"
+#include "../headers/BlockCompress.h"
+#include "../headers/ObjLoader.h"
+#include "../headers/VertexCompression.h"
+#include "SyntheticScene.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static void BM_DecodeImage(benchmark::State& state)
+{
+	std::vector<unsigned char> file;
+	if (FILE* in = fopen("rsc/imgs/image.png", "rb"))
+	{
+		unsigned char chunk[65536];
+		size_t read;
+		while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0)
+			file.insert(file.end(), chunk, chunk + read);
+		fclose(in);
+	}
+	if (file.empty())
+	{
+		state.SkipWithError("rsc/imgs/image.png not found, run from the repository root");
+		return;
+	}
+	int width = 0, height = 0, channels = 0;
+	for (auto _ : state)
+	{
+		unsigned char* pixels = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 0);
+		benchmark::DoNotOptimize(pixels);
+		stbi_image_free(pixels);
+	}
+	state.SetItemsProcessed(state.iterations() * width * height);
+	state.SetBytesProcessed(state.iterations() * file.size());
+}
+
+// range(0): BCFormat, on a 512 x 512 RGBA image of gradients and noise
+static void BM_BCDecompress(benchmark::State& state)
+{
+	const int size = 512;
+	BCFormat format = (BCFormat)state.range(0);
+	std::vector<unsigned char> pixels(size * size * 4);
+	uint32_t noise = 12345;
+	for (int i = 0; i < size * size; i++)
+	{
+		noise = noise * 1664525u + 1013904223u;
+		pixels[i * 4 + 0] = (unsigned char)(i % size / 2);
+		pixels[i * 4 + 1] = (unsigned char)(i / size / 2);
+		pixels[i * 4 + 2] = (unsigned char)(noise >> 24);
+		pixels[i * 4 + 3] = (unsigned char)(255 - (i % size) / 4);
+	}
+	std::vector<unsigned char> blocks(bcCompressedSize(format, size, size));
+	bcCompress(pixels.data(), size, size, 4, format, BC_QUALITY_FAST, blocks.data());
+	std::vector<unsigned char> decoded(size * size * 4);
+	for (auto _ : state)
+	{
+		bcDecompress(blocks.data(), size, size, format, decoded.data());
+		benchmark::DoNotOptimize(decoded.data());
+	}
+	state.SetItemsProcessed(state.iterations() * size * size);
+}
+
+// The OBJ text of a 256 x 512 sphere (262K triangles), parsed on one thread
+static void BM_ObjParse(benchmark::State& state)
+{
+	Mesh mesh = syntheticSphere(256, 512);
+	std::string text;
+	char line[128];
+	for (size_t v = 0; v < mesh.vertices.size(); v += MESH_VERTEX_LEN)
+	{
+		const float* p = &mesh.vertices[v];
+		snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvn %.6f %.6f %.6f\nvt %.6f %.6f\n", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]);
+		text += line;
+	}
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		unsigned int a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+		snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+		text += line;
+	}
+	ObjChunk chunk;
+	for (auto _ : state)
+	{
+		chunk.positions.clear();
+		chunk.uvs.clear();
+		chunk.normals.clear();
+		chunk.corners.clear();
+		objParseChunk(text.data(), text.data() + text.size(), chunk);
+		benchmark::DoNotOptimize(chunk.corners.data());
+	}
+	state.SetBytesProcessed(state.iterations() * text.size());
+	state.SetItemsProcessed(state.iterations() * mesh.triangleCount());
+}
+
+// Unpack every vertex of a 16 byte encoded mesh (unorm16 positions, octahedral normals, half UVs)
+static void BM_DecodeVertices(benchmark::State& state)
+{
+	Mesh mesh = syntheticSphere(256, 512);
+	std::vector<unsigned char> packed;
+	VertexLayout layout = encodeVertices(mesh, VertexFormat(), packed);
+	size_t count = mesh.vertexCount();
+	std::vector<float> decoded(count * MESH_VERTEX_LEN);
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float* out = &decoded[i * MESH_VERTEX_LEN];
+			decodeVertex(layout, &packed[i * layout.stride], out, out + 3, out + 6);
+		}
+		benchmark::DoNotOptimize(decoded.data());
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(BM_DecodeImage)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BCDecompress)->Arg(BC1)->Arg(BC3)->Arg(BC7)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ObjParse)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DecodeVertices)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,71 @@
+// Per draw matrix work of the render loop: the model matrix and its normal matrix (transpose of the inverse), as
+// main.cpp computes them for every cube, against cheaper ways to get the same normal matrix.
+//
+// Usage: transform_bench [--benchmark_filter=regex]
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+static std::vector<glm::vec3> drawPositions(size_t count) {
+	std::vector<glm::vec3> positions(count);
+	for (size_t i = 0; i < count; i++)
+		positions[i] = glm::vec3((float)(i % 32) * 2.0f, (float)(i / 32 % 32) * 2.0f, -(float)(i / 1024) * 2.0f);
+	return positions;
+}
+
+// What the render loop does: inverse of the full 4x4
+static void BM_NormalMatrixInverse4(benchmark::State& state) {
+	std::vector<glm::vec3> positions = drawPositions((size_t)state.range(0));
+	glm::mat4 model;
+	glm::mat3 tiModel;
+	for (auto _ : state) {
+		for (const glm::vec3& position : positions) {
+			model = glm::translate(glm::mat4(1.0f), position);
+			tiModel = glm::transpose(glm::inverse(model));
+			benchmark::DoNotOptimize(glm::value_ptr(model));
+			benchmark::DoNotOptimize(glm::value_ptr(tiModel));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * positions.size());
+}
+
+// Translation does not reach the upper 3x3, so inverting that alone gives the same normal matrix
+static void BM_NormalMatrixInverse3(benchmark::State& state) {
+	std::vector<glm::vec3> positions = drawPositions((size_t)state.range(0));
+	glm::mat4 model;
+	glm::mat3 tiModel;
+	for (auto _ : state) {
+		for (const glm::vec3& position : positions) {
+			model = glm::translate(glm::mat4(1.0f), position);
+			tiModel = glm::transpose(glm::inverse(glm::mat3(model)));
+			benchmark::DoNotOptimize(glm::value_ptr(model));
+			benchmark::DoNotOptimize(glm::value_ptr(tiModel));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * positions.size());
+}
+
+// Full model * view * projection product per draw, the cost of moving the multiply to the CPU
+static void BM_ModelViewProjection(benchmark::State& state) {
+	std::vector<glm::vec3> positions = drawPositions((size_t)state.range(0));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 viewProjection = projection * view;
+	glm::mat4 mvp;
+	for (auto _ : state) {
+		for (const glm::vec3& position : positions) {
+			mvp = viewProjection * glm::translate(glm::mat4(1.0f), position);
+			benchmark::DoNotOptimize(glm::value_ptr(mvp));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * positions.size());
+}
+
+BENCHMARK(BM_NormalMatrixInverse4)->Arg(10)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_NormalMatrixInverse3)->Arg(10)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_ModelViewProjection)->Arg(10)->Arg(1000)->Arg(10000);
@@ -0,0 +1,122 @@
+// CPU cost of the per frame GL traffic: material table uploads, per draw uniforms and light culling plus upload.
+// Runs on a hidden 3.3 core window, timings include the driver's side of each call but not the GPU's work.
+//
+// Usage: upload_bench [--benchmark_filter=regex]
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../headers/LightManager.h"
+#include "../headers/MaterialRegistry.h"
+#include "../headers/Shader.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+// Created by the first benchmark that needs it and kept current for the rest of the run
+static bool glContext() {
+	static bool ready = false;
+	static bool tried = false;
+	if (tried)
+		return ready;
+	tried = true;
+	if (!glfwInit())
+		return false;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "upload_bench", NULL, NULL);
+	if (!window)
+		return false;
+	glfwMakeContextCurrent(window);
+	ready = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress) != 0;
+	return ready;
+}
+
+// range(0): materials changed per frame, all of them are re-uploaded as one dirty span
+static void BM_MaterialUpload(benchmark::State& state) {
+	if (!glContext()) {
+		state.SkipWithError("no OpenGL 3.3 context");
+		return;
+	}
+	MaterialRegistry materials;
+	materials.init();
+	int count = (int)state.range(0);
+	for (int i = 0; i < count; i++)
+		materials.add("material" + std::to_string(i), { glm::vec3(0.1f), glm::vec3((float)i / count), glm::vec3(0.5f), 32.0f });
+	materials.upload();
+	size_t bytes = 0;
+	for (auto _ : state) {
+		for (int i = 0; i < count; i++)
+			materials.set(i, { glm::vec3(0.1f), glm::vec3(0.5f), glm::vec3((float)i / count), 16.0f });
+		bytes += materials.upload();
+	}
+	glFinish();
+	state.SetBytesProcessed(bytes);
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// range(0): draws per frame, each setting its model and normal matrices the way the render loop does
+static void BM_PerDrawUniforms(benchmark::State& state) {
+	if (!glContext()) {
+		state.SkipWithError("no OpenGL 3.3 context");
+		return;
+	}
+	Shader shader = Shader::fromSource(
+		"#version 330 core\nlayout (location = 0) in vec3 aPos;\nuniform mat4 model;\nuniform mat3 tiModel;\n"
+		"void main() { gl_Position = model * vec4(tiModel * aPos, 1.0); }\n",
+		"#version 330 core\nout vec4 FragColor;\nvoid main() { FragColor = vec4(1.0); }\n");
+	shader.use();
+	int count = (int)state.range(0);
+	for (auto _ : state) {
+		for (int i = 0; i < count; i++) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 0.0f, 0.0f));
+			glm::mat3 tiModel = glm::transpose(glm::inverse(glm::mat3(model)));
+			shader.setMat4("model", glm::value_ptr(model));
+			shader.setMat3("tiModel", glm::value_ptr(tiModel));
+		}
+	}
+	glFinish();
+	state.SetItemsProcessed(state.iterations() * count);
+	glDeleteProgram(shader.ID);
+}
+
+// range(0): lights in the scene, all moving every frame so each upload sends the whole buffer
+static void BM_LightCullUpload(benchmark::State& state) {
+	if (!glContext()) {
+		state.SkipWithError("no OpenGL 3.3 context");
+		return;
+	}
+	LightManager lights;
+	lights.init();
+	int count = (int)state.range(0);
+	for (int i = 0; i < count; i++) {
+		Light light;
+		light.position = glm::vec3((float)(i % 64) - 32.0f, 1.0f, -(float)(i / 64));
+		light.range = 4.0f;
+		lights.add(light);
+	}
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 3.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 viewProjection = projection * view;
+	float frame = 0.0f;
+	for (auto _ : state) {
+		frame += 0.01f;
+		for (int i = 0; i < count; i++)
+			lights.setPosition(i, lights.position(i) + glm::vec3(0.0f, std::sin(frame + i) * 0.01f, 0.0f));
+		lights.cull(glm::value_ptr(viewProjection));
+		lights.upload(0);
+	}
+	glFinish();
+	state.SetItemsProcessed(state.iterations() * count);
+	state.counters["visible"] = (double)lights.visibleCount();
+}
+
+BENCHMARK(BM_MaterialUpload)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK(BM_PerDrawUniforms)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_LightCullUpload)->Arg(64)->Arg(1024)->Arg(16384);
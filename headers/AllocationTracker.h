@@ -0,0 +1,152 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+// Counts heap allocations made through the global operator new when TRACK_ALLOCATIONS is defined (Debug builds).
+// Define ALLOCATION_TRACKER_IMPLEMENTATION in exactly one source file before including this header, that is where
+// the replacement operators live. Without TRACK_ALLOCATIONS every query returns 0 and nothing is replaced.
+
+#ifdef TRACK_ALLOCATIONS
+#include <atomic>
+
+inline std::atomic<uint64_t>& allocationCounter() {
+	static std::atomic<uint64_t> count(0);
+	return count;
+}
+
+inline std::atomic<uint64_t>& allocationBytes() {
+	static std::atomic<uint64_t> bytes(0);
+	return bytes;
+}
+#endif
+
+inline uint64_t allocationCount() {
+#ifdef TRACK_ALLOCATIONS
+	return allocationCounter().load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+inline uint64_t allocatedBytes() {
+#ifdef TRACK_ALLOCATIONS
+	return allocationBytes().load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+// Brackets a frame of the render loop and reports heap allocations inside it. The first warmupFrames frames
+// are ignored (containers growing to their working size, drivers settling), after that any allocation is
+// reported, and asserted on when assertZero is set.
+class FrameAllocationCheck {
+public:
+	int warmupFrames = 60;
+	bool assertZero = false;
+
+	void beginFrame() {
+		startCount = allocationCount();
+		startBytes = allocatedBytes();
+	}
+
+	// Returns the number of allocations since beginFrame()
+	uint64_t endFrame() {
+		uint64_t count = allocationCount() - startCount;
+		if (frame++ < warmupFrames || count == 0)
+			return count;
+		uint64_t bytes = allocatedBytes() - startBytes;
+		if (reported++ < 10)
+			std::cout << "ERROR::ALLOCATION::FRAME_" << frame << "_ALLOCATED_" << count << "_TIMES_" << bytes << "_BYTES" << std::endl;
+		assert(!assertZero && "Heap allocation in the steady state render loop");
+		return count;
+	}
+
+private:
+	uint64_t startCount = 0;
+	uint64_t startBytes = 0;
+	int frame = 0;
+	int reported = 0;
+};
+
+#if defined(TRACK_ALLOCATIONS) && defined(ALLOCATION_TRACKER_IMPLEMENTATION)
+#include <cstdlib>
+#include <new>
+
+// The array and nothrow forms forward to these by default, the sized deletes are replaced too since sanitizers
+// provide their own
+void* operator new(size_t size) {
+	allocationCounter().fetch_add(1, std::memory_order_relaxed);
+	allocationBytes().fetch_add(size, std::memory_order_relaxed);
+	void* p = malloc(size ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+#ifdef __cpp_aligned_new
+// Over-aligned types (alignas beyond 16, e.g. SIMD blocks) come through here instead
+void* operator new(size_t size, std::align_val_t alignment) {
+	allocationCounter().fetch_add(1, std::memory_order_relaxed);
+	allocationBytes().fetch_add(size, std::memory_order_relaxed);
+	size_t align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+	void* p = _aligned_malloc(size ? size : 1, align);
+#else
+	// aligned_alloc wants the size to be a multiple of the alignment
+	void* p = aligned_alloc(align, (size + align - 1) / align * align + (size ? 0 : align));
+#endif
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept {
+	operator delete(p, alignment);
+}
+
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept {
+	operator delete(p, alignment);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t alignment) noexcept {
+	operator delete(p, alignment);
+}
+#endif
+#endif
+
+#endif
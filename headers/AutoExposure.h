@@ -0,0 +1,215 @@
+#ifndef AUTO_EXPOSURE_H
+#define AUTO_EXPOSURE_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+#include "GpuTimer.h"
+#include "PostProcess.h"
+#include "Shader.h"
+
+#include <cmath>
+#include <cstdio>
+
+const int EXPOSURE_HISTOGRAM_BINS = 256;	// Bin 0 counts black pixels, 1 - 255 span the log luminance range
+const int EXPOSURE_SAMPLE_STEP = 4;			// The histogram reads one pixel in every 4 x 4 block
+const int EXPOSURE_FALLBACK_SIZE = 256;		// Log luminance target the 3.3 path reduces with glGenerateMipmap
+
+// Eye adaptation for the HDR scene. On GL 4.3 one compute dispatch bins the log luminance of a reduced grid of
+// pixels into a histogram (shared memory atomics per work group, one global add per bin), and a second, single
+// group dispatch averages the histogram between two percentiles and moves the exposure towards it. Without compute
+// the scene's log luminance is downsampled with a full mip chain instead. Either way the result is a 1x1 R32F
+// texture the tonemap pass reads on the GPU, nothing is read back.
+class AutoExposure {
+public:
+	float minLogLuminance = -10.0f;		// log2 luminance range the histogram covers
+	float maxLogLuminance = 6.0f;
+	float keyValue = 0.18f;				// The average luminance is exposed to this middle grey
+	float adaptationSpeed = 1.5f;		// Per second, higher adapts faster
+	float lowPercent = 0.5f;			// Histogram share ignored at the dark and bright ends
+	float highPercent = 0.95f;
+
+	~AutoExposure() { release(); }
+
+	void init(const GLExtensions& ext) {
+		release();
+		compute = ext.computeShader;
+		bindImageTexture = ext.bindImageTexture;
+		dispatchCompute = ext.dispatchCompute;
+		memoryBarrier = ext.memoryBarrier;
+
+		float one = 1.0f;
+		glGenTextures(2, exposure);
+		for (int i = 0; i < 2; i++) {
+			glBindTexture(GL_TEXTURE_2D, exposure[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, 1, 1, 0, GL_RED, GL_FLOAT, &one);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+
+		if (compute) {
+			histogramShader = new Shader("shaders/luminance_histogram.cs");
+			adaptShader = new Shader("shaders/exposure_adapt.cs");
+			unsigned int zeros[EXPOSURE_HISTOGRAM_BINS] = {};
+			glGenBuffers(1, &histogram);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogram);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		}
+		else {
+			luminanceShader = new Shader("shaders/fullscreen.vs", "shaders/luminance_log.fs");
+			adaptShader = new Shader("shaders/fullscreen.vs", "shaders/exposure_adapt.fs");
+			glGenTextures(1, &logLuminance);
+			glBindTexture(GL_TEXTURE_2D, logLuminance);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, EXPOSURE_FALLBACK_SIZE, EXPOSURE_FALLBACK_SIZE, 0, GL_RED, GL_FLOAT, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glGenFramebuffers(1, &logLuminanceFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER, logLuminanceFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, logLuminance, 0);
+			glGenFramebuffers(2, exposureFBO);
+			for (int i = 0; i < 2; i++) {
+				glBindFramebuffer(GL_FRAMEBUFFER, exposureFBO[i]);
+				glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, exposure[i], 0);
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glGenVertexArrays(1, &emptyVAO);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		current = 0;
+		timer.init();
+	}
+
+	void release() {
+		for (Shader** shader : { &histogramShader, &adaptShader, &luminanceShader }) {
+			if (*shader)
+				glDeleteProgram((*shader)->ID);
+			delete *shader;
+			*shader = NULL;
+		}
+		if (exposure[0])
+			glDeleteTextures(2, exposure);
+		if (histogram)
+			glDeleteBuffers(1, &histogram);
+		if (logLuminance)
+			glDeleteTextures(1, &logLuminance);
+		if (logLuminanceFBO)
+			glDeleteFramebuffers(1, &logLuminanceFBO);
+		if (exposureFBO[0])
+			glDeleteFramebuffers(2, exposureFBO);
+		if (emptyVAO)
+			glDeleteVertexArrays(1, &emptyVAO);
+		exposure[0] = exposure[1] = exposureFBO[0] = exposureFBO[1] = 0;
+		histogram = logLuminance = logLuminanceFBO = emptyVAO = 0;
+		timer.release();
+	}
+
+	// Measure the bottom left viewWidth x viewHeight of the HDR scene and adapt the exposure over dt seconds.
+	// Leaves the default framebuffer bound.
+	void update(const RenderTarget& hdr, int viewWidth, int viewHeight, float dt) {
+		if (!exposure[0] || viewWidth <= 0 || viewHeight <= 0)
+			return;
+		timer.begin();
+		float logRange = maxLogLuminance - minLogLuminance;
+		float adaptation = 1.0f - std::exp(-dt * adaptationSpeed);
+		glActiveTexture(GL_TEXTURE0);
+		if (compute) {
+			int groupsX = (viewWidth / EXPOSURE_SAMPLE_STEP + 15) / 16;
+			int groupsY = (viewHeight / EXPOSURE_SAMPLE_STEP + 15) / 16;
+			histogramShader->use();
+			histogramShader->setInt("hdr", 0);
+			histogramShader->setInt("sampleStep", EXPOSURE_SAMPLE_STEP);
+			glUniform2i(glGetUniformLocation(histogramShader->ID, "viewSize"), viewWidth, viewHeight);
+			histogramShader->setFloat("minLogLuminance", minLogLuminance);
+			histogramShader->setFloat("inverseLogRange", 1.0f / logRange);
+			glBindTexture(GL_TEXTURE_2D, hdr.texture);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogram);
+			dispatchCompute(groupsX, groupsY, 1);
+			memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+			// One group of EXPOSURE_HISTOGRAM_BINS invocations, which also clears the bins for the next frame
+			adaptShader->use();
+			setAdaptUniforms(logRange, adaptation);
+			bindImageTexture(0, exposure[0], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+			dispatchCompute(1, 1, 1);
+			memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+		else {
+			glDisable(GL_DEPTH_TEST);
+			glBindVertexArray(emptyVAO);
+			glViewport(0, 0, EXPOSURE_FALLBACK_SIZE, EXPOSURE_FALLBACK_SIZE);
+			glBindFramebuffer(GL_FRAMEBUFFER, logLuminanceFBO);
+			luminanceShader->use();
+			luminanceShader->setInt("hdr", 0);
+			luminanceShader->setVec2("sourceUVScale", glm::vec2((float)viewWidth / hdr.desc.width, (float)viewHeight / hdr.desc.height));
+			luminanceShader->setFloat("minLogLuminance", minLogLuminance);
+			luminanceShader->setFloat("maxLogLuminance", maxLogLuminance);
+			glBindTexture(GL_TEXTURE_2D, hdr.texture);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			glBindTexture(GL_TEXTURE_2D, logLuminance);
+			glGenerateMipmap(GL_TEXTURE_2D);	// The 1x1 level is the average log luminance
+
+			// Read last frame's exposure, write the new one to the other texture
+			glViewport(0, 0, 1, 1);
+			glBindFramebuffer(GL_FRAMEBUFFER, exposureFBO[1 - current]);
+			adaptShader->use();
+			adaptShader->setInt("logLuminance", 0);
+			adaptShader->setInt("previous", 1);
+			adaptShader->setFloat("topLevel", std::log2((float)EXPOSURE_FALLBACK_SIZE));
+			setAdaptUniforms(logRange, adaptation);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, exposure[current]);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glActiveTexture(GL_TEXTURE0);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glBindVertexArray(0);
+			glEnable(GL_DEPTH_TEST);
+			current = 1 - current;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		timer.end();
+	}
+
+	// Bind the exposure texture for the tonemap pass
+	void bind(int unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, exposure[current]);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	bool usesCompute() const { return compute; }
+
+	void printReport() const {
+		printf("Auto exposure: %s, %.3f ms GPU on average\n", compute ? "compute histogram" : "mip chain (no compute)", timer.average());
+	}
+
+private:
+	void setAdaptUniforms(float logRange, float adaptation) const {
+		adaptShader->setFloat("minLogLuminance", minLogLuminance);
+		adaptShader->setFloat("logRange", logRange);
+		adaptShader->setFloat("keyValue", keyValue);
+		adaptShader->setFloat("adaptation", adaptation);
+		adaptShader->setFloat("lowPercent", lowPercent);
+		adaptShader->setFloat("highPercent", highPercent);
+	}
+
+	bool compute = false;
+	GLBindImageTextureProc bindImageTexture = NULL;
+	GLDispatchComputeProc dispatchCompute = NULL;
+	GLMemoryBarrierProc memoryBarrier = NULL;
+	Shader* histogramShader = NULL;
+	Shader* adaptShader = NULL;
+	Shader* luminanceShader = NULL;
+	unsigned int exposure[2] = {};		// 1x1 R32F, the 3.3 path ping-pongs between them
+	unsigned int exposureFBO[2] = {};
+	unsigned int histogram = 0;
+	unsigned int logLuminance = 0;
+	unsigned int logLuminanceFBO = 0;
+	unsigned int emptyVAO = 0;
+	int current = 0;
+	GpuTimer timer;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GpuTimer.h"
+#include "Json.h"
+#include "RenderStats.h"
+#include "camera.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One pose on a camera path, yaw and pitch in degrees as in Camera
+struct CameraKey {
+	float time;
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
+// Smooth path through camera keys: cubic Hermite segments with Catmull-Rom tangents, scaled for uneven key spacing.
+// Yaw is interpolated as written, so keys going -90, 0, 90, 180 turn all the way round instead of wrapping.
+class CameraPath {
+public:
+	std::vector<CameraKey> keys;
+
+	// [{ "time": 0, "position": [0, 0, 3], "yaw": -90, "pitch": 0 }, ...] with increasing times
+	bool load(const JsonValue& array) {
+		keys.clear();
+		for (size_t i = 0; i < array.size(); i++) {
+			const JsonValue& key = array[i];
+			const JsonValue& position = key["position"];
+			CameraKey k;
+			k.time = (float)key["time"].asNumber();
+			k.position = glm::vec3((float)position[0].asNumber(), (float)position[1].asNumber(), (float)position[2].asNumber());
+			k.yaw = (float)key["yaw"].asNumber(YAW);
+			k.pitch = (float)key["pitch"].asNumber(PITCH);
+			if (!keys.empty() && k.time <= keys.back().time)
+				return false;
+			keys.push_back(k);
+		}
+		return !keys.empty();
+	}
+
+	float duration() const { return keys.empty() ? 0.0f : keys.back().time - keys.front().time; }
+
+	// Pose at time t from the first key, held at the ends
+	CameraKey sample(float t) const {
+		t += keys.front().time;
+		if (keys.size() == 1 || t <= keys.front().time)
+			return keys.front();
+		if (t >= keys.back().time)
+			return keys.back();
+		size_t i = 0;
+		while (keys[i + 1].time < t)
+			i++;
+		const CameraKey& a = keys[i];
+		const CameraKey& b = keys[i + 1];
+		float span = b.time - a.time;
+		float s = (t - a.time) / span;
+		float s2 = s * s, s3 = s2 * s;
+		float h00 = 2 * s3 - 3 * s2 + 1, h10 = s3 - 2 * s2 + s, h01 = -2 * s3 + 3 * s2, h11 = s3 - s2;
+		glm::vec4 pa(a.position, 0.0f), pb(b.position, 0.0f);
+		glm::vec4 va(a.yaw, a.pitch, 0.0f, 0.0f), vb(b.yaw, b.pitch, 0.0f, 0.0f);
+		CameraKey out;
+		out.time = t;
+		out.position = glm::vec3(h00 * pa + h10 * span * tangent(i, true) + h01 * pb + h11 * span * tangent(i + 1, true));
+		glm::vec4 angles = h00 * va + h10 * span * tangent(i, false) + h01 * vb + h11 * span * tangent(i + 1, false);
+		out.yaw = angles.x;
+		out.pitch = angles.y;
+		return out;
+	}
+
+private:
+	// Per second, position in xyz or yaw / pitch in xy; zero at the path ends so it eases in and out
+	glm::vec4 tangent(size_t i, bool position) const {
+		if (i == 0 || i + 1 >= keys.size())
+			return glm::vec4(0.0f);
+		const CameraKey& prev = keys[i - 1];
+		const CameraKey& next = keys[i + 1];
+		glm::vec4 delta = position ? glm::vec4(next.position - prev.position, 0.0f) : glm::vec4(next.yaw - prev.yaw, next.pitch - prev.pitch, 0.0f, 0.0f);
+		return (1.0f / (next.time - prev.time)) * delta;
+	}
+};
+
+// Reproducible run of the renderer: a description file sets the scene and a camera path, then warmupFrames frames
+// at the start pose are followed by measuredFrames frames stepping along the path by a fixed timestep, so every
+// run renders the same frames whatever the frame rate. Wall, CPU and GPU frame times and the RenderStats counters are
+// recorded for the measured frames and written to JSON as percentiles, to be compared run over run. Wall time is
+// frame start to frame start, so it has one sample fewer, and GPU times that arrive together keep only the latest.
+//
+//	{
+//		"name": "orbit",
+//		"width": 1280, "height": 720,
+//		"warmupFrames": 120, "measuredFrames": 600, "timestep": 0.0166667,
+//		"scene": { "model": "rsc/model.obj", "extraLights": 64, "gpuParticles": false },
+//		"camera": [ { "time": 0, "position": [0, 0, 3], "yaw": -90, "pitch": 0 }, ... ]
+//	}
+//
+// "scene" is read by the caller through scene(), leaving out measuredFrames covers the path once.
+class Benchmark {
+public:
+	bool load(const char* path) {
+		std::ifstream file(path, std::ios::binary);
+		std::stringstream stream;
+		stream << file.rdbuf();
+		std::string text = stream.str();
+		if (!file || !JsonValue::parse(text.data(), text.data() + text.size(), description) || !description.isObject()) {
+			std::cout << "ERROR::BENCHMARK::DESCRIPTION_NOT_READ " << path << std::endl;
+			return false;
+		}
+		if (!cameraPath.load(description["camera"])) {
+			std::cout << "ERROR::BENCHMARK::BAD_CAMERA_PATH " << path << std::endl;
+			return false;
+		}
+		source = path;
+		name = description["name"].asString();
+		warmupFrames = std::max(description["warmupFrames"].asInt(120), 0);
+		fixedTimestep = (float)description["timestep"].asNumber(1.0 / 60.0);
+		if (!(fixedTimestep > 0.0f) || !std::isfinite(fixedTimestep)) {
+			std::cout << "ERROR::BENCHMARK::BAD_TIMESTEP " << fixedTimestep << ", using 1/60 s" << std::endl;
+			fixedTimestep = 1.0f / 60.0f;
+		}
+		// Capped so a tiny timestep can't overflow the frame count
+		double pathFrames = std::min(std::ceil(cameraPath.duration() / fixedTimestep) + 1.0, 1e7);
+		measuredFrames = description["measuredFrames"].asInt((int)pathFrames);
+		measuredFrames = std::max(measuredFrames, 1);
+		frameMs.reserve(measuredFrames);
+		cpuMs.reserve(measuredFrames);
+		gpuMs.reserve(measuredFrames);
+		for (std::vector<double>& values : counters)
+			values.reserve(measuredFrames);
+		frame = 0;
+		return true;
+	}
+
+	const JsonValue& scene() const { return description["scene"]; }
+	int width(int fallback) const { return description["width"].asInt(fallback); }
+	int height(int fallback) const { return description["height"].asInt(fallback); }
+
+	float timestep() const { return fixedTimestep; }
+	float time() const { return std::max(frame - warmupFrames, 0) * fixedTimestep; }	// Path time of the current frame
+	bool measuring() const { return frame >= warmupFrames; }
+	bool done() const { return frame >= warmupFrames + measuredFrames; }
+
+	// Start a frame: pose the camera on the path and start the clocks
+	void beginFrame(Camera& camera) {
+		if (frame == 0) {
+			timer.init();
+			gpuSamples = 0;
+		}
+		CameraKey pose = cameraPath.sample(time());
+		camera.Position = pose.position;
+		camera.SetOrientation(pose.yaw, pose.pitch);
+		camera.Zoom = ZOOM;
+		Clock::time_point now = Clock::now();
+		if (measuring() && frame > warmupFrames)
+			frameMs.push_back(milliseconds(now - frameStart));
+		frameStart = now;
+		collectGpuTime();
+		timer.begin();
+	}
+
+	// End a frame, before the swap so the CPU time leaves out waiting on the GPU. Returns true once the last
+	// measured frame is in.
+	bool endFrame(const RenderStatsFrame& stats) {
+		timer.end();
+		if (measuring()) {
+			cpuMs.push_back(milliseconds(Clock::now() - frameStart));
+			for (int i = 0; i < RENDER_STAT_COUNT; i++)
+				counters[i].push_back((double)stats.value[i]);
+		}
+		frame++;
+		if (!done())
+			return false;
+		glFinish();		// Collect the GPU times still in flight
+		collectGpuTime();
+		timer.release();
+		return true;
+	}
+
+	// Memory to report, in bytes, e.g. GPU buffers and textures at the end of the run
+	void addMemory(const char* what, size_t bytes) { memory.push_back(std::make_pair(std::string(what), bytes)); }
+
+	bool write(const char* path) const {
+		FILE* out = fopen(path, "w");
+		if (!out) {
+			std::cout << "ERROR::BENCHMARK::OUTPUT_NOT_WRITTEN " << path << std::endl;
+			return false;
+		}
+		fprintf(out, "{\n");
+		fprintf(out, "\t\"name\": \"%s\",\n", escape(name).c_str());
+		fprintf(out, "\t\"description\": \"%s\",\n", escape(source).c_str());
+		fprintf(out, "\t\"renderer\": \"%s\",\n", escape(glString(GL_RENDERER)).c_str());
+		fprintf(out, "\t\"glVersion\": \"%s\",\n", escape(glString(GL_VERSION)).c_str());
+		fprintf(out, "\t\"warmupFrames\": %d,\n\t\"measuredFrames\": %d,\n\t\"timestep\": %g,\n", warmupFrames, measuredFrames, fixedTimestep);
+		writeStats(out, "frameMs", frameMs);
+		writeStats(out, "cpuMs", cpuMs);
+		writeStats(out, "gpuMs", gpuMs);
+		for (int i = 0; RENDER_STATS_ENABLED && i < RENDER_STAT_COUNT; i++)
+			writeStats(out, RENDER_STAT_NAMES[i], counters[i]);
+		fprintf(out, "\t\"memoryBytes\": {");
+		for (size_t i = 0; i < memory.size(); i++)
+			fprintf(out, "%s\n\t\t\"%s\": %zu", i ? "," : "", escape(memory[i].first).c_str(), memory[i].second);
+		fprintf(out, "\n\t}\n}\n");
+		fclose(out);
+		return true;
+	}
+
+	void printReport() const {
+		printf("Benchmark %s: %d frames, %.2f ms mean frame, %.2f ms 99th percentile, %.2f ms CPU, %.2f ms GPU\n",
+			name.c_str(), measuredFrames, mean(frameMs), percentile(frameMs, 0.99), mean(cpuMs), mean(gpuMs));
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	static double milliseconds(Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+	// GpuTimer::begin() polls too, so new results are spotted by the sample count. Warmup results are dropped.
+	void collectGpuTime() {
+		timer.poll();
+		if (timer.count() > gpuSamples && measuring() && gpuMs.size() < (size_t)measuredFrames)
+			gpuMs.push_back(timer.last());
+		gpuSamples = timer.count();
+	}
+
+	static double mean(const std::vector<double>& values) {
+		double sum = 0.0;
+		for (double v : values)
+			sum += v;
+		return values.empty() ? 0.0 : sum / values.size();
+	}
+
+	// Nearest rank
+	static double percentile(std::vector<double> values, double p) {
+		if (values.empty())
+			return 0.0;
+		size_t rank = std::min((size_t)std::ceil(p * values.size()), values.size()) - (p > 0.0 ? 1 : 0);
+		std::nth_element(values.begin(), values.begin() + rank, values.end());
+		return values[rank];
+	}
+
+	static void writeStats(FILE* out, const char* key, const std::vector<double>& values) {
+		double m = mean(values);
+		double variance = 0.0;
+		for (double v : values)
+			variance += (v - m) * (v - m);
+		variance = values.size() > 1 ? variance / (values.size() - 1) : 0.0;
+		fprintf(out, "\t\"%s\": { \"samples\": %zu, \"mean\": %.4f, \"stdDev\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+			"\"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n", key, values.size(), m, std::sqrt(variance), percentile(values, 0.0),
+			percentile(values, 0.5), percentile(values, 0.9), percentile(values, 0.95), percentile(values, 0.99), percentile(values, 1.0));
+	}
+
+	static std::string glString(GLenum name) {
+		const GLubyte* s = glGetString(name);
+		return s ? std::string((const char*)s) : std::string();
+	}
+
+	static std::string escape(const std::string& s) {
+		std::string out;
+		for (char c : s) {
+			if (c == '"' || c == '\\')
+				out += '\\';
+			if ((unsigned char)c >= 0x20)
+				out += c;
+		}
+		return out;
+	}
+
+	JsonValue description;
+	CameraPath cameraPath;
+	std::string source;
+	std::string name;
+	int warmupFrames = 0;
+	int measuredFrames = 0;
+	float fixedTimestep = 1.0f / 60.0f;
+	int frame = 0;
+	Clock::time_point frameStart;
+	GpuTimer timer;
+	uint64_t gpuSamples = 0;
+	std::vector<double> frameMs;
+	std::vector<double> cpuMs;
+	std::vector<double> gpuMs;
+	std::vector<double> counters[RENDER_STAT_COUNT];
+	std::vector<std::pair<std::string, size_t>> memory;
+};
+
+#endif
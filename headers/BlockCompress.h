@@ -0,0 +1,652 @@
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BC_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BC_USE_SSE2
+#endif
+
+// Formats from GL_EXT_texture_compression_s3tc / GL_ARB_texture_compression_bptc, glad is only generated for the 3.3 core
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+// Block compressed formats, the value matches the BCn number
+enum BCFormat {
+	BC_NONE = 0,
+	BC1 = 1,	// RGB, 4 bpp
+	BC3 = 3,	// RGBA, BC1 color + interpolated alpha, 8 bpp
+	BC7 = 7		// RGBA, mode 6 only, 8 bpp
+};
+
+// Speed / quality knob of the encoder
+enum BCQuality {
+	BC_QUALITY_FAST = 0,	// Bounding box endpoints
+	BC_QUALITY_NORMAL = 1,	// Principal axis endpoints
+	BC_QUALITY_HIGH = 2		// Principal axis plus least squares endpoint refinement
+};
+
+// A 4x4 block split into channel planes so 4 (SSE) or 8 (AVX) pixels are processed per instruction
+struct BCBlock {
+	alignas(32) float c[4][16];	// r, g, b, a in 0..255
+};
+
+inline size_t bcBlockBytes(BCFormat format) {
+	return format == BC1 ? 8 : 16;
+}
+
+inline size_t bcCompressedSize(BCFormat format, int width, int height) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bcBlockBytes(format);
+}
+
+inline unsigned int bcGLFormat(BCFormat format) {
+	switch (format) {
+	case BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default: return 0;
+	}
+}
+
+// BC1 for opaque images, BC3 when the source carries alpha
+inline BCFormat bcDefaultFormat(int channels) {
+	return (channels == 2 || channels == 4) ? BC3 : BC1;
+}
+
+// Index of the closest palette entry for each of the 16 pixels, returns the summed squared error
+inline float bcFitIndices(const BCBlock& block, const float (*palette)[4], int paletteSize, int channels, uint8_t* indices) {
+	float total = 0.0f;
+#if defined(BC_USE_AVX)
+	for (int i = 0; i < 16; i += 8) {
+		__m256 px[4];
+		for (int c = 0; c < channels; c++)
+			px[c] = _mm256_load_ps(&block.c[c][i]);
+		__m256 best = _mm256_set1_ps(FLT_MAX);
+		__m256 bestIndex = _mm256_setzero_ps();
+		for (int k = 0; k < paletteSize; k++) {
+			__m256 dist = _mm256_setzero_ps();
+			for (int c = 0; c < channels; c++) {
+				__m256 d = _mm256_sub_ps(px[c], _mm256_set1_ps(palette[k][c]));
+				dist = _mm256_add_ps(dist, _mm256_mul_ps(d, d));
+			}
+			__m256 closer = _mm256_cmp_ps(dist, best, _CMP_LT_OQ);
+			best = _mm256_min_ps(dist, best);
+			bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps((float)k), closer);
+		}
+		alignas(32) float err[8], idx[8];
+		_mm256_store_ps(err, best);
+		_mm256_store_ps(idx, bestIndex);
+		for (int j = 0; j < 8; j++) {
+			indices[i + j] = (uint8_t)idx[j];
+			total += err[j];
+		}
+	}
+#elif defined(BC_USE_SSE2)
+	for (int i = 0; i < 16; i += 4) {
+		__m128 px[4];
+		for (int c = 0; c < channels; c++)
+			px[c] = _mm_load_ps(&block.c[c][i]);
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int k = 0; k < paletteSize; k++) {
+			__m128 dist = _mm_setzero_ps();
+			for (int c = 0; c < channels; c++) {
+				__m128 d = _mm_sub_ps(px[c], _mm_set1_ps(palette[k][c]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+			}
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+			best = _mm_min_ps(dist, best);
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+		}
+		alignas(16) float err[4];
+		alignas(16) int32_t idx[4];
+		_mm_store_ps(err, best);
+		_mm_store_si128((__m128i*)idx, bestIndex);
+		for (int j = 0; j < 4; j++) {
+			indices[i + j] = (uint8_t)idx[j];
+			total += err[j];
+		}
+	}
+#else
+	for (int i = 0; i < 16; i++) {
+		float best = FLT_MAX;
+		for (int k = 0; k < paletteSize; k++) {
+			float dist = 0.0f;
+			for (int c = 0; c < channels; c++) {
+				float d = block.c[c][i] - palette[k][c];
+				dist += d * d;
+			}
+			if (dist < best) {
+				best = dist;
+				indices[i] = (uint8_t)k;
+			}
+		}
+		total += best;
+	}
+#endif
+	return total;
+}
+
+// Per channel minimum and maximum of a block
+inline void bcMinMax(const BCBlock& block, int channels, float* lo, float* hi) {
+	for (int c = 0; c < channels; c++) {
+#if defined(BC_USE_SSE2) || defined(BC_USE_AVX)
+		__m128 a = _mm_load_ps(&block.c[c][0]), b = _mm_load_ps(&block.c[c][4]);
+		__m128 d = _mm_load_ps(&block.c[c][8]), e = _mm_load_ps(&block.c[c][12]);
+		__m128 mn = _mm_min_ps(_mm_min_ps(a, b), _mm_min_ps(d, e));
+		__m128 mx = _mm_max_ps(_mm_max_ps(a, b), _mm_max_ps(d, e));
+		mn = _mm_min_ps(mn, _mm_shuffle_ps(mn, mn, _MM_SHUFFLE(1, 0, 3, 2)));
+		mx = _mm_max_ps(mx, _mm_shuffle_ps(mx, mx, _MM_SHUFFLE(1, 0, 3, 2)));
+		mn = _mm_min_ps(mn, _mm_shuffle_ps(mn, mn, _MM_SHUFFLE(2, 3, 0, 1)));
+		mx = _mm_max_ps(mx, _mm_shuffle_ps(mx, mx, _MM_SHUFFLE(2, 3, 0, 1)));
+		lo[c] = _mm_cvtss_f32(mn);
+		hi[c] = _mm_cvtss_f32(mx);
+#else
+		lo[c] = hi[c] = block.c[c][0];
+		for (int i = 1; i < 16; i++) {
+			lo[c] = std::min(lo[c], block.c[c][i]);
+			hi[c] = std::max(hi[c], block.c[c][i]);
+		}
+#endif
+	}
+}
+
+// Diagonal of the block's bounding box, inset by 1/16 of its size since interpolated entries cover the extremes anyway
+inline void bcBoxEndpoints(const BCBlock& block, int channels, float* e0, float* e1) {
+	float lo[4], hi[4];
+	bcMinMax(block, channels, lo, hi);
+	for (int c = 0; c < channels; c++) {
+		float inset = (hi[c] - lo[c]) / 16.0f;
+		e0[c] = lo[c] + inset;
+		e1[c] = hi[c] - inset;
+	}
+}
+
+// Pick a starting line through the block's colors, e0 and e1 are its ends: the box diagonal when fast, the
+// principal axis otherwise
+inline void bcFindEndpoints(const BCBlock& block, int channels, BCQuality quality, float* e0, float* e1) {
+	if (quality == BC_QUALITY_FAST) {
+		bcBoxEndpoints(block, channels, e0, e1);
+		return;
+	}
+	float lo[4], hi[4];
+	bcMinMax(block, channels, lo, hi);
+
+	// Principal axis of the color covariance by power iteration
+	float mean[4] = {};
+	for (int c = 0; c < channels; c++) {
+		for (int i = 0; i < 16; i++)
+			mean[c] += block.c[c][i];
+		mean[c] /= 16.0f;
+	}
+	float cov[4][4] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int a = 0; a < channels; a++) {
+			for (int b = a; b < channels; b++)
+				cov[a][b] += (block.c[a][i] - mean[a]) * (block.c[b][i] - mean[b]);
+		}
+	}
+	for (int a = 0; a < channels; a++) {
+		for (int b = 0; b < a; b++)
+			cov[a][b] = cov[b][a];
+	}
+
+	float axis[4];
+	for (int c = 0; c < channels; c++)
+		axis[c] = hi[c] - lo[c];
+	for (int iter = 0; iter < 8; iter++) {
+		float next[4] = {};
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++)
+				next[a] += cov[a][b] * axis[b];
+			length = std::max(length, std::fabs(next[a]));
+		}
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < channels; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float minT = FLT_MAX, maxT = -FLT_MAX, norm = 0.0f;
+	for (int c = 0; c < channels; c++)
+		norm += axis[c] * axis[c];
+	if (norm < 1e-12f) {
+		// Solid block
+		for (int c = 0; c < channels; c++)
+			e0[c] = e1[c] = mean[c];
+		return;
+	}
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+			t += (block.c[c][i] - mean[c]) * axis[c];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+	for (int c = 0; c < channels; c++) {
+		e0[c] = std::min(std::max(mean[c] + axis[c] * minT / norm, 0.0f), 255.0f);
+		e1[c] = std::min(std::max(mean[c] + axis[c] * maxT / norm, 0.0f), 255.0f);
+	}
+}
+
+// Least squares endpoints for fixed indices, weights[k] is how far palette entry k sits from e0 towards e1
+inline bool bcRefineEndpoints(const BCBlock& block, int channels, const uint8_t* indices, const float* weights, float* e0, float* e1) {
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+	for (int i = 0; i < 16; i++) {
+		float t = weights[indices[i]];
+		float s = 1.0f - t;
+		aa += s * s;
+		bb += t * t;
+		ab += s * t;
+		for (int c = 0; c < channels; c++) {
+			ax[c] += s * block.c[c][i];
+			bx[c] += t * block.c[c][i];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (std::fabs(det) < 1e-6f)
+		return false;
+	for (int c = 0; c < channels; c++) {
+		e0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / det, 0.0f), 255.0f);
+		e1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / det, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+inline uint16_t bcPack565(const float* color) {
+	int r = (int)std::lround(color[0] * 31.0f / 255.0f);
+	int g = (int)std::lround(color[1] * 63.0f / 255.0f);
+	int b = (int)std::lround(color[2] * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void bcUnpack565(uint16_t packed, int* color) {
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Four color palette in index order (c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1)
+inline void bcBC1Palette(uint16_t c0, uint16_t c1, int (*palette)[4]) {
+	bcUnpack565(c0, palette[0]);
+	bcUnpack565(c1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+	for (int k = 0; k < 4; k++)
+		palette[k][3] = 255;
+}
+
+// Quantize endpoints and fit indices, returns the block error
+inline float bcEncodeBC1Endpoints(const BCBlock& block, const float* e0, const float* e1, uint16_t& c0, uint16_t& c1, uint8_t* indices) {
+	c0 = bcPack565(e1);
+	c1 = bcPack565(e0);
+	if (c0 < c1)
+		std::swap(c0, c1);	// c0 > c1 selects the opaque four color mode
+
+	int ipal[4][4];
+	bcBC1Palette(c0, c1, ipal);
+	float palette[4][4];
+	for (int k = 0; k < 4; k++) {
+		for (int c = 0; c < 4; c++)
+			palette[k][c] = (float)ipal[k][c];
+	}
+	if (c0 == c1) {
+		// Equal endpoints would select the three color mode, every pixel uses c0
+		memset(indices, 0, 16);
+		float err = 0.0f;
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++)
+				err += (block.c[c][i] - palette[0][c]) * (block.c[c][i] - palette[0][c]);
+		}
+		return err;
+	}
+	return bcFitIndices(block, palette, 4, 3, indices);
+}
+
+inline void bcEncodeBC1Block(const BCBlock& block, BCQuality quality, unsigned char* out) {
+	static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	float e0[4], e1[4];
+	bcFindEndpoints(block, 3, quality, e0, e1);
+
+	uint16_t c0, c1;
+	uint8_t indices[16];
+	float err = bcEncodeBC1Endpoints(block, e0, e1, c0, c1, indices);
+
+	if (quality != BC_QUALITY_FAST) {
+		// The principal axis misses on blocks whose colors don't lie along one line, keep the box when it fits better
+		float b0[4], b1[4];
+		bcBoxEndpoints(block, 3, b0, b1);
+		uint16_t n0, n1;
+		uint8_t nIndices[16];
+		float nErr = bcEncodeBC1Endpoints(block, b0, b1, n0, n1, nIndices);
+		if (nErr < err) {
+			err = nErr;
+			c0 = n0;
+			c1 = n1;
+			memcpy(indices, nIndices, 16);
+		}
+
+		int refinements = quality == BC_QUALITY_HIGH ? 2 : 1;
+		for (int iter = 0; iter < refinements && err > 0.0f; iter++) {
+			// Refit in palette order: entry k lies weights[k] of the way from c0 to c1
+			float r0[4], r1[4];
+			if (!bcRefineEndpoints(block, 3, indices, weights, r0, r1))
+				break;
+			uint16_t n0, n1;
+			uint8_t nIndices[16];
+			float nErr = bcEncodeBC1Endpoints(block, r0, r1, n0, n1, nIndices);
+			if (nErr >= err)
+				break;
+			err = nErr;
+			c0 = n0;
+			c1 = n1;
+			memcpy(indices, nIndices, 16);
+		}
+	}
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint32_t)indices[i] << (2 * i);
+	out[0] = (unsigned char)(c0 & 0xFF);
+	out[1] = (unsigned char)(c0 >> 8);
+	out[2] = (unsigned char)(c1 & 0xFF);
+	out[3] = (unsigned char)(c1 >> 8);
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+// Interpolated alpha block in the eight value mode (a0 > a1)
+inline void bcEncodeAlphaBlock(const BCBlock& block, BCQuality quality, unsigned char* out) {
+	float lo[4], hi[4];
+	bcMinMax(block, 4, lo, hi);
+	int a0 = (int)std::lround(hi[3]);
+	int a1 = (int)std::lround(lo[3]);
+	if (quality == BC_QUALITY_FAST && a0 - a1 > 16) {
+		int inset = (a0 - a1) / 32;
+		a0 -= inset;
+		a1 += inset;
+	}
+
+	uint64_t bits = 0;
+	if (a0 > a1) {
+		for (int i = 0; i < 16; i++) {
+			// Position along a0 -> a1 in sevenths, mapped to the hardware index order
+			int step = (int)std::lround((a0 - block.c[3][i]) * 7.0f / (float)(a0 - a1));
+			step = std::min(std::max(step, 0), 7);
+			int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+			bits |= (uint64_t)index << (3 * i);
+		}
+	}
+	out[0] = (unsigned char)a0;
+	out[1] = (unsigned char)a1;
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+// Little endian bit writer for 128 bit blocks
+struct BCBitWriter {
+	unsigned char* out;
+	int pos;
+
+	void write(uint32_t value, int count) {
+		for (int i = 0; i < count; i++, pos++) {
+			if ((value >> i) & 1)
+				out[pos >> 3] |= (unsigned char)(1 << (pos & 7));
+		}
+	}
+};
+
+static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Quantize RGBA endpoints to 7 bits + a shared low p-bit, fit indices and return the error
+inline float bcEncodeBC7Endpoints(const BCBlock& block, const float* e0, const float* e1, int p0, int p1, int* q0, int* q1, uint8_t* indices) {
+	int v0[4], v1[4];
+	for (int c = 0; c < 4; c++) {
+		q0[c] = std::min(std::max((int)std::lround((e0[c] - p0) / 2.0f), 0), 127);
+		q1[c] = std::min(std::max((int)std::lround((e1[c] - p1) / 2.0f), 0), 127);
+		v0[c] = (q0[c] << 1) | p0;
+		v1[c] = (q1[c] << 1) | p1;
+	}
+	float palette[16][4];
+	for (int k = 0; k < 16; k++) {
+		for (int c = 0; c < 4; c++)
+			palette[k][c] = (float)(((64 - BC7_WEIGHTS4[k]) * v0[c] + BC7_WEIGHTS4[k] * v1[c] + 32) >> 6);
+	}
+	return bcFitIndices(block, palette, 16, 4, indices);
+}
+
+// BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with unique p-bits, 4 bit indices
+inline void bcEncodeBC7Block(const BCBlock& block, BCQuality quality, unsigned char* out) {
+	float weights[16];
+	for (int k = 0; k < 16; k++)
+		weights[k] = BC7_WEIGHTS4[k] / 64.0f;
+
+	float e0[4], e1[4];
+	bcFindEndpoints(block, 4, quality, e0, e1);
+
+	int best0[4], best1[4], bestP0 = 0, bestP1 = 0;
+	uint8_t bestIndices[16];
+	float bestErr = FLT_MAX;
+
+	// Fast mode takes the p-bits from the rounded endpoints, the others try all four combinations
+	int pCombos = quality == BC_QUALITY_FAST ? 1 : 4;
+	int passes = quality == BC_QUALITY_HIGH ? 2 : 0;
+	for (int pass = 0; pass <= passes; pass++) {
+		for (int combo = 0; combo < pCombos; combo++) {
+			int p0 = combo & 1, p1 = combo >> 1;
+			if (pCombos == 1) {
+				p0 = ((int)std::lround(e0[0] + e0[1] + e0[2] + e0[3]) / 4) & 1;
+				p1 = ((int)std::lround(e1[0] + e1[1] + e1[2] + e1[3]) / 4) & 1;
+			}
+			int q0[4], q1[4];
+			uint8_t indices[16];
+			float err = bcEncodeBC7Endpoints(block, e0, e1, p0, p1, q0, q1, indices);
+			if (err < bestErr) {
+				bestErr = err;
+				memcpy(best0, q0, sizeof(q0));
+				memcpy(best1, q1, sizeof(q1));
+				bestP0 = p0;
+				bestP1 = p1;
+				memcpy(bestIndices, indices, 16);
+			}
+		}
+		if (pass < passes && !bcRefineEndpoints(block, 4, bestIndices, weights, e0, e1))
+			break;
+	}
+
+	// The first index is stored with an implicit zero high bit
+	if (bestIndices[0] & 8) {
+		std::swap(best0, best1);
+		std::swap(bestP0, bestP1);
+		for (int i = 0; i < 16; i++)
+			bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+	}
+
+	memset(out, 0, 16);
+	BCBitWriter writer = { out, 0 };
+	writer.write(1 << 6, 7);	// Mode 6
+	for (int c = 0; c < 4; c++) {
+		writer.write(best0[c], 7);
+		writer.write(best1[c], 7);
+	}
+	writer.write(bestP0, 1);
+	writer.write(bestP1, 1);
+	writer.write(bestIndices[0], 3);
+	for (int i = 1; i < 16; i++)
+		writer.write(bestIndices[i], 4);
+}
+
+// Gather a 4x4 block, edge pixels are repeated past the image border. Grey / grey+alpha sources are expanded to RGB.
+inline void bcLoadBlock(const unsigned char* pixels, int width, int height, int channels, int bx, int by, BCBlock& block) {
+	for (int y = 0; y < 4; y++) {
+		int sy = std::min(by * 4 + y, height - 1);
+		for (int x = 0; x < 4; x++) {
+			int sx = std::min(bx * 4 + x, width - 1);
+			const unsigned char* p = pixels + ((size_t)sy * width + sx) * channels;
+			int i = y * 4 + x;
+			if (channels >= 3) {
+				block.c[0][i] = p[0];
+				block.c[1][i] = p[1];
+				block.c[2][i] = p[2];
+				block.c[3][i] = channels == 4 ? p[3] : 255.0f;
+			}
+			else {
+				block.c[0][i] = block.c[1][i] = block.c[2][i] = p[0];
+				block.c[3][i] = channels == 2 ? p[1] : 255.0f;
+			}
+		}
+	}
+}
+
+// Compress an 8 bit image into `out` (bcCompressedSize bytes), block rows are spread over worker threads
+inline void bcCompress(const unsigned char* pixels, int width, int height, int channels, BCFormat format, BCQuality quality, unsigned char* out, int threads = 0) {
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t blockBytes = bcBlockBytes(format);
+	parallelFor(blocksY, [&](int by) {
+		BCBlock block;
+		for (int bx = 0; bx < blocksX; bx++) {
+			unsigned char* dst = out + ((size_t)by * blocksX + bx) * blockBytes;
+			bcLoadBlock(pixels, width, height, channels, bx, by, block);
+			switch (format) {
+			case BC1:
+				bcEncodeBC1Block(block, quality, dst);
+				break;
+			case BC3:
+				bcEncodeAlphaBlock(block, quality, dst);
+				bcEncodeBC1Block(block, quality, dst + 8);
+				break;
+			case BC7:
+				bcEncodeBC7Block(block, quality, dst);
+				break;
+			default:
+				break;
+			}
+		}
+	}, threads);
+}
+
+// Decode back to RGBA8, used to measure encoder error and as a fallback when the GL lacks the format
+inline void bcDecompress(const unsigned char* blocks, int width, int height, BCFormat format, unsigned char* rgba) {
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t blockBytes = bcBlockBytes(format);
+	for (int by = 0; by < blocksY; by++) {
+		for (int bx = 0; bx < blocksX; bx++) {
+			const unsigned char* src = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+			unsigned char texels[16][4];
+
+			if (format == BC1 || format == BC3) {
+				const unsigned char* color = format == BC3 ? src + 8 : src;
+				uint16_t c0 = (uint16_t)(color[0] | (color[1] << 8));
+				uint16_t c1 = (uint16_t)(color[2] | (color[3] << 8));
+				uint32_t bits = color[4] | (color[5] << 8) | (color[6] << 16) | ((uint32_t)color[7] << 24);
+				int palette[4][4];
+				bcBC1Palette(c0, c1, palette);
+				if (format == BC1 && c0 <= c1) {
+					// Three color mode with transparent black, BC3 color blocks always interpolate four colors
+					for (int c = 0; c < 3; c++) {
+						palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+						palette[3][c] = 0;
+					}
+					palette[3][3] = 0;
+				}
+				for (int i = 0; i < 16; i++) {
+					int k = (bits >> (2 * i)) & 3;
+					for (int c = 0; c < 4; c++)
+						texels[i][c] = (unsigned char)palette[k][c];
+				}
+			}
+			if (format == BC3) {
+				int alpha[8] = { src[0], src[1] };
+				if (alpha[0] > alpha[1]) {
+					for (int k = 2; k < 8; k++)
+						alpha[k] = ((8 - k) * alpha[0] + (k - 1) * alpha[1]) / 7;
+				}
+				else {
+					for (int k = 2; k < 6; k++)
+						alpha[k] = ((6 - k) * alpha[0] + (k - 1) * alpha[1]) / 5;
+					alpha[6] = 0;
+					alpha[7] = 255;
+				}
+				uint64_t bits = 0;
+				for (int i = 0; i < 6; i++)
+					bits |= (uint64_t)src[2 + i] << (8 * i);
+				for (int i = 0; i < 16; i++)
+					texels[i][3] = (unsigned char)alpha[(bits >> (3 * i)) & 7];
+			}
+			if (format == BC7) {
+				uint64_t lo = 0, hi = 0;
+				for (int i = 0; i < 8; i++) {
+					lo |= (uint64_t)src[i] << (8 * i);
+					hi |= (uint64_t)src[8 + i] << (8 * i);
+				}
+				auto bitsAt = [&](int pos, int count) {
+					uint32_t v = 0;
+					for (int i = 0; i < count; i++, pos++) {
+						uint64_t word = pos < 64 ? lo : hi;
+						v |= (uint32_t)((word >> (pos & 63)) & 1) << i;
+					}
+					return v;
+				};
+				if ((lo & 0x7F) != 0x40) {
+					// Only mode 6 is produced by this encoder, flag anything else in magenta
+					for (int i = 0; i < 16; i++) {
+						texels[i][0] = 255; texels[i][1] = 0; texels[i][2] = 255; texels[i][3] = 255;
+					}
+				}
+				else {
+					int e[2][4];
+					for (int c = 0; c < 4; c++) {
+						e[0][c] = (int)bitsAt(7 + c * 14, 7) << 1;
+						e[1][c] = (int)bitsAt(14 + c * 14, 7) << 1;
+					}
+					int p0 = (int)bitsAt(63, 1), p1 = (int)bitsAt(64, 1);
+					for (int i = 0; i < 16; i++) {
+						int index = i == 0 ? (int)bitsAt(65, 3) : (int)bitsAt(68 + (i - 1) * 4, 4);
+						int w = BC7_WEIGHTS4[index];
+						for (int c = 0; c < 4; c++)
+							texels[i][c] = (unsigned char)(((64 - w) * (e[0][c] | p0) + w * (e[1][c] | p1) + 32) >> 6);
+					}
+				}
+			}
+
+			for (int y = 0; y < 4; y++) {
+				int py = by * 4 + y;
+				if (py >= height)
+					break;
+				for (int x = 0; x < 4; x++) {
+					int px = bx * 4 + x;
+					if (px >= width)
+						break;
+					memcpy(rgba + ((size_t)py * width + px) * 4, texels[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef DEBUG_OUTPUT_H
+#define DEBUG_OUTPUT_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+const int DEBUG_OUTPUT_DISTINCT = 256;		// Distinct messages remembered, later new ones are only counted
+const int DEBUG_OUTPUT_TEXT = 160;			// Characters of each message kept for the report
+const int DEBUG_LABEL_LENGTH = 255;			// Labels are cut to fit the smallest GL_MAX_LABEL_LENGTH
+
+// KHR_debug entry points for the helpers below, NULL until DebugOutput::init() finds the extension
+struct DebugProcs {
+	GLObjectLabelProc objectLabel = NULL;
+	GLPushDebugGroupProc pushDebugGroup = NULL;
+	GLPopDebugGroupProc popDebugGroup = NULL;
+};
+
+inline DebugProcs& debugProcs() {
+	static DebugProcs procs;
+	return procs;
+}
+
+// Name a GL object (GL_BUFFER, GL_TEXTURE, GL_PROGRAM, ...) for debug messages and frame debuggers, a no-op without KHR_debug
+inline void debugLabel(GLenum identifier, GLuint name, const char* label) {
+	GLObjectLabelProc objectLabel = debugProcs().objectLabel;
+	if (objectLabel && name && label)
+		objectLabel(identifier, name, (GLsizei)std::min(strlen(label), (size_t)DEBUG_LABEL_LENGTH), label);
+}
+
+// Bracket a render pass, frame debuggers show the calls between as a named group
+inline void debugPushGroup(const char* name) {
+	GLPushDebugGroupProc pushDebugGroup = debugProcs().pushDebugGroup;
+	if (pushDebugGroup)
+		pushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, (GLsizei)std::min(strlen(name), (size_t)DEBUG_LABEL_LENGTH), name);
+}
+
+inline void debugPopGroup() {
+	GLPopDebugGroupProc popDebugGroup = debugProcs().popDebugGroup;
+	if (popDebugGroup)
+		popDebugGroup();
+}
+
+// Receives the driver's KHR_debug messages through a callback instead of polling glGetError, which waits for the
+// GL thread to catch up. Messages below minSeverity are switched off in the driver so it doesn't build them. The
+// first of each kind is printed, repeats are only counted: a kind is the source, type, id and severity, plus the
+// text when the driver leaves the id at 0. Without synchronous the driver may call back from its own thread, late
+// and away from the offending call, which costs nothing on the render thread. Debug builds default to synchronous
+// so a breakpoint in record() stops on the call that caused the message.
+//
+// Without KHR_debug, debug builds fall back to draining glGetError once per frame in endFrame(). Release builds
+// never call it.
+class DebugOutput {
+public:
+	GLenum minSeverity = GL_DEBUG_SEVERITY_LOW;
+#ifdef NDEBUG
+	bool synchronous = false;
+#else
+	bool synchronous = true;
+#endif
+
+	// Needs the context current, false without KHR_debug. Drivers may say little unless the context was created
+	// with GLFW_OPENGL_DEBUG_CONTEXT.
+	bool init(const GLExtensions& ext) {
+		DebugProcs& procs = debugProcs();
+		procs.objectLabel = ext.objectLabel;
+		procs.pushDebugGroup = ext.pushDebugGroup;
+		procs.popDebugGroup = ext.popDebugGroup;
+		if (!ext.debugOutput)
+			return false;
+
+		GLint flags = 0;
+		glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+		debugContext = (flags & GL_CONTEXT_FLAG_DEBUG_BIT) != 0;
+		glEnable(GL_DEBUG_OUTPUT);
+		if (synchronous)
+			glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		else
+			glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+		ext.debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+		const GLenum severities[] = { GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_MEDIUM };
+		for (GLenum severity : severities) {
+			if (rank(severity) < rank(minSeverity))
+				ext.debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severity, 0, NULL, GL_FALSE);
+		}
+		// Our own debug groups echo back as messages otherwise
+		ext.debugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+		ext.debugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+		ext.debugMessageCallback(&DebugOutput::callback, this);
+		active = true;
+		return true;
+	}
+
+	// Once per frame
+	void endFrame() {
+#ifndef NDEBUG
+		if (!active) {
+			GLenum error;
+			while ((error = glGetError()) != GL_NO_ERROR)
+				record(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_ERROR, error, GL_DEBUG_SEVERITY_HIGH, errorName(error));
+		}
+#endif
+	}
+
+	bool enabled() const { return active; }
+	uint64_t messageCount() const { std::lock_guard<std::mutex> lock(mutex); return messages; }
+	uint64_t errorCount() const { std::lock_guard<std::mutex> lock(mutex); return errors; }
+
+	// Every kind of message seen and how often
+	void printReport() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (active)
+			printf("GL debug output: %s, %s context, ", synchronous ? "synchronous" : "asynchronous", debugContext ? "debug" : "non-debug");
+		else {
+#ifdef NDEBUG
+			printf("GL debug output: no KHR_debug, errors unchecked, ");
+#else
+			printf("GL debug output: no KHR_debug, glGetError once per frame, ");
+#endif
+		}
+		printf("%llu messages of %zu kinds, %llu errors\n", (unsigned long long)messages, distinct, (unsigned long long)errors);
+		for (const Entry& entry : entries) {
+			if (entry.count > 0)
+				printf("  %6llu x %s %s: %s\n", (unsigned long long)entry.count, severityName(entry.severity), typeName(entry.type), entry.text);
+		}
+		if (uncounted)
+			printf("  %llu more messages of kinds past the first %d\n", (unsigned long long)uncounted, DEBUG_OUTPUT_DISTINCT);
+	}
+
+private:
+	struct Entry {
+		uint64_t key = 0;
+		uint64_t count = 0;
+		GLenum type = 0;
+		GLenum severity = 0;
+		char text[DEBUG_OUTPUT_TEXT] = {};
+	};
+
+	static void APIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
+		(void)length;
+		static_cast<DebugOutput*>(const_cast<void*>(userParam))->record(source, type, id, severity, message);
+	}
+
+	void record(GLenum source, GLenum type, GLuint id, GLenum severity, const char* message) {
+		if (rank(severity) < rank(minSeverity))
+			return;		// The driver may ignore the message control
+		uint64_t key = 0xCBF29CE484222325ull;
+		const GLuint fields[] = { source, type, id, severity };
+		for (GLuint field : fields)
+			key = (key ^ field) * 0x100000001B3ull;
+		for (const char* c = message; id == 0 && *c; c++)
+			key = (key ^ (unsigned char)*c) * 0x100000001B3ull;
+		key |= 1;	// 0 marks a free entry
+
+		std::lock_guard<std::mutex> lock(mutex);
+		messages++;
+		bool error = type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH;
+		errors += error ? 1 : 0;
+		// Open addressing over a fixed table, so the callback never allocates
+		for (int probe = 0; probe < DEBUG_OUTPUT_DISTINCT; probe++) {
+			Entry& entry = entries[(key + probe) % DEBUG_OUTPUT_DISTINCT];
+			if (entry.key == key) {
+				entry.count++;
+				return;
+			}
+			if (entry.key != 0)
+				continue;
+			entry.key = key;
+			entry.count = 1;
+			entry.type = type;
+			entry.severity = severity;
+			snprintf(entry.text, sizeof(entry.text), "%s", message);
+			distinct++;
+			if (error)
+				std::cout << "ERROR::GL::" << typeName(type) << " (" << sourceName(source) << ", id " << id << ") " << message << std::endl;
+			else
+				printf("GL %s %s (%s, id %u): %s\n", severityName(severity), typeName(type), sourceName(source), id, message);
+			return;
+		}
+		uncounted++;
+	}
+
+	static int rank(GLenum severity) {
+		switch (severity) {
+		case GL_DEBUG_SEVERITY_HIGH: return 3;
+		case GL_DEBUG_SEVERITY_MEDIUM: return 2;
+		case GL_DEBUG_SEVERITY_LOW: return 1;
+		default: return 0;
+		}
+	}
+
+	static const char* severityName(GLenum severity) {
+		switch (severity) {
+		case GL_DEBUG_SEVERITY_HIGH: return "high";
+		case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+		case GL_DEBUG_SEVERITY_LOW: return "low";
+		default: return "note";
+		}
+	}
+
+	static const char* typeName(GLenum type) {
+		switch (type) {
+		case GL_DEBUG_TYPE_ERROR: return "ERROR";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "UNDEFINED_BEHAVIOR";
+		case GL_DEBUG_TYPE_PORTABILITY: return "PORTABILITY";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "PERFORMANCE";
+		case GL_DEBUG_TYPE_MARKER: return "MARKER";
+		default: return "OTHER";
+		}
+	}
+
+	static const char* sourceName(GLenum source) {
+		switch (source) {
+		case GL_DEBUG_SOURCE_API: return "api";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+		case GL_DEBUG_SOURCE_APPLICATION: return "application";
+		default: return "other";
+		}
+	}
+
+	static const char* errorName(GLenum error) {
+		switch (error) {
+		case GL_INVALID_ENUM: return "GL_INVALID_ENUM";
+		case GL_INVALID_VALUE: return "GL_INVALID_VALUE";
+		case GL_INVALID_OPERATION: return "GL_INVALID_OPERATION";
+		case GL_INVALID_FRAMEBUFFER_OPERATION: return "GL_INVALID_FRAMEBUFFER_OPERATION";
+		case GL_OUT_OF_MEMORY: return "GL_OUT_OF_MEMORY";
+		default: return "unknown error";
+		}
+	}
+
+	bool active = false;
+	bool debugContext = false;
+	mutable std::mutex mutex;		// Asynchronous output may call back from a driver thread
+	Entry entries[DEBUG_OUTPUT_DISTINCT];
+	size_t distinct = 0;
+	uint64_t messages = 0;
+	uint64_t errors = 0;
+	uint64_t uncounted = 0;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glm/glm.hpp>
+
+#include "GpuTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// Holds the GPU frame time at a budget by scaling the resolution the scene renders at. The whole frame is timed with
+// GpuTimer, and every result that arrives moves the scale part of the way towards the one that would have met the
+// budget (GPU time taken as proportional to the pixel count, so to the scale squared). The scene target stays at
+// full size, only the viewport sub-rect changes, so a new scale never reallocates anything.
+class DynamicResolution {
+public:
+	bool enabled = true;
+	float targetMs = 14.0f;			// GPU budget per frame, a little under 16.7 to leave room at 60 Hz
+	float minScale = 0.5f;			// Per axis
+	float maxScale = 1.0f;
+	float responsiveness = 0.3f;	// Fraction of the correction applied per measurement
+	float deadBand = 0.05f;			// Corrections smaller than this fraction of the scale are ignored, no shimmering
+	float maxSharpness = 0.6f;		// Upscale sharpening at minScale, none at maxScale
+
+	void init() {
+		timer.init();
+		seenSamples = timer.count();
+		currentScale = maxScale;
+	}
+
+	void release() { timer.release(); }
+
+	// Bracket everything the GPU does in a frame
+	void beginFrame() { timer.begin(); }
+
+	// GpuTimer::begin() polls too, so new results are spotted by the sample count rather than poll()'s return
+	void endFrame() {
+		timer.end();
+		timer.poll();
+		if (timer.count() == seenSamples)
+			return;
+		seenSamples = timer.count();
+		scaleSum += currentScale;
+		frames++;
+		lowestScale = std::min(lowestScale, currentScale);
+		if (!enabled) {
+			currentScale = maxScale;
+			return;
+		}
+		double gpuMs = std::max(timer.last(), 0.01);
+		float ideal = currentScale * (float)std::sqrt(targetMs / gpuMs);
+		ideal = std::min(std::max(ideal, minScale), maxScale);
+		if (std::fabs(ideal - currentScale) < currentScale * deadBand)
+			return;
+		currentScale += (ideal - currentScale) * responsiveness;
+	}
+
+	float scale() const { return currentScale; }
+
+	float sharpness() const {
+		return maxScale > minScale ? maxSharpness * (maxScale - currentScale) / (maxScale - minScale) : 0.0f;
+	}
+
+	// Size the scene renders at for a window of width x height, never above it
+	glm::ivec2 renderSize(int width, int height) const {
+		return glm::ivec2(std::min(std::max((int)std::ceil(width * currentScale), 1), width),
+			std::min(std::max((int)std::ceil(height * currentScale), 1), height));
+	}
+
+	void printReport() const {
+		printf("Dynamic resolution: %.2f ms GPU on average (target %.1f), scale %.0f%% on average, %.0f%% lowest\n",
+			timer.average(), targetMs, frames ? 100.0 * scaleSum / frames : 100.0 * currentScale, 100.0 * std::min(lowestScale, currentScale));
+	}
+
+private:
+	GpuTimer timer;
+	float currentScale = 1.0f;
+	float lowestScale = 1.0f;
+	double scaleSum = 0.0;
+	uint64_t frames = 0;
+	uint64_t seenSamples = 0;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Linear allocator for data that lives for one frame. Allocation bumps an offset, reset() at the start of the
+// next frame releases everything at once. When a frame needs more than the capacity the extra comes from the
+// heap, and the next reset() grows the arena to that frame's peak, so a steady state frame never touches the heap.
+class FrameArena {
+public:
+	explicit FrameArena(size_t capacity = 1 << 20) { grow(capacity); }
+	~FrameArena() {
+		free(base);
+		for (void* block : overflow)
+			free(block);
+	}
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+		// Align the address, not the offset, malloc only aligns base to max_align_t
+		uintptr_t address = ((uintptr_t)base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t start = (size_t)(address - (uintptr_t)base);
+		if (start <= size && bytes <= size - start) {
+			offset = start + bytes;
+			return base + start;
+		}
+		// Out of room this frame, fall back to the heap and remember how much was missing
+		overflowBytes += bytes + alignment;
+		void* block = malloc(bytes + alignment);
+		if (block == NULL)
+			throw std::bad_alloc();
+		overflow.push_back(block);
+		uintptr_t aligned = ((uintptr_t)block + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		return (void*)aligned;
+	}
+
+	template <typename T>
+	T* allocate(size_t count) {
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// Start a new frame, everything allocated so far becomes invalid. No destructors are run.
+	void reset() {
+		peakBytes = std::max(peakBytes, offset + overflowBytes);
+		if (!overflow.empty()) {
+			for (void* block : overflow)
+				free(block);
+			overflow.clear();
+			free(base);
+			base = NULL;	// grow() may throw, the destructor must not free it again
+			size = 0;
+			grow(peakBytes);
+		}
+		offset = 0;
+		overflowBytes = 0;
+	}
+
+	size_t used() const { return offset + overflowBytes; }
+	size_t capacity() const { return size; }
+	size_t peak() const { return std::max(peakBytes, used()); }
+
+private:
+	void grow(size_t capacity) {
+		base = static_cast<unsigned char*>(malloc(capacity));
+		if (base == NULL)
+			throw std::bad_alloc();
+		size = capacity;
+	}
+
+	unsigned char* base = NULL;
+	size_t size = 0;
+	size_t offset = 0;
+	size_t overflowBytes = 0;
+	size_t peakBytes = 0;
+	std::vector<void*> overflow;
+};
+
+// Standard allocator over a FrameArena, deallocation is a no-op. Containers using it must not outlive the frame,
+// and should reserve up front: every reallocation leaves the old storage unused until the reset.
+template <typename T>
+struct FrameAllocator {
+	typedef T value_type;
+
+	FrameArena* arena;
+
+	FrameAllocator(FrameArena& arena) : arena(&arena) {}
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return arena->allocate<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U>
+	bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
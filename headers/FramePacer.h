@@ -0,0 +1,153 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <GLFW/glfw3.h>
+
+#include "GLExtensions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+const int FRAME_PACER_HISTORY = 1024;	// Swap intervals kept for the percentiles in the report
+
+enum SwapMode {
+	SWAP_IMMEDIATE,		// No vsync, tears
+	SWAP_VSYNC,			// Waits for the refresh, a missed one costs a whole extra refresh
+	SWAP_ADAPTIVE		// Vsync, but frames that missed the refresh swap at once (EXT_swap_control_tear)
+};
+
+// Paces frames with the swap interval and an optional frame rate cap. Without vsync the cap holds each swap back to
+// its deadline: sleep for most of the wait, then spin the last stretch on a high resolution clock, since sleeps wake
+// late by up to the OS timer resolution. How late they wake is measured as it goes, so the spin stays as short as
+// the platform allows. Every swap to swap interval is recorded for the mean, variance, jitter and percentiles.
+class FramePacer {
+public:
+	double targetFps = 0.0;		// 0 leaves the rate to the swap mode
+	double minSpinMs = 0.2;		// Always spin at least this long before a deadline
+
+	// Needs the context current. Adaptive falls back to plain vsync without the extension.
+	SwapMode setSwapMode(SwapMode wanted, const GLExtensions& ext) {
+		mode = wanted == SWAP_ADAPTIVE && !ext.swapControlTear ? SWAP_VSYNC : wanted;
+		glfwSwapInterval(mode == SWAP_IMMEDIATE ? 0 : mode == SWAP_VSYNC ? 1 : -1);
+		return mode;
+	}
+
+	SwapMode swapMode() const { return mode; }
+
+	// Wait for this frame's deadline, swap, and record the time since the previous swap
+	void swap(GLFWwindow* window) {
+		if (targetFps > 0.0) {
+			Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+			Clock::time_point now = Clock::now();
+			if (next == Clock::time_point() || now > next + period)
+				next = now;		// First frame, or a whole frame behind: start over rather than rush to catch up
+			waitUntil(next);
+			next += period;
+		}
+		glfwSwapBuffers(window);
+		Clock::time_point swapped = Clock::now();
+		if (lastSwap != Clock::time_point())
+			record(milliseconds(swapped - lastSwap));
+		lastSwap = swapped;
+	}
+
+	uint64_t frames() const { return count; }
+	double meanMs() const { return mean; }
+	double varianceMs() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+	double jitterMs() const { return count > 1 ? jitterSum / (count - 1) : 0.0; }		// Mean change between consecutive intervals
+	double minMs() const { return count ? shortest : 0.0; }
+	double maxMs() const { return longest; }
+
+	// Over the last FRAME_PACER_HISTORY intervals, p in [0, 1]
+	double percentileMs(double p) const {
+		size_t n = (size_t)std::min<uint64_t>(count, FRAME_PACER_HISTORY);
+		if (n == 0)
+			return 0.0;
+		std::vector<double> sorted(history, history + n);
+		size_t rank = std::min((size_t)(p * n), n - 1);
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		return sorted[rank];
+	}
+
+	void printReport() const {
+		static const char* modes[] = { "off", "on", "adaptive" };
+		printf("Frame pacing: vsync %s, ", modes[mode]);
+		if (targetFps > 0.0)
+			printf("capped at %.0f fps\n", targetFps);
+		else
+			printf("no cap\n");
+		if (count == 0)
+			return;
+		printf("  %llu frames, %.2f ms mean (%.1f fps), %.3f ms std dev, %.2f / %.2f ms min / max\n",
+			(unsigned long long)count, mean, 1000.0 / mean, std::sqrt(varianceMs()), minMs(), maxMs());
+		printf("  %.2f / %.2f / %.2f ms 50th / 95th / 99th percentile, %.3f ms jitter, %llu hitches (over 1.5x the expected time)\n",
+			percentileMs(0.5), percentileMs(0.95), percentileMs(0.99), jitterMs(), (unsigned long long)hitches);
+		if (targetFps > 0.0)
+			printf("  Waited %.0f ms sleeping and %.0f ms spinning, sleeps woke up to %.2f ms late\n", sleptMs, spunMs, sleepLateMs);
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	static double milliseconds(Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+	void waitUntil(Clock::time_point until) {
+		Clock::time_point now = Clock::now();
+		double spinMs = std::max(sleepLateMs * 1.25, minSpinMs);
+		Clock::time_point wake = until - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(spinMs));
+		if (wake > now) {
+			std::this_thread::sleep_until(wake);
+			Clock::time_point woke = Clock::now();
+			// Worst recent lateness, decaying so one slow wake doesn't keep the spin long for good
+			sleepLateMs = std::max(milliseconds(woke - wake), sleepLateMs * 0.98);
+			sleptMs += milliseconds(woke - now);
+			now = woke;
+		}
+		Clock::time_point spinStart = now;
+		while (now < until) {
+			std::this_thread::yield();
+			now = Clock::now();
+		}
+		spunMs += milliseconds(now - spinStart);
+	}
+
+	void record(double ms) {
+		double expected = targetFps > 0.0 ? 1000.0 / targetFps : mean;
+		if (count > 0 && ms > expected * 1.5)
+			hitches++;
+		if (count > 0)
+			jitterSum += std::fabs(ms - previous);
+		previous = ms;
+		history[count % FRAME_PACER_HISTORY] = ms;
+		count++;
+		double delta = ms - mean;	// Welford, stable over long runs
+		mean += delta / count;
+		m2 += delta * (ms - mean);
+		shortest = std::min(shortest, ms);
+		longest = std::max(longest, ms);
+	}
+
+	SwapMode mode = SWAP_VSYNC;
+	Clock::time_point next;
+	Clock::time_point lastSwap;
+	double sleepLateMs = 0.0;
+	double sleptMs = 0.0;
+	double spunMs = 0.0;
+
+	double history[FRAME_PACER_HISTORY] = {};
+	uint64_t count = 0;
+	uint64_t hitches = 0;
+	double mean = 0.0;
+	double m2 = 0.0;
+	double jitterSum = 0.0;
+	double previous = 0.0;
+	double shortest = 1e30;
+	double longest = 0.0;
+};
+
+#endif
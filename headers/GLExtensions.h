@@ -0,0 +1,129 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#define GL_CONTEXT_FLAG_DEBUG_BIT 0x00000002
+#define GL_DEBUG_SOURCE_API 0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM 0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER 0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY 0x8249
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#define GL_DEBUG_SOURCE_OTHER 0x824B
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#define GL_DEBUG_TYPE_OTHER 0x8251
+#define GL_DEBUG_TYPE_MARKER 0x8268
+#define GL_DEBUG_TYPE_PUSH_GROUP 0x8269
+#define GL_DEBUG_TYPE_POP_GROUP 0x826A
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#define GL_BUFFER 0x82E0
+#define GL_SHADER 0x82E1
+#define GL_PROGRAM 0x82E2
+#endif
+
+// Entry points newer than 3.3, loaded by hand since glad only has the core 3.3 ones
+typedef void (APIENTRYP GLMultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP GLDispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP GLMemoryBarrierProc)(GLbitfield barriers);
+typedef void (APIENTRYP GLBindImageTextureProc)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRY* GLDebugCallback)(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+typedef void (APIENTRYP GLDebugMessageCallbackProc)(GLDebugCallback callback, const void* userParam);
+typedef void (APIENTRYP GLDebugMessageControlProc)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled);
+typedef void (APIENTRYP GLObjectLabelProc)(GLenum identifier, GLuint name, GLsizei length, const GLchar* label);
+typedef void (APIENTRYP GLPushDebugGroupProc)(GLenum source, GLuint id, GLsizei length, const GLchar* message);
+typedef void (APIENTRYP GLPopDebugGroupProc)();
+
+// Optional features beyond the 3.3 core profile glad is generated for.
+// Call load() once the context is current, then check the flags before using a feature.
+struct GLExtensions {
+	int major = 0;
+	int minor = 0;
+
+	bool textureCompressionS3TC = false;	// BC1 / BC3
+	bool textureCompressionBPTC = false;	// BC7
+	bool multiDrawIndirect = false;			// 4.3 or ARB_multi_draw_indirect
+	bool getProgramBinary = false;			// ARB_get_program_binary (core in 4.1)
+	bool computeShader = false;				// 4.3, compute shaders and shader storage buffers
+	bool swapControlTear = false;			// WGL/GLX_EXT_swap_control_tear, glfwSwapInterval(-1) for adaptive vsync
+	bool debugOutput = false;				// 4.3 or KHR_debug, message callback, object labels and debug groups
+
+	GLMultiDrawElementsIndirectProc multiDrawElementsIndirect = NULL;
+	GLDispatchComputeProc dispatchCompute = NULL;
+	GLMemoryBarrierProc memoryBarrier = NULL;
+	GLBindImageTextureProc bindImageTexture = NULL;
+	GLDebugMessageCallbackProc debugMessageCallback = NULL;
+	GLDebugMessageControlProc debugMessageControl = NULL;
+	GLObjectLabelProc objectLabel = NULL;
+	GLPushDebugGroupProc pushDebugGroup = NULL;
+	GLPopDebugGroupProc popDebugGroup = NULL;
+
+	bool atLeast(int wantMajor, int wantMinor) const {
+		return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+	}
+
+	void load() {
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+		textureCompressionS3TC = glfwExtensionSupported("GL_EXT_texture_compression_s3tc") != 0;
+		textureCompressionBPTC = atLeast(4, 2) || glfwExtensionSupported("GL_ARB_texture_compression_bptc") != 0;
+		getProgramBinary = atLeast(4, 1) || glfwExtensionSupported("GL_ARB_get_program_binary") != 0;
+		swapControlTear = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+
+		if (atLeast(4, 3) || glfwExtensionSupported("GL_ARB_multi_draw_indirect"))
+			multiDrawElementsIndirect = (GLMultiDrawElementsIndirectProc)glfwGetProcAddress("glMultiDrawElementsIndirect");
+		multiDrawIndirect = multiDrawElementsIndirect != NULL;
+
+		// Shader storage buffers come with compute in 4.3, the ARB extensions alone are not enough for the shaders here
+		if (atLeast(4, 3)) {
+			dispatchCompute = (GLDispatchComputeProc)glfwGetProcAddress("glDispatchCompute");
+			memoryBarrier = (GLMemoryBarrierProc)glfwGetProcAddress("glMemoryBarrier");
+			bindImageTexture = (GLBindImageTextureProc)glfwGetProcAddress("glBindImageTexture");
+		}
+		computeShader = dispatchCompute != NULL && memoryBarrier != NULL && bindImageTexture != NULL;
+
+		// KHR_debug in a core profile has no suffix on its entry points
+		if (atLeast(4, 3) || glfwExtensionSupported("GL_KHR_debug")) {
+			debugMessageCallback = (GLDebugMessageCallbackProc)glfwGetProcAddress("glDebugMessageCallback");
+			debugMessageControl = (GLDebugMessageControlProc)glfwGetProcAddress("glDebugMessageControl");
+			objectLabel = (GLObjectLabelProc)glfwGetProcAddress("glObjectLabel");
+			pushDebugGroup = (GLPushDebugGroupProc)glfwGetProcAddress("glPushDebugGroup");
+			popDebugGroup = (GLPopDebugGroupProc)glfwGetProcAddress("glPopDebugGroup");
+		}
+		debugOutput = debugMessageCallback && debugMessageControl && objectLabel && pushDebugGroup && popDebugGroup;
+	}
+};
+
+#endif
@@ -0,0 +1,401 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Json.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// glTF 2.0 loading (.gltf with external or embedded buffers, or binary .glb). Vertex data is not touched on
+// the CPU: every referenced bufferView becomes one GL buffer filled straight from the mapped file, and the
+// accessors turn into glVertexAttribPointer calls with their own component type, stride and offset.
+// Attributes are bound like the rest of the renderer: POSITION 0, NORMAL 1, TEXCOORD_0 2.
+
+const uint32_t GLB_MAGIC = 0x46546C67;		// "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+// One primitive placed by a node, ready to draw with glDrawElements / glDrawArrays
+struct GltfDraw {
+	unsigned int vao;
+	GLenum mode;
+	GLsizei count;
+	GLenum indexType;		// 0 when not indexed
+	size_t indexOffset;		// Byte offset into the element buffer
+	glm::mat4 transform;	// Node's world transform
+	glm::vec3 boundsMin;	// Local space, from the POSITION accessor's min / max
+	glm::vec3 boundsMax;
+};
+
+struct GltfModel {
+	std::vector<unsigned int> buffers;
+	std::vector<unsigned int> vaos;
+	std::vector<GltfDraw> draws;
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };	// World space bounds of every draw
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+
+	void draw(const GltfDraw& d) const {
+		glBindVertexArray(d.vao);
+		if (d.indexType)
+			glDrawElements(d.mode, d.count, d.indexType, (void*)d.indexOffset);
+		else
+			glDrawArrays(d.mode, 0, d.count);
+	}
+
+	void release() {
+		if (!vaos.empty())
+			glDeleteVertexArrays((GLsizei)vaos.size(), vaos.data());
+		if (!buffers.empty())
+			glDeleteBuffers((GLsizei)buffers.size(), buffers.data());
+		vaos.clear();
+		buffers.clear();
+		draws.clear();
+	}
+};
+
+inline int gltfComponentCount(const std::string& type) {
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+inline bool gltfDecodeBase64(const std::string& text, size_t start, std::vector<unsigned char>& out) {
+	static signed char table[256];
+	static bool ready = false;
+	if (!ready) {
+		memset(table, -1, sizeof(table));
+		const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (int i = 0; i < 64; i++)
+			table[(unsigned char)alphabet[i]] = (signed char)i;
+		ready = true;
+	}
+	out.clear();
+	out.reserve((text.size() - start) * 3 / 4);
+	uint32_t bits = 0;
+	int count = 0;
+	for (size_t i = start; i < text.size() && text[i] != '='; i++) {
+		int v = table[(unsigned char)text[i]];
+		if (v < 0)
+			return false;
+		bits = (bits << 6) | (uint32_t)v;
+		count += 6;
+		if (count >= 8) {
+			count -= 8;
+			out.push_back((unsigned char)(bits >> count));
+		}
+	}
+	return true;
+}
+
+// Column major 4x4 from a node's matrix, or its translation / rotation (quaternion xyzw) / scale
+inline glm::mat4 gltfNodeTransform(const JsonValue& node) {
+	glm::mat4 m(1.0f);
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.size() == 16) {
+		for (int i = 0; i < 16; i++)
+			m[i / 4][i % 4] = (float)matrix[i].asNumber();
+		return m;
+	}
+	const JsonValue& t = node["translation"];
+	const JsonValue& r = node["rotation"];
+	const JsonValue& s = node["scale"];
+	float x = (float)r[0].asNumber(), y = (float)r[1].asNumber(), z = (float)r[2].asNumber(), w = (float)r[3].asNumber(1.0);
+	float sx = (float)s[0].asNumber(1.0), sy = (float)s[1].asNumber(1.0), sz = (float)s[2].asNumber(1.0);
+	m[0] = glm::vec4((1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + z * w) * sx, 2.0f * (x * z - y * w) * sx, 0.0f);
+	m[1] = glm::vec4(2.0f * (x * y - z * w) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + x * w) * sy, 0.0f);
+	m[2] = glm::vec4(2.0f * (x * z + y * w) * sz, 2.0f * (y * z - x * w) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f);
+	m[3] = glm::vec4((float)t[0].asNumber(), (float)t[1].asNumber(), (float)t[2].asNumber(), 1.0f);
+	return m;
+}
+
+class GltfLoader {
+public:
+	bool load(const char* path, GltfModel& model, MeshLoadStats* stats = NULL) {
+		auto start = std::chrono::steady_clock::now();
+		model.release();
+		totalBytes = 0;
+		triangles = 0;
+
+		MappedFile& file = mapFile(path);
+		if (!file.isOpen()) {
+			std::cout << "Failed to open mesh " << path << std::endl;
+			return false;
+		}
+		std::string base = path;
+		size_t slash = base.find_last_of("/\\");
+		base = slash == std::string::npos ? std::string() : base.substr(0, slash + 1);
+
+		// A .glb is a header followed by a JSON chunk and an optional binary chunk, a .gltf is JSON only
+		const char* json = (const char*)file.data();
+		size_t jsonSize = file.size();
+		const unsigned char* glbBin = NULL;
+		size_t glbBinSize = 0;
+		if (file.size() >= 20 && readU32(file.data()) == GLB_MAGIC) {
+			size_t offset = 12;
+			json = NULL;
+			while (offset + 8 <= file.size()) {
+				uint32_t length = readU32(file.data() + offset);
+				uint32_t type = readU32(file.data() + offset + 4);
+				if (offset + 8 + length > file.size())
+					break;
+				if (type == GLB_CHUNK_JSON && json == NULL) {
+					json = (const char*)file.data() + offset + 8;
+					jsonSize = length;
+				}
+				else if (type == GLB_CHUNK_BIN && glbBin == NULL) {
+					glbBin = file.data() + offset + 8;
+					glbBinSize = length;
+				}
+				offset += 8 + ((length + 3) & ~3u);
+			}
+			if (json == NULL) {
+				std::cout << "ERROR::GLTF::MISSING_JSON_CHUNK " << path << std::endl;
+				return false;
+			}
+		}
+		JsonValue doc;
+		if (!JsonValue::parse(json, json + jsonSize, doc)) {
+			std::cout << "ERROR::GLTF::INVALID_JSON " << path << std::endl;
+			return false;
+		}
+
+		// Resolve every buffer to a pointer: the GLB chunk, a base64 data URI, or a mapped external file
+		const JsonValue& buffers = doc["buffers"];
+		bufferData.assign(buffers.size(), NULL);
+		bufferSize.assign(buffers.size(), 0);
+		for (size_t i = 0; i < buffers.size(); i++) {
+			const std::string& uri = buffers[i]["uri"].asString();
+			if (uri.empty()) {
+				bufferData[i] = glbBin;
+				bufferSize[i] = glbBinSize;
+			}
+			else if (uri.compare(0, 5, "data:") == 0) {
+				size_t comma = uri.find(',');
+				decoded.emplace_back(new std::vector<unsigned char>());
+				if (comma == std::string::npos || !gltfDecodeBase64(uri, comma + 1, *decoded.back())) {
+					std::cout << "ERROR::GLTF::INVALID_DATA_URI " << path << std::endl;
+					return false;
+				}
+				bufferData[i] = decoded.back()->data();
+				bufferSize[i] = decoded.back()->size();
+			}
+			else {
+				MappedFile& external = mapFile((base + uri).c_str());
+				if (!external.isOpen()) {
+					std::cout << "Failed to open buffer " << base + uri << std::endl;
+					return false;
+				}
+				bufferData[i] = external.data();
+				bufferSize[i] = external.size();
+			}
+		}
+
+		// GL buffers are created lazily, only for the views a primitive actually reads
+		viewBuffers.assign(doc["bufferViews"].size(), 0);
+		meshes.assign(doc["meshes"].size(), std::vector<GltfDraw>());
+		for (size_t m = 0; m < meshes.size(); m++) {
+			const JsonValue& primitives = doc["meshes"][m]["primitives"];
+			for (size_t p = 0; p < primitives.size(); p++) {
+				GltfDraw draw;
+				if (createPrimitive(doc, primitives[p], model, draw))
+					meshes[m].push_back(draw);
+			}
+		}
+
+		// Flatten the node hierarchy of the default scene, or draw every mesh once when there is none
+		const JsonValue& scenes = doc["scenes"];
+		const JsonValue& scene = scenes[(size_t)doc["scene"].asInt(0)];
+		if (scene.isNull()) {
+			for (size_t m = 0; m < meshes.size(); m++)
+				addMesh(model, m, glm::mat4(1.0f));
+		}
+		else {
+			const JsonValue& roots = scene["nodes"];
+			for (size_t i = 0; i < roots.size(); i++)
+				addNode(doc, model, roots[i].asInt(-1), glm::mat4(1.0f), 0);
+		}
+
+		if (stats) {
+			stats->bytes = totalBytes;
+			stats->triangles = triangles;
+			stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		files.clear();
+		decoded.clear();
+		return true;
+	}
+
+private:
+	static uint32_t readU32(const unsigned char* p) {
+		uint32_t v;
+		memcpy(&v, p, 4);
+		return v;
+	}
+
+	MappedFile& mapFile(const char* path) {
+		files.emplace_back(new MappedFile());
+		if (files.back()->open(path))
+			totalBytes += files.back()->size();
+		return *files.back();
+	}
+
+	// GL buffer holding a whole bufferView, uploaded the first time any accessor uses it
+	unsigned int viewBuffer(const JsonValue& doc, int index, GltfModel& model) {
+		if (index < 0 || (size_t)index >= viewBuffers.size())
+			return 0;
+		if (viewBuffers[index])
+			return viewBuffers[index];
+
+		const JsonValue& view = doc["bufferViews"][(size_t)index];
+		size_t buffer = (size_t)view["buffer"].asInt(-1);
+		size_t offset = (size_t)view["byteOffset"].asNumber();
+		size_t length = (size_t)view["byteLength"].asNumber();
+		if (buffer >= bufferData.size() || bufferData[buffer] == NULL || offset + length > bufferSize[buffer]) {
+			std::cout << "ERROR::GLTF::BUFFER_VIEW_OUT_OF_RANGE " << index << std::endl;
+			return 0;
+		}
+		// Buffer objects are typeless, the copy target works for vertex and index data alike
+		unsigned int id;
+		glGenBuffers(1, &id);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+		glBufferData(GL_COPY_WRITE_BUFFER, length, bufferData[buffer] + offset, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		model.buffers.push_back(id);
+		viewBuffers[index] = id;
+		return id;
+	}
+
+	// Point a vertex attribute at an accessor, returns its element count (0 if unusable)
+	size_t bindAttribute(const JsonValue& doc, int accessorIndex, int location, GltfModel& model) {
+		const JsonValue& accessor = doc["accessors"][(size_t)accessorIndex];
+		if (accessor.isNull() || accessor.has("sparse") || !accessor.has("bufferView"))
+			return 0;
+		unsigned int buffer = viewBuffer(doc, accessor["bufferView"].asInt(), model);
+		if (buffer == 0)
+			return 0;
+		const JsonValue& view = doc["bufferViews"][(size_t)accessor["bufferView"].asInt()];
+		GLenum componentType = (GLenum)accessor["componentType"].asInt(GL_FLOAT);
+		int components = gltfComponentCount(accessor["type"].asString());
+		if (components == 0)
+			return 0;
+		GLsizei stride = view["byteStride"].asInt(0);	// 0 means tightly packed for both glTF and GL
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glVertexAttribPointer(location, components, componentType, accessor["normalized"].asBool() ? GL_TRUE : GL_FALSE, stride,
+			(void*)(size_t)accessor["byteOffset"].asNumber());
+		glEnableVertexAttribArray(location);
+		return (size_t)accessor["count"].asNumber();
+	}
+
+	bool createPrimitive(const JsonValue& doc, const JsonValue& primitive, GltfModel& model, GltfDraw& draw) {
+		const JsonValue& attributes = primitive["attributes"];
+		if (!attributes.has("POSITION"))
+			return false;
+
+		unsigned int vao;
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		model.vaos.push_back(vao);
+
+		size_t vertexCount = bindAttribute(doc, attributes["POSITION"].asInt(), 0, model);
+		if (vertexCount == 0) {
+			glBindVertexArray(0);
+			return false;
+		}
+		if (attributes.has("NORMAL"))
+			bindAttribute(doc, attributes["NORMAL"].asInt(), 1, model);
+		else
+			glVertexAttrib3f(1, 0.0f, 1.0f, 0.0f);	// Constant up normal, glTF says to use flat normals but they need the triangles
+		if (attributes.has("TEXCOORD_0"))
+			bindAttribute(doc, attributes["TEXCOORD_0"].asInt(), 2, model);
+
+		const JsonValue& position = doc["accessors"][(size_t)attributes["POSITION"].asInt()];
+		for (int c = 0; c < 3; c++) {
+			draw.boundsMin[c] = (float)position["min"][c].asNumber();
+			draw.boundsMax[c] = (float)position["max"][c].asNumber();
+		}
+		draw.vao = vao;
+		draw.mode = (GLenum)primitive["mode"].asInt(GL_TRIANGLES);
+		draw.count = (GLsizei)vertexCount;
+		draw.indexType = 0;
+		draw.indexOffset = 0;
+		if (primitive.has("indices")) {
+			const JsonValue& accessor = doc["accessors"][(size_t)primitive["indices"].asInt()];
+			unsigned int buffer = accessor.has("bufferView") ? viewBuffer(doc, accessor["bufferView"].asInt(), model) : 0;
+			if (buffer == 0) {
+				glBindVertexArray(0);
+				return false;
+			}
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);	// Recorded in the VAO
+			draw.indexType = (GLenum)accessor["componentType"].asInt(GL_UNSIGNED_INT);
+			draw.indexOffset = (size_t)accessor["byteOffset"].asNumber();
+			draw.count = (GLsizei)accessor["count"].asNumber();
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return true;
+	}
+
+	void addMesh(GltfModel& model, size_t mesh, const glm::mat4& transform) {
+		for (GltfDraw draw : meshes[mesh]) {
+			draw.transform = transform;
+			if (draw.mode == GL_TRIANGLES)
+				triangles += draw.count / 3;
+			else if (draw.mode == GL_TRIANGLE_STRIP || draw.mode == GL_TRIANGLE_FAN)
+				triangles += draw.count > 2 ? draw.count - 2 : 0;
+			// Grow the model bounds by the transformed corners of the primitive's box
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec4 p = transform * glm::vec4(corner & 1 ? draw.boundsMax.x : draw.boundsMin.x, corner & 2 ? draw.boundsMax.y : draw.boundsMin.y,
+					corner & 4 ? draw.boundsMax.z : draw.boundsMin.z, 1.0f);
+				for (int c = 0; c < 3; c++) {
+					bool first = model.draws.empty() && corner == 0;
+					model.boundsMin[c] = first || p[c] < model.boundsMin[c] ? p[c] : model.boundsMin[c];
+					model.boundsMax[c] = first || p[c] > model.boundsMax[c] ? p[c] : model.boundsMax[c];
+				}
+			}
+			model.draws.push_back(draw);
+		}
+	}
+
+	void addNode(const JsonValue& doc, GltfModel& model, int index, const glm::mat4& parent, int depth) {
+		const JsonValue& node = doc["nodes"][(size_t)index];
+		if (index < 0 || node.isNull() || depth > 64)
+			return;
+		glm::mat4 world = parent * gltfNodeTransform(node);
+		size_t mesh = (size_t)node["mesh"].asInt(-1);
+		if (mesh < meshes.size())
+			addMesh(model, mesh, world);
+		const JsonValue& children = node["children"];
+		for (size_t i = 0; i < children.size(); i++)
+			addNode(doc, model, children[i].asInt(-1), world, depth + 1);
+	}
+
+	std::vector<std::unique_ptr<MappedFile>> files;
+	std::vector<std::unique_ptr<std::vector<unsigned char>>> decoded;
+	std::vector<const unsigned char*> bufferData;
+	std::vector<size_t> bufferSize;
+	std::vector<unsigned int> viewBuffers;
+	std::vector<std::vector<GltfDraw>> meshes;
+	size_t totalBytes = 0;
+	size_t triangles = 0;
+};
+
+// Load a .gltf / .glb straight into GL buffers
+inline bool loadGltf(const char* path, GltfModel& model, MeshLoadStats* stats = NULL) {
+	GltfLoader loader;
+	return loader.load(path, model, stats);
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+const int GPU_TIMER_FRAMES = 4;		// Measurements that may be in flight, results lag this many frames at most
+
+// Measures GPU time between begin() and end() with a pair of GL_TIMESTAMP queries, so timers may nest or overlap
+// (GL_TIME_ELAPSED queries can't). Results are collected without waiting on the GPU: a frame whose queries are all
+// still in flight simply goes unmeasured.
+class GpuTimer {
+public:
+	~GpuTimer() { release(); }
+
+	void init() {
+		release();
+		glGenQueries(GPU_TIMER_FRAMES * 2, queries);
+		first = pending = 0;
+		active = false;
+	}
+
+	void release() {
+		if (queries[0])
+			glDeleteQueries(GPU_TIMER_FRAMES * 2, queries);
+		queries[0] = 0;
+	}
+
+	void begin() {
+		poll();
+		active = queries[0] && pending < GPU_TIMER_FRAMES;
+		if (active)
+			glQueryCounter(queries[slot() * 2], GL_TIMESTAMP);
+	}
+
+	void end() {
+		if (!active)
+			return;
+		glQueryCounter(queries[slot() * 2 + 1], GL_TIMESTAMP);
+		pending++;
+		active = false;
+	}
+
+	// Collect finished measurements, true when a new one arrived
+	bool poll() {
+		bool arrived = false;
+		while (pending > 0) {
+			GLint available = 0;
+			glGetQueryObjectiv(queries[first * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				break;
+			GLuint64 start = 0, stop = 0;
+			glGetQueryObjectui64v(queries[first * 2], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(queries[first * 2 + 1], GL_QUERY_RESULT, &stop);
+			lastMs = (stop - start) / 1e6;
+			totalMs += lastMs;
+			samples++;
+			first = (first + 1) % GPU_TIMER_FRAMES;
+			pending--;
+			arrived = true;
+		}
+		return arrived;
+	}
+
+	double last() const { return lastMs; }
+	double average() const { return samples ? totalMs / samples : 0.0; }
+	uint64_t count() const { return samples; }
+
+private:
+	int slot() const { return (first + pending) % GPU_TIMER_FRAMES; }
+
+	unsigned int queries[GPU_TIMER_FRAMES * 2] = {};
+	int first = 0;
+	int pending = 0;
+	bool active = false;
+	double lastMs = 0.0;
+	double totalMs = 0.0;
+	uint64_t samples = 0;
+};
+
+#endif
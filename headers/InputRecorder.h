@@ -0,0 +1,348 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <GLFW/glfw3.h>
+
+#include "camera.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+enum InputMode { INPUT_LIVE, INPUT_RECORD, INPUT_REPLAY };
+
+enum InputEventType : uint8_t { INPUT_CURSOR, INPUT_SCROLL };
+
+struct InputEvent {
+	InputEventType type;
+	float x;	// Cursor position, or the scroll offset in y
+	float y;
+};
+
+// Keys processInput polls, bit i of a frame's key mask is INPUT_KEYS[i]
+const int INPUT_KEYS[] = {
+	GLFW_KEY_ESCAPE, GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D,
+	GLFW_KEY_SPACE, GLFW_KEY_LEFT_CONTROL, GLFW_KEY_LEFT_SHIFT
+};
+const int INPUT_KEY_COUNT = sizeof(INPUT_KEYS) / sizeof(*INPUT_KEYS);
+
+const uint32_t INPUT_LOG_MAGIC = 0x4E49474C;	// "LGIN"
+const uint32_t INPUT_LOG_VERSION = 1;
+
+// Records a session's input (polled keys, cursor and scroll events, frame deltaTime) to a compact binary log and
+// plays it back. Values are stored as the floats the camera receives, so a replay feeds Camera the same bits in the
+// same order and ends in exactly the recorded state, which is checked against the state stored at the end of the log.
+//
+// Log: magic, version, starting camera state, then per frame a flags byte (1 keys changed, 2 has events, 4 end),
+// deltaTime, the key mask when it changed, and a varint event count with the events. The end marker is followed
+// by the final camera state. An idle frame takes 5 bytes.
+class InputRecorder {
+public:
+	~InputRecorder() { close(); }
+
+	bool startRecording(const char* path, const Camera& camera) {
+		file = fopen(path, "wb");
+		if (!file) {
+			std::cout << "ERROR::INPUT_RECORDER::FILE_NOT_WRITTEN " << path << std::endl;
+			return false;
+		}
+		reset();
+		put(INPUT_LOG_MAGIC);
+		put(INPUT_LOG_VERSION);
+		putCamera(camera);
+		flush();
+		inputMode = INPUT_RECORD;
+		return true;
+	}
+
+	// Loads the whole log and puts the camera in its starting state
+	bool startReplay(const char* path, Camera& camera) {
+		FILE* in = fopen(path, "rb");
+		if (!in) {
+			std::cout << "ERROR::INPUT_RECORDER::FILE_NOT_READ " << path << std::endl;
+			return false;
+		}
+		reset();
+		uint8_t chunk[65536];
+		size_t read;
+		while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0)
+			bytes.insert(bytes.end(), chunk, chunk + read);
+		fclose(in);
+		cursor = 0;
+		uint32_t magic = 0, version = 0;
+		if (!get(magic) || !get(version) || magic != INPUT_LOG_MAGIC || version != INPUT_LOG_VERSION || !getCamera(camera)) {
+			std::cout << "ERROR::INPUT_RECORDER::BAD_LOG " << path << std::endl;
+			return false;
+		}
+		inputMode = INPUT_REPLAY;
+		replayCamera = &camera;
+		return true;
+	}
+
+	InputMode mode() const { return inputMode; }
+	bool replaying() const { return inputMode == INPUT_REPLAY; }
+	double time() const { return elapsed; }		// Sum of the frame deltas so far, the session clock while recording or replaying
+	uint64_t frames() const { return frameCount; }
+
+	// Start a frame. Recording stores deltaTime, replay replaces it with the recorded one. Returns false once a
+	// replay has run out of frames.
+	bool beginFrame(float& deltaTime) {
+		if (inputMode == INPUT_RECORD) {
+			writeFrame(false);
+			frameDelta = deltaTime;
+			frameKeys = 0;
+			frameEvents.clear();
+		}
+		else if (inputMode == INPUT_REPLAY) {
+			// The rest of the last frame still runs, with no keys held, no events and the last recorded delta
+			if (finished || !readFrame()) {
+				finished = true;
+				frameKeys = 0;
+				frameEvents.clear();
+				deltaTime = frameDelta;
+				return false;
+			}
+			deltaTime = frameDelta;
+		}
+		else
+			return true;
+		elapsed += frameDelta;
+		frameCount++;
+		return true;
+	}
+
+	// glfwGetKey for processInput
+	int getKey(GLFWwindow* window, int key) {
+		int bit = keyBit(key);
+		if (inputMode == INPUT_REPLAY && bit >= 0)
+			return (frameKeys >> bit) & 1 ? GLFW_PRESS : GLFW_RELEASE;
+		int state = glfwGetKey(window, key);
+		if (inputMode == INPUT_RECORD && bit >= 0 && state == GLFW_PRESS)
+			frameKeys |= 1u << bit;
+		return state;
+	}
+
+	// First thing in the cursor and scroll callbacks: records live events, false for live ones a replay ignores
+	bool cursorEvent(double x, double y) { return event(INPUT_CURSOR, (float)x, (float)y); }
+	bool scrollEvent(double yOffset) { return event(INPUT_SCROLL, (float)yOffset, 0.0f); }
+
+	// Replay this frame's events through the callbacks, where glfwPollEvents would have called them
+	void dispatch(GLFWwindow* window, GLFWcursorposfun cursorCallback, GLFWscrollfun scrollCallback) {
+		if (inputMode != INPUT_REPLAY)
+			return;
+		dispatching = true;
+		for (const InputEvent& e : frameEvents) {
+			if (e.type == INPUT_CURSOR)
+				cursorCallback(window, e.x, e.y);
+			else
+				scrollCallback(window, 0.0, e.x);
+		}
+		dispatching = false;
+	}
+
+	// Recording writes the last frame and the final camera, replay reports whether it ended where the recording did
+	void finish(const Camera& camera) {
+		if (inputMode == INPUT_RECORD) {
+			writeFrame(true);
+			putCamera(camera);
+			flush();
+			printf("Input recorded: %llu frames, %zu bytes\n", (unsigned long long)frameCount, recordedBytes);
+		}
+		else if (inputMode == INPUT_REPLAY) {
+			if (!finished)
+				printf("Input replay stopped early after %llu frames\n", (unsigned long long)frameCount);
+			else if (matched)
+				printf("Input replayed: %llu frames, camera matches the recording bit for bit\n", (unsigned long long)frameCount);
+			else
+				std::cout << "ERROR::INPUT_RECORDER::REPLAY_DIVERGED after " << frameCount << " frames" << std::endl;
+		}
+		close();
+	}
+
+private:
+	static int keyBit(int key) {
+		for (int i = 0; i < INPUT_KEY_COUNT; i++) {
+			if (INPUT_KEYS[i] == key)
+				return i;
+		}
+		return -1;
+	}
+
+	bool event(InputEventType type, float x, float y) {
+		if (inputMode == INPUT_REPLAY)
+			return dispatching;
+		if (inputMode == INPUT_RECORD)
+			frameEvents.push_back(InputEvent{ type, x, y });
+		return true;
+	}
+
+	void writeFrame(bool end) {
+		if (frameCount > 0) {
+			uint8_t flags = (frameKeys != writtenKeys ? 1 : 0) | (frameEvents.empty() ? 0 : 2);
+			put(flags);
+			put(frameDelta);
+			if (flags & 1)
+				put((uint16_t)frameKeys);
+			if (flags & 2) {
+				putVarint(frameEvents.size());
+				for (const InputEvent& e : frameEvents) {
+					put((uint8_t)e.type);
+					put(e.x);
+					if (e.type == INPUT_CURSOR)
+						put(e.y);
+				}
+			}
+			writtenKeys = frameKeys;
+		}
+		if (end)
+			put((uint8_t)4);
+		flush();
+	}
+
+	// A frame is only taken once it was read whole, a truncated log keeps the last complete one
+	bool readFrame() {
+		uint8_t flags = 0;
+		if (!get(flags) || (flags & 4)) {
+			Camera recorded(0, 0);
+			matched = (flags & 4) && getCamera(recorded) && sameState(recorded, *replayCamera);
+			return false;
+		}
+		float delta = 0.0f;
+		uint16_t keys = (uint16_t)frameKeys;
+		if (!get(delta) || ((flags & 1) && !get(keys)))
+			return false;
+		readEvents.clear();
+		if (flags & 2) {
+			uint64_t count = 0;
+			if (!getVarint(count))
+				return false;
+			for (uint64_t i = 0; i < count; i++) {
+				InputEvent e = {};
+				uint8_t type = 0;
+				if (!get(type) || !get(e.x) || (type == INPUT_CURSOR && !get(e.y)))
+					return false;
+				e.type = (InputEventType)type;
+				readEvents.push_back(e);
+			}
+		}
+		frameDelta = delta;
+		frameKeys = keys;
+		frameEvents.swap(readEvents);
+		return true;
+	}
+
+	// Front, Right and Up follow from the angles, so these fields are the whole state
+	void putCamera(const Camera& camera) {
+		put(camera.Position.x);
+		put(camera.Position.y);
+		put(camera.Position.z);
+		put(camera.Yaw);
+		put(camera.Pitch);
+		put(camera.Zoom);
+		put(camera.lastX);
+		put(camera.lastY);
+		put(camera.MovementSpeed);
+		put(camera.MouseSensitivity);
+		put((uint8_t)camera.boost);
+	}
+
+	bool getCamera(Camera& camera) {
+		float yaw = 0.0f, pitch = 0.0f;
+		uint8_t boost = 0;
+		bool ok = get(camera.Position.x) && get(camera.Position.y) && get(camera.Position.z) && get(yaw) && get(pitch) &&
+			get(camera.Zoom) && get(camera.lastX) && get(camera.lastY) && get(camera.MovementSpeed) && get(camera.MouseSensitivity) && get(boost);
+		camera.boost = boost != 0;
+		camera.SetOrientation(yaw, pitch);
+		return ok;
+	}
+
+	static bool sameState(const Camera& a, const Camera& b) {
+		return memcmp(&a.Position, &b.Position, sizeof(a.Position)) == 0 && memcmp(&a.Front, &b.Front, sizeof(a.Front)) == 0 &&
+			memcmp(&a.Yaw, &b.Yaw, sizeof(float)) == 0 && memcmp(&a.Pitch, &b.Pitch, sizeof(float)) == 0 &&
+			memcmp(&a.Zoom, &b.Zoom, sizeof(float)) == 0 && a.boost == b.boost;
+	}
+
+	// Host byte order, logs are replayed on the machine type that recorded them
+	template <typename T>
+	void put(const T& value) {
+		const uint8_t* p = (const uint8_t*)&value;
+		bytes.insert(bytes.end(), p, p + sizeof(T));
+	}
+
+	void putVarint(uint64_t value) {
+		do {
+			uint8_t b = value & 0x7F;
+			value >>= 7;
+			put((uint8_t)(b | (value ? 0x80 : 0)));
+		} while (value);
+	}
+
+	template <typename T>
+	bool get(T& value) {
+		if (cursor + sizeof(T) > bytes.size())
+			return false;
+		memcpy(&value, bytes.data() + cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	bool getVarint(uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t b = 0;
+			if (!get(b))
+				return false;
+			value |= (uint64_t)(b & 0x7F) << shift;
+			if (!(b & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	void flush() {
+		if (file && !bytes.empty()) {
+			fwrite(bytes.data(), 1, bytes.size(), file);
+			recordedBytes += bytes.size();
+		}
+		bytes.clear();
+	}
+
+	void reset() {
+		bytes.clear();
+		cursor = recordedBytes = 0;
+		frameDelta = 0.0f;
+		frameKeys = writtenKeys = 0;
+		frameEvents.clear();
+		frameCount = 0;
+		elapsed = 0.0;
+		finished = matched = false;
+	}
+
+	void close() {
+		if (file)
+			fclose(file);
+		file = NULL;
+		inputMode = INPUT_LIVE;
+	}
+
+	InputMode inputMode = INPUT_LIVE;
+	FILE* file = NULL;
+	std::vector<uint8_t> bytes;		// Pending writes while recording, the whole log while replaying
+	size_t cursor = 0;
+	size_t recordedBytes = 0;
+	float frameDelta = 0.0f;
+	uint32_t frameKeys = 0;
+	uint32_t writtenKeys = 0;
+	std::vector<InputEvent> frameEvents;
+	std::vector<InputEvent> readEvents;		// Replay decodes into this, swapped in once the frame is complete
+	uint64_t frameCount = 0;
+	double elapsed = 0.0;
+	bool dispatching = false;
+	bool finished = false;
+	bool matched = false;
+	Camera* replayCamera = NULL;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal JSON document tree, enough for asset descriptions such as glTF. Numbers are kept as doubles.
+class JsonValue {
+public:
+	enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+	JsonValue() : type(NUL), number(0.0) {}
+
+	Type getType() const { return type; }
+	bool isNull() const { return type == NUL; }
+	bool isObject() const { return type == OBJECT; }
+	bool isArray() const { return type == ARRAY; }
+	bool isNumber() const { return type == NUMBER; }
+	bool isString() const { return type == STRING; }
+
+	size_t size() const { return type == ARRAY ? items.size() : (type == OBJECT ? members.size() : 0); }
+	bool has(const std::string& key) const { return type == OBJECT && members.count(key) != 0; }
+
+	// Missing members and out of range items return a shared null value, so lookups can be chained
+	const JsonValue& operator[](const std::string& key) const {
+		if (type == OBJECT) {
+			auto it = members.find(key);
+			if (it != members.end())
+				return it->second;
+		}
+		return null();
+	}
+	const JsonValue& operator[](size_t index) const { return type == ARRAY && index < items.size() ? items[index] : null(); }
+
+	double asNumber(double fallback = 0.0) const { return type == NUMBER ? number : fallback; }
+	int asInt(int fallback = 0) const { return type == NUMBER ? (int)number : fallback; }
+	bool asBool(bool fallback = false) const { return type == BOOLEAN ? number != 0.0 : fallback; }
+	const std::string& asString() const { static const std::string empty; return type == STRING ? text : empty; }
+
+	// Parse a whole document, returns false (and a null value) on malformed input
+	static bool parse(const char* begin, const char* end, JsonValue& out) {
+		const char* p = begin;
+		out = JsonValue();
+		if (!parseValue(p, end, out, 0))
+			return false;
+		skipSpace(p, end);
+		return p == end || *p == '\0';
+	}
+
+private:
+	static const JsonValue& null() { static const JsonValue value; return value; }
+
+	static void skipSpace(const char*& p, const char* end) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+			p++;
+	}
+
+	static bool match(const char*& p, const char* end, const char* word) {
+		for (const char* w = word; *w; w++, p++) {
+			if (p >= end || *p != *w)
+				return false;
+		}
+		return true;
+	}
+
+	static void appendUtf8(std::string& s, unsigned int c) {
+		if (c < 0x80)
+			s += (char)c;
+		else if (c < 0x800) {
+			s += (char)(0xC0 | (c >> 6));
+			s += (char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000) {
+			s += (char)(0xE0 | (c >> 12));
+			s += (char)(0x80 | ((c >> 6) & 0x3F));
+			s += (char)(0x80 | (c & 0x3F));
+		}
+		else {
+			s += (char)(0xF0 | (c >> 18));
+			s += (char)(0x80 | ((c >> 12) & 0x3F));
+			s += (char)(0x80 | ((c >> 6) & 0x3F));
+			s += (char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	static bool parseHex4(const char*& p, const char* end, unsigned int& c) {
+		c = 0;
+		for (int i = 0; i < 4; i++, p++) {
+			if (p >= end)
+				return false;
+			char h = *p;
+			c <<= 4;
+			if (h >= '0' && h <= '9') c |= h - '0';
+			else if (h >= 'a' && h <= 'f') c |= h - 'a' + 10;
+			else if (h >= 'A' && h <= 'F') c |= h - 'A' + 10;
+			else return false;
+		}
+		return true;
+	}
+
+	static bool parseString(const char*& p, const char* end, std::string& s) {
+		p++;	// Opening quote
+		while (p < end && *p != '"') {
+			if (*p != '\\') {
+				s += *p++;
+				continue;
+			}
+			if (++p >= end)
+				return false;
+			char e = *p++;
+			switch (e) {
+			case 'b': s += '\b'; break;
+			case 'f': s += '\f'; break;
+			case 'n': s += '\n'; break;
+			case 'r': s += '\r'; break;
+			case 't': s += '\t'; break;
+			case 'u': {
+				unsigned int c;
+				if (!parseHex4(p, end, c))
+					return false;
+				if (c >= 0xD800 && c < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+					p += 2;
+					unsigned int low;
+					if (!parseHex4(p, end, low))
+						return false;
+					c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(s, c);
+				break;
+			}
+			default: s += e; break;
+			}
+		}
+		if (p >= end)
+			return false;
+		p++;
+		return true;
+	}
+
+	static bool parseValue(const char*& p, const char* end, JsonValue& out, int depth) {
+		if (depth > 256)
+			return false;
+		skipSpace(p, end);
+		if (p >= end)
+			return false;
+
+		switch (*p) {
+		case '{':
+			out.type = OBJECT;
+			p++;
+			skipSpace(p, end);
+			if (p < end && *p == '}') {
+				p++;
+				return true;
+			}
+			for (;;) {
+				skipSpace(p, end);
+				std::string key;
+				if (p >= end || *p != '"' || !parseString(p, end, key))
+					return false;
+				skipSpace(p, end);
+				if (p >= end || *p++ != ':')
+					return false;
+				if (!parseValue(p, end, out.members[key], depth + 1))
+					return false;
+				skipSpace(p, end);
+				if (p < end && *p == ',') {
+					p++;
+					continue;
+				}
+				if (p < end && *p == '}') {
+					p++;
+					return true;
+				}
+				return false;
+			}
+		case '[':
+			out.type = ARRAY;
+			p++;
+			skipSpace(p, end);
+			if (p < end && *p == ']') {
+				p++;
+				return true;
+			}
+			for (;;) {
+				out.items.emplace_back();
+				if (!parseValue(p, end, out.items.back(), depth + 1))
+					return false;
+				skipSpace(p, end);
+				if (p < end && *p == ',') {
+					p++;
+					continue;
+				}
+				if (p < end && *p == ']') {
+					p++;
+					return true;
+				}
+				return false;
+			}
+		case '"':
+			out.type = STRING;
+			return parseString(p, end, out.text);
+		case 't':
+			out.type = BOOLEAN;
+			out.number = 1.0;
+			return match(p, end, "true");
+		case 'f':
+			out.type = BOOLEAN;
+			return match(p, end, "false");
+		case 'n':
+			return match(p, end, "null");
+		default: {
+			// strtod needs a terminated string, numbers are short so copy them out
+			char buffer[64];
+			size_t n = 0;
+			while (p < end && n + 1 < sizeof(buffer) && isNumberChar(*p))
+				buffer[n++] = *p++;
+			buffer[n] = '\0';
+			char* parsedEnd;
+			out.number = strtod(buffer, &parsedEnd);
+			out.type = NUMBER;
+			return n > 0 && parsedEnd == buffer + n;
+		}
+		}
+	}
+
+	static bool isNumberChar(char c) {
+		return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+	}
+
+	Type type;
+	double number;
+	std::string text;
+	std::vector<JsonValue> items;
+	std::map<std::string, JsonValue> members;
+};
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef LIGHT_MANAGER_H
+#define LIGHT_MANAGER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Meshlet.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LIGHTS_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHTS_USE_SSE2
+#endif
+
+// Lights a single draw is shaded with at most, the size of lightIndices[] in lighting.fs
+const int LIGHTS_PER_OBJECT = 8;
+const int LIGHT_TEXELS = 3;		// RGBA32F texels per light in the light buffer
+
+enum LightType {
+	LIGHT_POINT,
+	LIGHT_SPOT,
+	LIGHT_DIRECTIONAL
+};
+
+struct Light {
+	LightType type = LIGHT_POINT;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);	// Spot and directional, the way the light travels
+	glm::vec3 color = glm::vec3(1.0f);
+	float intensity = 1.0f;
+	float range = 10.0f;			// Point and spot: inverse square falloff windowed to reach exactly zero here
+	float innerAngle = 20.0f;		// Spot cone half angles in degrees, full intensity inside inner, none past outer
+	float outerAngle = 30.0f;
+};
+
+// Inverse square falloff with a smooth window that reaches zero at range (the Frostbite / UE4 form),
+// lighting.fs evaluates the same expression
+inline float lightAttenuation(float distanceSquared, float range) {
+	float ratio = distanceSquared / (range * range);
+	float window = std::min(std::max(1.0f - ratio * ratio, 0.0f), 1.0f);
+	return window * window / std::max(distanceSquared, 1e-4f);
+}
+
+// Holds every light as structure of arrays, mirrors them into a texture buffer the lighting shader indexes,
+// culls them against the frustum each frame and hands each draw the few lights that reach it. Shading cost
+// follows LIGHTS_PER_OBJECT rather than the number of lights in the scene.
+class LightManager {
+public:
+	~LightManager() { release(); }
+
+	void init() {
+		release();
+		glGenBuffers(1, &buffer);
+		glGenTextures(1, &texture);
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, LIGHT_TEXELS * 16, NULL, GL_DYNAMIC_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	void release() {
+		if (texture)
+			glDeleteTextures(1, &texture);
+		if (buffer)
+			glDeleteBuffers(1, &buffer);
+		texture = buffer = 0;
+		capacity = 0;
+	}
+
+	uint32_t add(const Light& light) {
+		uint32_t id = (uint32_t)type.size();
+		type.push_back(light.type);
+		for (std::vector<float>* array : { &posX, &posY, &posZ, &cullRadius, &range, &dirX, &dirY, &dirZ, &red, &green, &blue, &angleScale, &angleOffset })
+			array->push_back(0.0f);
+		set(id, light);
+		return id;
+	}
+
+	void set(uint32_t id, const Light& light) {
+		type[id] = light.type;
+		posX[id] = light.position.x;
+		posY[id] = light.position.y;
+		posZ[id] = light.position.z;
+		range[id] = light.type == LIGHT_DIRECTIONAL ? 0.0f : light.range;
+		cullRadius[id] = light.type == LIGHT_DIRECTIONAL ? FLT_MAX : light.range;	// Directional lights pass every plane
+		glm::vec3 direction = glm::normalize(light.direction);
+		dirX[id] = direction.x;
+		dirY[id] = direction.y;
+		dirZ[id] = direction.z;
+		red[id] = light.color.x * light.intensity;
+		green[id] = light.color.y * light.intensity;
+		blue[id] = light.color.z * light.intensity;
+		// Spot falloff as saturate(cos * scale + offset), a point light gets a factor of 1 everywhere
+		float cosOuter = std::cos(glm::radians(light.outerAngle));
+		float cosInner = std::cos(glm::radians(std::min(light.innerAngle, light.outerAngle)));
+		angleScale[id] = light.type == LIGHT_SPOT ? 1.0f / std::max(cosInner - cosOuter, 1e-3f) : 0.0f;
+		angleOffset[id] = light.type == LIGHT_SPOT ? -cosOuter * angleScale[id] : 1.0f;
+		dirty = true;
+	}
+
+	void setPosition(uint32_t id, const glm::vec3& position) {
+		posX[id] = position.x;
+		posY[id] = position.y;
+		posZ[id] = position.z;
+		dirty = true;
+	}
+
+	glm::vec3 position(uint32_t id) const { return glm::vec3(posX[id], posY[id], posZ[id]); }
+	size_t size() const { return type.size(); }
+	size_t visibleCount() const { return visible.size(); }
+
+	// Point the shader's samplerBuffer at a texture unit, once after linking
+	void attach(const Shader& shader, int unit) const {
+		shader.use();
+		shader.setInt("lights", unit);
+	}
+
+	// Mirror changed lights to the GPU and bind the buffer on unit, once per frame
+	void upload(int unit) {
+		if (dirty) {
+			staging.resize(type.size() * LIGHT_TEXELS * 4);
+			for (size_t i = 0; i < type.size(); i++) {
+				float* texels = &staging[i * LIGHT_TEXELS * 4];
+				texels[0] = posX[i]; texels[1] = posY[i]; texels[2] = posZ[i]; texels[3] = range[i];
+				texels[4] = dirX[i]; texels[5] = dirY[i]; texels[6] = dirZ[i]; texels[7] = angleScale[i];
+				texels[8] = red[i]; texels[9] = green[i]; texels[10] = blue[i]; texels[11] = angleOffset[i];
+			}
+			size_t bytes = staging.size() * sizeof(float);
+			glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+			if (bytes > capacity)
+				capacity = bytes * 2;
+			glBufferData(GL_TEXTURE_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);	// Grow or orphan, last frame may still be reading
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, staging.data());
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+			dirty = false;
+		}
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	// Keep the lights whose range sphere touches the frustum of a column major projection * view matrix
+	void cull(const float* viewProjection) {
+		MeshletCullView view;
+		meshletFrustumPlanes(viewProjection, view);
+		visible.clear();
+		size_t count = type.size();
+		size_t i = 0;
+#if defined(LIGHTS_USE_AVX)
+		for (; i + 8 <= count; i += 8) {
+			__m256 x = _mm256_loadu_ps(&posX[i]), y = _mm256_loadu_ps(&posY[i]), z = _mm256_loadu_ps(&posZ[i]);
+			__m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&cullRadius[i]));
+			__m256 keep = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const float* plane = view.planes[p];
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), x), _mm256_mul_ps(_mm256_set1_ps(plane[1]), y)),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[2]), z), _mm256_set1_ps(plane[3])));
+				keep = _mm256_and_ps(keep, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+			}
+			for (int mask = _mm256_movemask_ps(keep), bit = 0; mask; mask >>= 1, bit++) {
+				if (mask & 1)
+					visible.push_back((uint32_t)(i + bit));
+			}
+		}
+#endif
+#if defined(LIGHTS_USE_SSE2) || defined(LIGHTS_USE_AVX)
+		for (; i + 4 <= count; i += 4) {
+			__m128 x = _mm_loadu_ps(&posX[i]), y = _mm_loadu_ps(&posY[i]), z = _mm_loadu_ps(&posZ[i]);
+			__m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&cullRadius[i]));
+			__m128 keep = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const float* plane = view.planes[p];
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), x), _mm_mul_ps(_mm_set1_ps(plane[1]), y)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), z), _mm_set1_ps(plane[3])));
+				keep = _mm_and_ps(keep, _mm_cmpge_ps(d, negR));
+			}
+			for (int mask = _mm_movemask_ps(keep), bit = 0; mask; mask >>= 1, bit++) {
+				if (mask & 1)
+					visible.push_back((uint32_t)(i + bit));
+			}
+		}
+#endif
+		for (; i < count; i++) {
+			bool keep = true;
+			for (int p = 0; p < 6 && keep; p++) {
+				const float* plane = view.planes[p];
+				keep = plane[0] * posX[i] + plane[1] * posY[i] + plane[2] * posZ[i] + plane[3] >= -cullRadius[i];
+			}
+			if (keep)
+				visible.push_back((uint32_t)i);
+		}
+	}
+
+	// The strongest visible lights reaching a bounding sphere, at most LIGHTS_PER_OBJECT. Returns the count.
+	int gather(const glm::vec3& center, float radius, int* indices) const {
+		float scores[LIGHTS_PER_OBJECT];
+		int count = 0;
+		for (uint32_t i : visible) {
+			float brightness = red[i] + green[i] + blue[i];
+			float score;
+			if (type[i] == LIGHT_DIRECTIONAL)
+				score = brightness;
+			else {
+				float dx = posX[i] - center.x, dy = posY[i] - center.y, dz = posZ[i] - center.z;
+				float reach = range[i] + radius;
+				float distanceSquared = dx * dx + dy * dy + dz * dz;
+				if (distanceSquared >= reach * reach)
+					continue;
+				// Judge by the nearest point of the sphere, so lights inside it rank highest
+				float nearest = std::max(std::sqrt(distanceSquared) - radius, 0.0f);
+				score = brightness * lightAttenuation(std::max(nearest * nearest, 1e-2f), range[i]);
+			}
+			if (count == LIGHTS_PER_OBJECT && score <= scores[count - 1])
+				continue;
+			// Insertion into the list kept sorted by score, the weakest drops off the end
+			int slot = count < LIGHTS_PER_OBJECT ? count++ : count - 1;
+			while (slot > 0 && scores[slot - 1] < score) {
+				scores[slot] = scores[slot - 1];
+				indices[slot] = indices[slot - 1];
+				slot--;
+			}
+			scores[slot] = score;
+			indices[slot] = (int)i;
+		}
+		return count;
+	}
+
+	// Hand a draw its lights, see gather()
+	void apply(const Shader& shader, const int* indices, int count) const {
+		shader.setInt("lightCount", count);
+		if (count > 0)
+			shader.setIntArray("lightIndices", indices, count);
+	}
+
+private:
+	// Structure of arrays, one entry per light
+	std::vector<uint8_t> type;
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> cullRadius;
+	std::vector<float> range;
+	std::vector<float> dirX, dirY, dirZ;
+	std::vector<float> red, green, blue;	// Color times intensity
+	std::vector<float> angleScale, angleOffset;
+
+	std::vector<uint32_t> visible;
+	std::vector<float> staging;
+	unsigned int buffer = 0;
+	unsigned int texture = 0;
+	size_t capacity = 0;
+	bool dirty = true;
+};
+
+#endif
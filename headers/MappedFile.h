@@ -0,0 +1,92 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the object does.
+class MappedFile {
+public:
+	MappedFile() : mapped(nullptr), length(0) {}
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Map the file at the given path, returns false if it could not be opened or is empty
+	bool open(const char* path) {
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL)
+			return false;
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);	// The view keeps the mapping alive
+		if (view == NULL)
+			return false;
+		mapped = static_cast<const unsigned char*>(view);
+		length = (size_t)fileSize.QuadPart;
+#else
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);	// The mapping keeps the file alive
+		if (view == MAP_FAILED)
+			return false;
+		// Ask the kernel to start reading ahead, uploads walk the file front to back
+		madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+		madvise(view, (size_t)st.st_size, MADV_WILLNEED);
+		mapped = static_cast<const unsigned char*>(view);
+		length = (size_t)st.st_size;
+#endif
+		return true;
+	}
+
+	void close() {
+		if (mapped == nullptr)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(mapped);
+#else
+		munmap(const_cast<unsigned char*>(mapped), length);
+#endif
+		mapped = nullptr;
+		length = 0;
+	}
+
+	bool isOpen() const { return mapped != nullptr; }
+	const unsigned char* data() const { return mapped; }
+	size_t size() const { return length; }
+
+private:
+	const unsigned char* mapped;
+	size_t length;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef MATERIAL_REGISTRY_H
+#define MATERIAL_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Materials visible to a shader at once, the size of the materials[] array in lighting.fs. 256 std140 entries
+// are 12 KB, inside the 16 KB GL_MAX_UNIFORM_BLOCK_SIZE every implementation supports.
+const int MATERIAL_BLOCK_SIZE = 256;
+const unsigned int MATERIAL_BINDING = 0;	// Uniform buffer binding point of the Materials block
+
+// One entry of the Materials block, laid out as std140 places `struct Material` in lighting.fs
+struct GPUMaterial {
+	float ambient[3];
+	float pad0;
+	float diffuse[3];
+	float pad1;
+	float specular[3];
+	float shininess;
+};
+
+// A draw waiting to be issued, sorted so draws sharing a material go out together
+struct MaterialDraw {
+	uint32_t material;
+	uint32_t draw;		// Caller's index into its own draw list
+
+	bool operator<(const MaterialDraw& other) const {
+		return material != other.material ? material < other.material : draw < other.draw;
+	}
+};
+
+// Every material lives in one uniform buffer indexed by material ID, so switching material is an index
+// (plus a buffer range every MATERIAL_BLOCK_SIZE IDs) instead of re-uploading its fields. Edits only mark
+// the entry dirty, upload() sends the dirty span once per frame.
+class MaterialRegistry {
+public:
+	~MaterialRegistry() { release(); }
+
+	void init() {
+		release();
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment > 0 && blockBytes() % alignment != 0)
+			std::cout << "ERROR::MATERIAL_REGISTRY::BLOCK_NOT_ALIGNED" << std::endl;
+		glGenBuffers(1, &buffer);
+	}
+
+	void release() {
+		if (buffer)
+			glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		capacity = 0;
+		boundBlock = -1;
+	}
+
+	// Register a material under a name, returns its ID (the existing one if the name is taken)
+	uint32_t add(const std::string& name, const Material& material) {
+		auto it = ids.find(name);
+		if (it != ids.end()) {
+			set(it->second, material);
+			return it->second;
+		}
+		uint32_t id = (uint32_t)entries.size();
+		entries.push_back(GPUMaterial());
+		ids[name] = id;
+		set(id, material);
+		return id;
+	}
+
+	// ID registered under name, or -1
+	int find(const std::string& name) const {
+		auto it = ids.find(name);
+		return it != ids.end() ? (int)it->second : -1;
+	}
+
+	void set(uint32_t id, const Material& material) {
+		GPUMaterial& entry = entries[id];
+		for (int c = 0; c < 3; c++) {
+			entry.ambient[c] = material.ambient[c];
+			entry.diffuse[c] = material.diffuse[c];
+			entry.specular[c] = material.specular[c];
+		}
+		entry.shininess = material.shininess;
+		dirtyBegin = std::min(dirtyBegin, id);
+		dirtyEnd = std::max(dirtyEnd, id + 1);
+	}
+
+	size_t size() const { return entries.size(); }
+
+	// Point a shader's Materials block at the shared binding, once after linking
+	void attach(const Shader& shader) const {
+		unsigned int index = glGetUniformBlockIndex(shader.ID, "Materials");
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(shader.ID, index, MATERIAL_BINDING);
+	}
+
+	// Send dirty entries, once per frame before drawing. Returns the bytes uploaded.
+	size_t upload() {
+		if (dirtyBegin >= dirtyEnd)
+			return 0;
+		size_t uploaded;
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		// Storage covers whole blocks so the last bound range never reads past the end
+		size_t needed = (entries.size() + MATERIAL_BLOCK_SIZE - 1) / MATERIAL_BLOCK_SIZE * blockBytes();
+		if (needed > capacity) {
+			capacity = needed;
+			glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, entries.size() * sizeof(GPUMaterial), entries.data());
+			uploaded = entries.size() * sizeof(GPUMaterial);
+			boundBlock = -1;	// New storage, ranges must be rebound
+		}
+		else {
+			uploaded = (dirtyEnd - dirtyBegin) * sizeof(GPUMaterial);
+			glBufferSubData(GL_UNIFORM_BUFFER, dirtyBegin * sizeof(GPUMaterial), uploaded, &entries[dirtyBegin]);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		dirtyBegin = UINT32_MAX;
+		dirtyEnd = 0;
+		uploadedBytes += uploaded;
+		return uploaded;
+	}
+
+	// Select a material for the following draws: the block holding it, then its index within the block
+	void use(const Shader& shader, uint32_t id) {
+		int block = (int)(id / MATERIAL_BLOCK_SIZE);
+		if (block != boundBlock) {
+			glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_BINDING, buffer, (GLintptr)block * blockBytes(), blockBytes());
+			boundBlock = block;
+		}
+		shader.setInt("materialIndex", (int)(id % MATERIAL_BLOCK_SIZE));
+	}
+
+	size_t totalUploadedBytes() const { return uploadedBytes; }
+
+private:
+	static size_t blockBytes() { return MATERIAL_BLOCK_SIZE * sizeof(GPUMaterial); }
+
+	std::vector<GPUMaterial> entries;
+	std::unordered_map<std::string, uint32_t> ids;
+	unsigned int buffer = 0;
+	size_t capacity = 0;
+	int boundBlock = -1;
+	uint32_t dirtyBegin = UINT32_MAX;
+	uint32_t dirtyEnd = 0;
+	size_t uploadedBytes = 0;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Floats per vertex in Mesh::vertices: position (3), normal (3), uv (2)
+const int MESH_VERTEX_LEN = 8;
+const int MESH_MAX_ATTRIBS = 8;
+
+// Component types, the values are the GL enums so they pass straight to glVertexAttribPointer
+enum MeshComponentType {
+	MESH_BYTE = 0x1400,
+	MESH_UNSIGNED_BYTE = 0x1401,
+	MESH_SHORT = 0x1402,
+	MESH_UNSIGNED_SHORT = 0x1403,
+	MESH_UNSIGNED_INT = 0x1405,
+	MESH_FLOAT = 0x1406,
+	MESH_HALF_FLOAT = 0x140B
+};
+
+// One attribute as addVertexAttrib sets it up, in bytes so packed formats fit too
+struct VertexAttrib {
+	uint32_t location;
+	uint32_t components;
+	uint32_t type;			// MeshComponentType
+	uint32_t normalized;
+	uint32_t offset;		// Bytes from the start of the vertex
+};
+
+// VertexLayout::flags
+const uint32_t VERTEX_OCT_NORMALS = 1;	// Attribute 1 is an octahedral encoded normal (see VertexCompression.h)
+
+struct VertexLayout {
+	uint32_t stride;		// Bytes per vertex
+	uint32_t attribCount;
+	VertexAttrib attribs[MESH_MAX_ATTRIBS];
+	uint32_t flags;
+	uint32_t reserved;
+	float positionScale[3];		// Object space position = stored position * scale + offset
+	float positionOffset[3];
+};
+
+// Layout of Mesh::vertices: float position at 0, normal at 1, uv at 2
+inline VertexLayout meshDefaultLayout() {
+	VertexLayout layout = {};
+	layout.stride = MESH_VERTEX_LEN * sizeof(float);
+	layout.attribCount = 3;
+	layout.attribs[0] = { 0, 3, MESH_FLOAT, 0, 0 };
+	layout.attribs[1] = { 1, 3, MESH_FLOAT, 0, 3 * sizeof(float) };
+	layout.attribs[2] = { 2, 2, MESH_FLOAT, 0, 6 * sizeof(float) };
+	for (int c = 0; c < 3; c++)
+		layout.positionScale[c] = 1.0f;
+	return layout;
+}
+
+// Indexed triangle mesh on the CPU, laid out the way createVBO / addVertexAttrib expect
+struct Mesh {
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+
+	size_t vertexCount() const { return vertices.size() / MESH_VERTEX_LEN; }
+	size_t triangleCount() const { return indices.size() / 3; }
+
+	void computeBounds() {
+		for (int c = 0; c < 3; c++) {
+			boundsMin[c] = vertices.empty() ? 0.0f : vertices[c];
+			boundsMax[c] = boundsMin[c];
+		}
+		for (size_t i = 0; i < vertices.size(); i += MESH_VERTEX_LEN) {
+			for (int c = 0; c < 3; c++) {
+				boundsMin[c] = vertices[i + c] < boundsMin[c] ? vertices[i + c] : boundsMin[c];
+				boundsMax[c] = vertices[i + c] > boundsMax[c] ? vertices[i + c] : boundsMax[c];
+			}
+		}
+	}
+};
+
+// Load throughput of a mesh loader
+struct MeshLoadStats {
+	size_t bytes = 0;
+	size_t triangles = 0;
+	double seconds = 0.0;
+
+	void print(const char* name) const {
+		double s = seconds > 0.0 ? seconds : 1e-9;
+		printf("%s: %.1f MB, %zu triangles in %.1f ms (%.1f MB/s, %.2f Mtris/s)\n", name, bytes / 1e6, triangles, seconds * 1000.0,
+			bytes / 1e6 / s, triangles / 1e6 / s);
+	}
+};
+
+#endif
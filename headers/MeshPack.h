@@ -0,0 +1,278 @@
+#ifndef MESH_PACK_H
+#define MESH_PACK_H
+
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Mesh pack layout (written by tools/meshcook.cpp, read at runtime through a memory mapping):
+//   MeshPackHeader
+//   per mesh: vertex blob, then index blob holding every LOD back to back, each on a MESHPACK_DATA_ALIGNMENT boundary
+//   MeshPackEntry[meshCount] (the index, at header.indexOffset)
+// Blobs are stored exactly as the GPU consumes them, so the runtime hands the mapping to glBufferData as is.
+// LODs share the vertex blob and only differ in which indices they draw.
+
+const uint32_t MESHPACK_MAGIC = 0x4B41504D;	// "MPAK"
+const uint32_t MESHPACK_VERSION = 2;
+const uint32_t MESHPACK_DATA_ALIGNMENT = 16;
+const int MESHPACK_MAX_LODS = 8;
+const int MESHPACK_NAME_LEN = 64;
+
+struct MeshPackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t meshCount;
+	uint32_t reserved;
+	uint64_t indexOffset;
+};
+
+struct MeshPackLod {
+	uint32_t firstIndex;	// Into the mesh's index blob
+	uint32_t indexCount;
+	float error;			// Largest geometric deviation from LOD 0, in mesh units
+	uint32_t reserved;
+};
+
+struct MeshPackEntry {
+	char name[MESHPACK_NAME_LEN];	// Source path, e.g. "rsc/models/bunny.obj"
+	uint32_t vertexCount;
+	uint32_t indexCount;	// All LODs together
+	uint32_t indexType;		// MESH_UNSIGNED_SHORT or MESH_UNSIGNED_INT
+	uint32_t lodCount;
+	VertexLayout layout;
+	uint32_t reserved[2];
+	uint64_t vertexOffset;	// From the start of the file
+	uint64_t vertexSize;
+	uint64_t indexOffset;
+	uint64_t indexSize;
+	float boundsMin[3];
+	float boundsMax[3];
+	float sphere[4];		// Bounding sphere center and radius
+	MeshPackLod lods[MESHPACK_MAX_LODS];
+};
+
+// Coarsest LOD whose error stays below maxPixels on screen. distance is from the camera, scale the model's
+// uniform scale and pixelsPerUnit the screen height over 2 * tan(fov / 2), i.e. pixels per unit at distance 1.
+inline uint32_t meshPackSelectLod(const MeshPackEntry& entry, float scale, float distance, float pixelsPerUnit, float maxPixels = 1.0f) {
+	uint32_t lod = 0;
+	distance = distance > 1e-4f ? distance : 1e-4f;
+	for (uint32_t i = 1; i < entry.lodCount; i++) {
+		if (entry.lods[i].error * scale * pixelsPerUnit / distance > maxPixels)
+			break;
+		lod = i;
+	}
+	return lod;
+}
+
+// A mesh pack mapped into memory, vertex and index blobs are handed out as pointers into the mapping
+class MeshPack {
+public:
+	bool open(const char* path) {
+		if (!file.open(path))
+			return false;
+		if (file.size() < sizeof(MeshPackHeader))
+			return fail();
+		const MeshPackHeader* header = reinterpret_cast<const MeshPackHeader*>(file.data());
+		if (header->magic != MESHPACK_MAGIC || header->version != MESHPACK_VERSION)
+			return fail();
+		if (header->indexOffset > file.size() || (uint64_t)header->meshCount * sizeof(MeshPackEntry) > file.size() - header->indexOffset)
+			return fail();
+		entries = reinterpret_cast<const MeshPackEntry*>(file.data() + header->indexOffset);
+		count = header->meshCount;
+		for (uint32_t i = 0; i < count; i++) {
+			if (!valid(entries[i]))
+				return fail();
+		}
+		return true;
+	}
+
+	bool isOpen() const { return file.isOpen(); }
+	uint32_t size() const { return count; }
+	size_t bytes() const { return file.size(); }
+	const MeshPackEntry& entry(uint32_t index) const { return entries[index]; }
+
+	// Look up a mesh by its source path, returns NULL when the pack does not contain it
+	const MeshPackEntry* find(const char* name) const {
+		for (uint32_t i = 0; i < count; i++) {
+			if (strncmp(entries[i].name, name, MESHPACK_NAME_LEN) == 0)
+				return &entries[i];
+		}
+		return NULL;
+	}
+
+	const unsigned char* vertexData(const MeshPackEntry& entry) const { return file.data() + entry.vertexOffset; }
+	const unsigned char* indexData(const MeshPackEntry& entry) const { return file.data() + entry.indexOffset; }
+
+private:
+	// Blobs must lie inside the file and hold every vertex and index the entry describes, attributes must fit the
+	// stride and every LOD its index blob, so a truncated or corrupt pack fails to open instead of drawing from past
+	// the end of a buffer
+	bool valid(const MeshPackEntry& entry) const {
+		if (entry.lodCount < 1 || entry.lodCount > (uint32_t)MESHPACK_MAX_LODS)
+			return false;
+		if (entry.indexType != MESH_UNSIGNED_SHORT && entry.indexType != MESH_UNSIGNED_INT)
+			return false;
+		const VertexLayout& layout = entry.layout;
+		if (layout.stride == 0 || layout.attribCount > (uint32_t)MESH_MAX_ATTRIBS)
+			return false;
+		for (uint32_t i = 0; i < layout.attribCount; i++) {
+			const VertexAttrib& attrib = layout.attribs[i];
+			uint32_t size = componentSize(attrib.type);
+			if (size == 0 || attrib.components < 1 || attrib.components > 4 || attrib.location >= 16 ||
+				attrib.offset > layout.stride || attrib.components * size > layout.stride - attrib.offset)
+				return false;
+		}
+		if (!inFile(entry.vertexOffset, entry.vertexSize) || !inFile(entry.indexOffset, entry.indexSize))
+			return false;
+		uint64_t indexBytes = entry.indexType == MESH_UNSIGNED_SHORT ? 2 : 4;
+		if (entry.vertexSize < (uint64_t)entry.vertexCount * layout.stride || entry.indexSize < (uint64_t)entry.indexCount * indexBytes)
+			return false;
+		for (uint32_t l = 0; l < entry.lodCount; l++) {
+			if ((uint64_t)entry.lods[l].firstIndex + entry.lods[l].indexCount > entry.indexCount)
+				return false;
+		}
+		return true;
+	}
+
+	bool inFile(uint64_t offset, uint64_t size) const {
+		return offset <= file.size() && size <= file.size() - offset;
+	}
+
+	static uint32_t componentSize(uint32_t type) {
+		switch (type) {
+		case MESH_BYTE: case MESH_UNSIGNED_BYTE: return 1;
+		case MESH_SHORT: case MESH_UNSIGNED_SHORT: case MESH_HALF_FLOAT: return 2;
+		case MESH_UNSIGNED_INT: case MESH_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	bool fail() {
+		file.close();
+		entries = NULL;
+		count = 0;
+		return false;
+	}
+
+	MappedFile file;
+	const MeshPackEntry* entries = NULL;
+	uint32_t count = 0;
+};
+
+// Streams meshes into a pack file, the index is appended by finish()
+class MeshPackWriter {
+public:
+	~MeshPackWriter() {
+		if (out)
+			fclose(out);
+	}
+
+	bool open(const char* path) {
+		out = fopen(path, "wb");
+		if (!out)
+			return false;
+		MeshPackHeader header = {};
+		fwrite(&header, sizeof(header), 1, out);
+		offset = sizeof(header);
+		return true;
+	}
+
+	// Add a mesh: its vertices encoded in the given layout (mesh.vertices itself for meshDefaultLayout), and one
+	// index list per LOD, finest first. Bounds come from the mesh. Indices are stored as 16 bit whenever possible.
+	bool add(const char* name, const Mesh& mesh, const VertexLayout& layout, const void* vertices,
+		const std::vector<std::vector<unsigned int>>& lods, const std::vector<float>& lodErrors) {
+		if (lods.empty() || lods.size() > (size_t)MESHPACK_MAX_LODS || lodErrors.size() != lods.size() || strlen(name) >= (size_t)MESHPACK_NAME_LEN)
+			return false;
+
+		MeshPackEntry entry = {};
+		strncpy(entry.name, name, MESHPACK_NAME_LEN - 1);
+		entry.vertexCount = (uint32_t)mesh.vertexCount();
+		entry.indexType = entry.vertexCount <= 65536 ? MESH_UNSIGNED_SHORT : MESH_UNSIGNED_INT;
+		entry.lodCount = (uint32_t)lods.size();
+		entry.layout = layout;
+
+		for (int c = 0; c < 3; c++) {
+			entry.boundsMin[c] = mesh.boundsMin[c];
+			entry.boundsMax[c] = mesh.boundsMax[c];
+			entry.sphere[c] = (mesh.boundsMin[c] + mesh.boundsMax[c]) * 0.5f;
+		}
+		// Tighter than the box's half diagonal, the farthest vertex from the box center
+		float radius = 0.0f;
+		for (size_t i = 0; i < mesh.vertices.size(); i += MESH_VERTEX_LEN) {
+			const float* p = &mesh.vertices[i];
+			float d = (p[0] - entry.sphere[0]) * (p[0] - entry.sphere[0]) + (p[1] - entry.sphere[1]) * (p[1] - entry.sphere[1]) + (p[2] - entry.sphere[2]) * (p[2] - entry.sphere[2]);
+			radius = d > radius ? d : radius;
+		}
+		entry.sphere[3] = std::sqrt(radius);
+
+		pad(MESHPACK_DATA_ALIGNMENT);
+		entry.vertexOffset = offset;
+		entry.vertexSize = (uint64_t)entry.vertexCount * layout.stride;
+		write(vertices, (size_t)entry.vertexSize);
+
+		pad(MESHPACK_DATA_ALIGNMENT);
+		entry.indexOffset = offset;
+		std::vector<uint16_t> shortIndices;
+		for (size_t l = 0; l < lods.size(); l++) {
+			entry.lods[l].firstIndex = entry.indexCount;
+			entry.lods[l].indexCount = (uint32_t)lods[l].size();
+			entry.lods[l].error = lodErrors[l];
+			entry.indexCount += (uint32_t)lods[l].size();
+			if (lods[l].empty())
+				continue;
+			if (entry.indexType == MESH_UNSIGNED_SHORT) {
+				shortIndices.assign(lods[l].begin(), lods[l].end());
+				write(shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+			}
+			else
+				write(lods[l].data(), lods[l].size() * sizeof(unsigned int));
+		}
+		entry.indexSize = offset - entry.indexOffset;
+		index.push_back(entry);
+		return true;
+	}
+
+	// Write the index and patch the header, returns false on any I/O error
+	bool finish() {
+		pad(MESHPACK_DATA_ALIGNMENT);
+		MeshPackHeader header = {};
+		header.magic = MESHPACK_MAGIC;
+		header.version = MESHPACK_VERSION;
+		header.meshCount = (uint32_t)index.size();
+		header.indexOffset = offset;
+		if (!index.empty())
+			write(index.data(), index.size() * sizeof(MeshPackEntry));
+		fseek(out, 0, SEEK_SET);
+		fwrite(&header, sizeof(header), 1, out);
+		bool ok = !ferror(out);
+		ok = fclose(out) == 0 && ok;
+		out = NULL;
+		return ok;
+	}
+
+	uint64_t bytesWritten() const { return offset; }
+
+private:
+	void write(const void* data, size_t size) {
+		fwrite(data, 1, size, out);
+		offset += size;
+	}
+
+	void pad(uint32_t alignment) {
+		static const unsigned char zeros[MESHPACK_DATA_ALIGNMENT] = {};
+		size_t padding = (size_t)((alignment - offset % alignment) % alignment);
+		if (padding)
+			write(zeros, padding);
+	}
+
+	FILE* out = NULL;
+	uint64_t offset = 0;
+	std::vector<MeshPackEntry> index;
+};
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include "Mesh.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MESHLET_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESHLET_USE_SSE2
+#endif
+
+// Meshlets: small clusters of triangles that are culled on their own. The builder reorders the mesh's index
+// buffer so every meshlet is one contiguous range, which the culler then emits as indirect draws.
+
+const int MESHLET_MAX_VERTICES = 64;
+const int MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet {
+	uint32_t firstIndex;	// Into the reordered Mesh::indices
+	uint32_t triangleCount;
+	uint32_t vertexCount;	// Unique vertices referenced, at most MESHLET_MAX_VERTICES
+};
+
+// Cluster bounds in structure of arrays form so the culler can test 4 / 8 meshlets per instruction.
+// The normal cone is stored as its axis and the sine of its half angle; a cluster is back facing when the
+// view direction lies within (90 degrees - half angle) of the axis. Cones of 90 degrees or wider get cutoff 2.
+struct MeshletBounds {
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> axisX, axisY, axisZ, cutoff;
+
+	size_t size() const { return radius.size(); }
+
+	void resize(size_t n) {
+		for (std::vector<float>* v : { &centerX, &centerY, &centerZ, &radius, &axisX, &axisY, &axisZ, &cutoff })
+			v->resize(n);
+	}
+};
+
+struct MeshletMesh {
+	std::vector<Meshlet> meshlets;
+	MeshletBounds bounds;
+};
+
+// Greedy clustering: a meshlet grows with the unused neighbouring triangle that adds the fewest new vertices,
+// so clusters stay compact (tight spheres, narrow cones). Rewrites mesh.indices in meshlet order.
+inline MeshletMesh buildMeshlets(Mesh& mesh, int maxVertices = MESHLET_MAX_VERTICES, int maxTriangles = MESHLET_MAX_TRIANGLES) {
+	maxVertices = std::min(std::max(maxVertices, 3), 255);
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t vertexCount = mesh.vertexCount();
+
+	// Vertex -> triangle adjacency
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+	for (unsigned int index : mesh.indices)
+		adjacencyOffset[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffset[v + 1] += adjacencyOffset[v];
+	std::vector<uint32_t> adjacency(mesh.indices.size());
+	std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[mesh.indices[t * 3 + k]]++] = (uint32_t)t;
+	}
+
+	MeshletMesh result;
+	std::vector<unsigned int> ordered;
+	ordered.reserve(mesh.indices.size());
+	std::vector<bool> used(triangleCount, false);
+	std::vector<int> localIndex(vertexCount, -1);	// Vertex slot in the current meshlet
+	std::vector<uint32_t> meshletVertices;
+	size_t nextSeed = 0;
+
+	auto newVertices = [&](size_t t) {
+		int count = 0;
+		for (int k = 0; k < 3; k++)
+			count += localIndex[mesh.indices[t * 3 + k]] < 0;
+		return count;
+	};
+
+	for (;;) {
+		while (nextSeed < triangleCount && used[nextSeed])
+			nextSeed++;
+		if (nextSeed == triangleCount)
+			break;
+
+		Meshlet meshlet = { (uint32_t)ordered.size(), 0, 0 };
+		size_t candidate = nextSeed;
+		while (candidate != SIZE_MAX) {
+			used[candidate] = true;
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = mesh.indices[candidate * 3 + k];
+				if (localIndex[v] < 0) {
+					localIndex[v] = (int)meshletVertices.size();
+					meshletVertices.push_back(v);
+				}
+				ordered.push_back(v);
+			}
+			meshlet.triangleCount++;
+			if ((int)meshlet.triangleCount >= maxTriangles)
+				break;
+
+			// Best unused neighbour of any vertex already in the meshlet
+			candidate = SIZE_MAX;
+			int best = 4;
+			for (uint32_t v : meshletVertices) {
+				for (uint32_t a = adjacencyOffset[v]; a < adjacencyOffset[v + 1] && best > 0; a++) {
+					uint32_t t = adjacency[a];
+					if (used[t])
+						continue;
+					int added = newVertices(t);
+					if (added < best && (int)meshletVertices.size() + added <= maxVertices) {
+						best = added;
+						candidate = t;
+					}
+				}
+				if (best == 0)
+					break;
+			}
+		}
+
+		meshlet.vertexCount = (uint32_t)meshletVertices.size();
+		for (uint32_t v : meshletVertices)
+			localIndex[v] = -1;
+		meshletVertices.clear();
+		result.meshlets.push_back(meshlet);
+	}
+	mesh.indices.swap(ordered);
+
+	// Bounds: sphere around the meshlet's vertices, cone around its face normals
+	result.bounds.resize(result.meshlets.size());
+	parallelFor((int)result.meshlets.size(), [&](int m) {
+		const Meshlet& meshlet = result.meshlets[m];
+		const unsigned int* indices = &mesh.indices[meshlet.firstIndex];
+		float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++) {
+			const float* p = &mesh.vertices[(size_t)indices[i] * MESH_VERTEX_LEN];
+			for (int c = 0; c < 3; c++) {
+				lo[c] = std::min(lo[c], p[c]);
+				hi[c] = std::max(hi[c], p[c]);
+			}
+		}
+		float center[3] = { (lo[0] + hi[0]) * 0.5f, (lo[1] + hi[1]) * 0.5f, (lo[2] + hi[2]) * 0.5f };
+		float radius = 0.0f;
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+		std::vector<float> normals;
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+			const float* a = &mesh.vertices[(size_t)indices[t * 3] * MESH_VERTEX_LEN];
+			const float* b = &mesh.vertices[(size_t)indices[t * 3 + 1] * MESH_VERTEX_LEN];
+			const float* c = &mesh.vertices[(size_t)indices[t * 3 + 2] * MESH_VERTEX_LEN];
+			for (const float* p : { a, b, c }) {
+				float d = (p[0] - center[0]) * (p[0] - center[0]) + (p[1] - center[1]) * (p[1] - center[1]) + (p[2] - center[2]) * (p[2] - center[2]);
+				radius = std::max(radius, d);
+			}
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length == 0.0f)
+				continue;	// Degenerate triangles face nowhere
+			for (int k = 0; k < 3; k++) {
+				normals.push_back(n[k] / length);
+				axis[k] += n[k] / length;
+			}
+		}
+		float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+		for (size_t i = 0; i < normals.size() && axisLength > 0.0f; i += 3)
+			minDot = std::min(minDot, (normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]) / axisLength);
+
+		MeshletBounds& bounds = result.bounds;
+		bounds.centerX[m] = center[0];
+		bounds.centerY[m] = center[1];
+		bounds.centerZ[m] = center[2];
+		bounds.radius[m] = std::sqrt(radius);
+		bounds.axisX[m] = axisLength > 0.0f ? axis[0] / axisLength : 0.0f;
+		bounds.axisY[m] = axisLength > 0.0f ? axis[1] / axisLength : 0.0f;
+		bounds.axisZ[m] = axisLength > 0.0f ? axis[2] / axisLength : 0.0f;
+		bounds.cutoff[m] = minDot <= 0.0f ? 2.0f : std::sqrt(1.0f - minDot * minDot);	// sin of the cone's half angle
+	}, 0, 64);
+	return result;
+}
+
+// What the culler tests against, all in the mesh's own (object) space
+struct MeshletCullView {
+	float planes[6][4];		// Frustum planes a * x + b * y + c * z + d >= 0 inside, normalized
+	float camera[3];
+	bool frustum = true;
+	bool cones = true;
+};
+
+// Extract frustum planes (Gribb / Hartmann) from a column major projection * view * model matrix, so they land in object space
+inline void meshletFrustumPlanes(const float* m, MeshletCullView& view) {
+	for (int i = 0; i < 3; i++) {
+		for (int sign = 0; sign < 2; sign++) {
+			float* plane = view.planes[i * 2 + sign];
+			float s = sign ? -1.0f : 1.0f;
+			for (int c = 0; c < 4; c++)
+				plane[c] = m[c * 4 + 3] + s * m[c * 4 + i];
+			float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			for (int c = 0; c < 4 && length > 0.0f; c++)
+				plane[c] /= length;
+		}
+	}
+}
+
+// Scalar reference for one meshlet, the SIMD paths below compute the same thing
+inline bool meshletVisible(const MeshletBounds& b, size_t i, const MeshletCullView& view) {
+	if (view.frustum) {
+		for (int p = 0; p < 6; p++) {
+			const float* plane = view.planes[p];
+			if (plane[0] * b.centerX[i] + plane[1] * b.centerY[i] + plane[2] * b.centerZ[i] + plane[3] < -b.radius[i])
+				return false;
+		}
+	}
+	if (view.cones) {
+		float dx = b.centerX[i] - view.camera[0], dy = b.centerY[i] - view.camera[1], dz = b.centerZ[i] - view.camera[2];
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		if (dx * b.axisX[i] + dy * b.axisY[i] + dz * b.axisZ[i] >= b.cutoff[i] * distance + b.radius[i])
+			return false;
+	}
+	return true;
+}
+
+// Append the indices of every meshlet that survives frustum and back face cone culling, returns how many did.
+// Any allocator works for visible, e.g. a FrameVector.
+template <typename Allocator>
+inline size_t cullMeshlets(const MeshletBounds& b, const MeshletCullView& view, std::vector<uint32_t, Allocator>& visible) {
+	size_t count = b.size();
+	size_t before = visible.size();
+	size_t i = 0;
+#if defined(MESHLET_USE_AVX)
+	for (; i + 8 <= count; i += 8) {
+		__m256 cx = _mm256_loadu_ps(&b.centerX[i]), cy = _mm256_loadu_ps(&b.centerY[i]), cz = _mm256_loadu_ps(&b.centerZ[i]);
+		__m256 r = _mm256_loadu_ps(&b.radius[i]);
+		__m256 keep = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		if (view.frustum) {
+			__m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+			for (int p = 0; p < 6; p++) {
+				const float* plane = view.planes[p];
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), cx), _mm256_mul_ps(_mm256_set1_ps(plane[1]), cy)),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[2]), cz), _mm256_set1_ps(plane[3])));
+				keep = _mm256_and_ps(keep, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+			}
+		}
+		if (view.cones) {
+			__m256 dx = _mm256_sub_ps(cx, _mm256_set1_ps(view.camera[0]));
+			__m256 dy = _mm256_sub_ps(cy, _mm256_set1_ps(view.camera[1]));
+			__m256 dz = _mm256_sub_ps(cz, _mm256_set1_ps(view.camera[2]));
+			__m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+			__m256 along = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, _mm256_loadu_ps(&b.axisX[i])), _mm256_mul_ps(dy, _mm256_loadu_ps(&b.axisY[i]))),
+				_mm256_mul_ps(dz, _mm256_loadu_ps(&b.axisZ[i])));
+			__m256 limit = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&b.cutoff[i]), distance), r);
+			keep = _mm256_and_ps(keep, _mm256_cmp_ps(along, limit, _CMP_LT_OQ));
+		}
+		int mask = _mm256_movemask_ps(keep);
+		while (mask) {
+			int bit = 0;
+			while (!(mask & (1 << bit)))
+				bit++;
+			visible.push_back((uint32_t)(i + bit));
+			mask &= mask - 1;
+		}
+	}
+#endif
+#if defined(MESHLET_USE_SSE2) || defined(MESHLET_USE_AVX)
+	for (; i + 4 <= count; i += 4) {
+		__m128 cx = _mm_loadu_ps(&b.centerX[i]), cy = _mm_loadu_ps(&b.centerY[i]), cz = _mm_loadu_ps(&b.centerZ[i]);
+		__m128 r = _mm_loadu_ps(&b.radius[i]);
+		__m128 keep = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		if (view.frustum) {
+			__m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+			for (int p = 0; p < 6; p++) {
+				const float* plane = view.planes[p];
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), cx), _mm_mul_ps(_mm_set1_ps(plane[1]), cy)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), cz), _mm_set1_ps(plane[3])));
+				keep = _mm_and_ps(keep, _mm_cmpge_ps(d, negR));
+			}
+		}
+		if (view.cones) {
+			__m128 dx = _mm_sub_ps(cx, _mm_set1_ps(view.camera[0]));
+			__m128 dy = _mm_sub_ps(cy, _mm_set1_ps(view.camera[1]));
+			__m128 dz = _mm_sub_ps(cz, _mm_set1_ps(view.camera[2]));
+			__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			__m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&b.axisX[i])), _mm_mul_ps(dy, _mm_loadu_ps(&b.axisY[i]))),
+				_mm_mul_ps(dz, _mm_loadu_ps(&b.axisZ[i])));
+			__m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&b.cutoff[i]), distance), r);
+			keep = _mm_and_ps(keep, _mm_cmplt_ps(along, limit));
+		}
+		int mask = _mm_movemask_ps(keep);
+		for (int bit = 0; bit < 4; bit++) {
+			if (mask & (1 << bit))
+				visible.push_back((uint32_t)(i + bit));
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		if (meshletVisible(b, i, view))
+			visible.push_back((uint32_t)i);
+	}
+	return visible.size() - before;
+}
+
+#endif
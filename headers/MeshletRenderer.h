@@ -0,0 +1,97 @@
+#ifndef MESHLET_RENDERER_H
+#define MESHLET_RENDERER_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+#include "Meshlet.h"
+#include "RenderStats.h"
+
+#include <vector>
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Draws the meshlets that survived culling. Neighbouring survivors are merged into one range (the builder
+// lays meshlets out back to back in the index buffer), then all ranges go out in a single multi-draw:
+// glMultiDrawElementsIndirect from a streamed indirect buffer on 4.3, glMultiDrawElements on plain 3.3.
+class MeshletRenderer {
+public:
+	~MeshletRenderer() { release(); }
+
+	void init(const GLExtensions& ext) {
+		release();
+		indirect = ext.multiDrawIndirect;
+		multiDraw = ext.multiDrawElementsIndirect;
+		if (indirect)
+			glGenBuffers(1, &buffer);
+	}
+
+	void release() {
+		if (buffer)
+			glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+
+	// The mesh's VAO (with the reordered element buffer) must be bound. visible must be sorted ascending,
+	// which cullMeshlets produces. Returns the number of triangles submitted.
+	template <typename Allocator>
+	size_t draw(const MeshletMesh& mesh, const std::vector<uint32_t, Allocator>& visible, GLenum indexType) {
+		commands.clear();
+		size_t triangles = 0;
+		for (uint32_t index : visible) {
+			const Meshlet& meshlet = mesh.meshlets[index];
+			triangles += meshlet.triangleCount;
+			if (!commands.empty() && commands.back().firstIndex + commands.back().count == meshlet.firstIndex) {
+				commands.back().count += meshlet.triangleCount * 3;
+				continue;
+			}
+			commands.push_back(DrawElementsIndirectCommand{ meshlet.triangleCount * 3, 1, meshlet.firstIndex, 0, 0 });
+		}
+		lastDraws = commands.size();
+		if (commands.empty())
+			return 0;
+
+		if (indirect) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+			size_t bytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+			capacity = bytes > capacity ? bytes * 2 : capacity;
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity, NULL, GL_STREAM_DRAW);	// Orphan, last frame's commands may still be in flight
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+			multiDraw(GL_TRIANGLES, indexType, (void*)0, (GLsizei)commands.size(), 0);
+			renderStatsIndirect(GL_TRIANGLES, triangles * 3);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		else {
+			size_t indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+			counts.resize(commands.size());
+			offsets.resize(commands.size());
+			for (size_t i = 0; i < commands.size(); i++) {
+				counts[i] = (GLsizei)commands[i].count;
+				offsets[i] = (const void*)(commands[i].firstIndex * indexSize);
+			}
+			glMultiDrawElements(GL_TRIANGLES, counts.data(), indexType, offsets.data(), (GLsizei)commands.size());
+		}
+		return triangles;
+	}
+
+	size_t drawCount() const { return lastDraws; }
+
+private:
+	bool indirect = false;
+	GLMultiDrawElementsIndirectProc multiDraw = NULL;
+	unsigned int buffer = 0;
+	size_t capacity = 0;
+	size_t lastDraws = 0;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+};
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MIP_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_USE_SSE2
+#endif
+
+// A decoded image level, tightly packed rows of `channels` bytes per pixel
+struct MipLevel {
+	int width;
+	int height;
+	std::vector<unsigned char> pixels;
+};
+
+enum MipFilter {
+	MIP_FILTER_BOX,		// Area average, cheapest
+	MIP_FILTER_KAISER,	// Kaiser windowed sinc, radius 3, sharp with little ringing
+	MIP_FILTER_LANCZOS	// Lanczos 3, sharpest, rings on hard edges
+};
+
+struct MipOptions {
+	MipFilter filter = MIP_FILTER_BOX;
+	bool srgb = true;	// Color channels are sRGB encoded, filter them in linear space
+	int threads = 0;	// 0 uses every core
+};
+
+// Filter taps for one axis, every destination pixel reads `taps` source pixels (unused ones carry weight 0)
+struct MipTaps {
+	int taps;
+	std::vector<int> index;
+	std::vector<float> weight;
+};
+
+inline float mipSinc(float x) {
+	if (std::fabs(x) < 1e-5f)
+		return 1.0f;
+	x *= 3.14159265f;
+	return std::sin(x) / x;
+}
+
+// Zeroth order modified Bessel function of the first kind
+inline float mipBesselI0(float x) {
+	float sum = 1.0f, term = 1.0f;
+	for (int k = 1; k < 16; k++) {
+		term *= (x / (2.0f * k)) * (x / (2.0f * k));
+		sum += term;
+	}
+	return sum;
+}
+
+inline float mipKernel(MipFilter filter, float x) {
+	const float radius = 3.0f;
+	x = std::fabs(x);
+	if (x >= radius)
+		return 0.0f;
+	if (filter == MIP_FILTER_LANCZOS)
+		return mipSinc(x) * mipSinc(x / radius);
+	const float beta = 4.0f;
+	float r = x / radius;
+	return mipSinc(x) * mipBesselI0(beta * std::sqrt(1.0f - r * r)) / mipBesselI0(beta);
+}
+
+// Taps mapping srcSize pixels onto dstSize, works for any ratio so odd (non power of two) sizes filter correctly
+inline MipTaps mipBuildTaps(int srcSize, int dstSize, MipFilter filter) {
+	float scale = (float)srcSize / (float)dstSize;
+	float support = filter == MIP_FILTER_BOX ? 0.5f * scale : 3.0f * scale;
+
+	MipTaps taps;
+	taps.taps = (int)std::ceil(support * 2.0f) + 1;
+	taps.index.assign((size_t)dstSize * taps.taps, 0);
+	taps.weight.assign((size_t)dstSize * taps.taps, 0.0f);
+
+	for (int d = 0; d < dstSize; d++) {
+		float center = (d + 0.5f) * scale;
+		int first = (int)std::floor(center - support);
+		float total = 0.0f;
+		for (int k = 0; k < taps.taps; k++) {
+			int s = first + k;
+			float w;
+			if (filter == MIP_FILTER_BOX) {
+				// Overlap of source pixel [s, s + 1] with the footprint of the destination pixel
+				float lo = std::max((float)s, center - support);
+				float hi = std::min((float)s + 1.0f, center + support);
+				w = std::max(hi - lo, 0.0f);
+			}
+			else
+				w = mipKernel(filter, (s + 0.5f - center) / scale);
+			taps.index[(size_t)d * taps.taps + k] = std::min(std::max(s, 0), srcSize - 1);	// Clamp to edge
+			taps.weight[(size_t)d * taps.taps + k] = w;
+			total += w;
+		}
+		if (total != 0.0f) {
+			for (int k = 0; k < taps.taps; k++)
+				taps.weight[(size_t)d * taps.taps + k] /= total;
+		}
+	}
+	return taps;
+}
+
+// sRGB <-> linear conversion tables
+struct MipColorTables {
+	float toLinear[256];
+	unsigned char toSrgb[4096];
+
+	MipColorTables() {
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 4096; i++) {
+			float l = i / 4095.0f;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			toSrgb[i] = (unsigned char)std::lround(c * 255.0f);
+		}
+	}
+
+	static const MipColorTables& get() {
+		static const MipColorTables tables;
+		return tables;
+	}
+};
+
+// Which channels hold color (filtered in linear space when sRGB) rather than alpha
+inline bool mipIsColorChannel(int channels, int c) {
+	return (channels == 2 || channels == 4) ? c < channels - 1 : true;
+}
+
+// One separable pass pair: rows are filtered horizontally into tmp, then columns vertically into dst.
+// Pixels are always 4 floats wide so a pixel is one SSE register and rows vectorize with AVX.
+inline void mipDownsample(const std::vector<float>& src, int srcWidth, int srcHeight, std::vector<float>& dst, int dstWidth, int dstHeight, MipFilter filter, int threads) {
+	MipTaps hTaps = mipBuildTaps(srcWidth, dstWidth, filter);
+	MipTaps vTaps = mipBuildTaps(srcHeight, dstHeight, filter);
+	std::vector<float> tmp((size_t)dstWidth * srcHeight * 4);
+	dst.assign((size_t)dstWidth * dstHeight * 4, 0.0f);
+
+	parallelFor(srcHeight, [&](int y) {
+		const float* row = &src[(size_t)y * srcWidth * 4];
+		float* out = &tmp[(size_t)y * dstWidth * 4];
+		for (int x = 0; x < dstWidth; x++) {
+			const int* index = &hTaps.index[(size_t)x * hTaps.taps];
+			const float* weight = &hTaps.weight[(size_t)x * hTaps.taps];
+#if defined(MIP_USE_SSE2) || defined(MIP_USE_AVX)
+			__m128 acc = _mm_setzero_ps();
+			for (int k = 0; k < hTaps.taps; k++)
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(row + index[k] * 4)));
+			_mm_storeu_ps(out + x * 4, acc);
+#else
+			for (int c = 0; c < 4; c++) {
+				float acc = 0.0f;
+				for (int k = 0; k < hTaps.taps; k++)
+					acc += weight[k] * row[index[k] * 4 + c];
+				out[x * 4 + c] = acc;
+			}
+#endif
+		}
+	}, threads, 8);
+
+	int rowFloats = dstWidth * 4;
+	parallelFor(dstHeight, [&](int y) {
+		float* out = &dst[(size_t)y * rowFloats];
+		const int* index = &vTaps.index[(size_t)y * vTaps.taps];
+		const float* weight = &vTaps.weight[(size_t)y * vTaps.taps];
+		for (int k = 0; k < vTaps.taps; k++) {
+			if (weight[k] == 0.0f)
+				continue;
+			const float* in = &tmp[(size_t)index[k] * rowFloats];
+			int i = 0;
+#if defined(MIP_USE_AVX)
+			__m256 w8 = _mm256_set1_ps(weight[k]);
+			for (; i + 8 <= rowFloats; i += 8)
+				_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(w8, _mm256_loadu_ps(in + i))));
+#endif
+#if defined(MIP_USE_SSE2) || defined(MIP_USE_AVX)
+			__m128 w4 = _mm_set1_ps(weight[k]);
+			for (; i + 4 <= rowFloats; i += 4)
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(w4, _mm_loadu_ps(in + i))));
+#endif
+			for (; i < rowFloats; i++)
+				out[i] += weight[k] * in[i];
+		}
+	}, threads, 8);
+}
+
+// Convert a linear float level back to 8 bit pixels
+inline void mipEncode(const std::vector<float>& linear, int width, int height, int channels, bool srgb, std::vector<unsigned char>& pixels, int threads) {
+	const MipColorTables& tables = MipColorTables::get();
+	pixels.resize((size_t)width * height * channels);
+	parallelFor(height, [&](int y) {
+		for (int x = 0; x < width; x++) {
+			const float* in = &linear[((size_t)y * width + x) * 4];
+			unsigned char* out = &pixels[((size_t)y * width + x) * channels];
+			for (int c = 0; c < channels; c++) {
+				float v = std::min(std::max(in[c], 0.0f), 1.0f);	// Sinc kernels overshoot
+				if (srgb && mipIsColorChannel(channels, c))
+					out[c] = tables.toSrgb[(int)(v * 4095.0f + 0.5f)];
+				else
+					out[c] = (unsigned char)(v * 255.0f + 0.5f);
+			}
+		}
+	}, threads, 16);
+}
+
+// Build the full chain down to 1x1 (or maxLevels), level 0 is a copy of the source.
+// Every level is filtered from the previous one kept in linear float, so there is no requantization drift.
+inline std::vector<MipLevel> generateMipChain(const unsigned char* pixels, int width, int height, int channels, int maxLevels = 16, const MipOptions& options = MipOptions()) {
+	std::vector<MipLevel> chain;
+	chain.push_back(MipLevel{ width, height, std::vector<unsigned char>(pixels, pixels + (size_t)width * height * channels) });
+	if ((width == 1 && height == 1) || maxLevels <= 1)
+		return chain;
+
+	const MipColorTables& tables = MipColorTables::get();
+	std::vector<float> current((size_t)width * height * 4, 0.0f);
+	parallelFor(height, [&](int y) {
+		for (int x = 0; x < width; x++) {
+			const unsigned char* in = pixels + ((size_t)y * width + x) * channels;
+			float* out = &current[((size_t)y * width + x) * 4];
+			for (int c = 0; c < channels; c++)
+				out[c] = (options.srgb && mipIsColorChannel(channels, c)) ? tables.toLinear[in[c]] : in[c] / 255.0f;
+		}
+	}, options.threads, 16);
+
+	std::vector<float> next;
+	int w = width, h = height;
+	while ((w > 1 || h > 1) && (int)chain.size() < maxLevels) {
+		int nw = std::max(w / 2, 1);
+		int nh = std::max(h / 2, 1);
+		mipDownsample(current, w, h, next, nw, nh, options.filter, options.threads);
+		MipLevel level = { nw, nh, {} };
+		mipEncode(next, nw, nh, channels, options.srgb, level.pixels, options.threads);
+		chain.push_back(std::move(level));
+		current.swap(next);
+		w = nw;
+		h = nh;
+	}
+	return chain;
+}
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Wavefront OBJ loading: the file is memory mapped, split at line boundaries into chunks that are parsed on
+// worker threads, then the chunks' v / vt / vn streams are concatenated and the face corners welded into
+// unique vertices. Polygons are fan triangulated, missing normals are generated smooth per position.
+
+const uint32_t OBJ_NONE = 0x7FFFFFFF;		// Corner without uv / normal
+const uint32_t OBJ_RELATIVE = 0x80000000;	// Negative index, the low 31 bits hold a signed chunk-local position resolved once counts are known
+
+static const double OBJ_POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+inline bool objIsSpace(char c) {
+	return c == ' ' || c == '\t';
+}
+
+// Float parser for the decimal forms OBJ exporters write, much faster than strtof since it skips locale handling
+inline float objParseFloat(const char*& p, const char* end) {
+	while (p < end && objIsSpace(*p))
+		p++;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		if (digits < 18) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else
+			exponent++;
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+			if (digits < 18) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negativeExp = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negativeExp = *p++ == '-';
+		int e = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+			e = e < 10000 ? e * 10 + (*p - '0') : e;
+		exponent += negativeExp ? -e : e;
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0)
+		value = exponent >= -18 ? value / OBJ_POW10[-exponent] : value * std::pow(10.0, exponent);
+	else if (exponent > 0)
+		value = exponent <= 18 ? value * OBJ_POW10[exponent] : value * std::pow(10.0, exponent);
+	return (float)(negative ? -value : value);
+}
+
+inline long objParseInt(const char*& p, const char* end) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	long value = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		value = value * 10 + (*p - '0');
+	return negative ? -value : value;
+}
+
+struct ObjChunk {
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	std::vector<float> normals;
+	std::vector<uint32_t> corners;	// Triangulated, 3 indices (v, vt, vn) per corner
+	size_t baseV = 0, baseVt = 0, baseVn = 0;
+	bool hasRelative = false;
+};
+
+// Encode one OBJ index: positive ones are global and 1-based, negative ones count back from the current element.
+// A negative one may reach back into earlier chunks, so its chunk-local position is kept signed until the chunk's
+// base is known.
+inline uint32_t objEncodeIndex(long index, size_t localCount, bool& relative) {
+	if (index > 0)
+		return index <= (long)OBJ_NONE ? (uint32_t)(index - 1) : OBJ_NONE;
+	long local = (long)localCount + index;
+	if (index < 0 && local >= -(1L << 30)) {
+		relative = true;
+		return ((uint32_t)local & ~OBJ_RELATIVE) | OBJ_RELATIVE;
+	}
+	return OBJ_NONE;
+}
+
+inline void objParseChunk(const char* p, const char* end, ObjChunk& chunk) {
+	uint32_t polygon[3 * 64];
+	while (p < end) {
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (lineEnd == NULL)
+			lineEnd = end;
+		while (p < lineEnd && objIsSpace(*p))
+			p++;
+
+		if (lineEnd - p > 2 && p[0] == 'v' && objIsSpace(p[1])) {
+			p += 2;
+			for (int c = 0; c < 3; c++)
+				chunk.positions.push_back(objParseFloat(p, lineEnd));
+		}
+		else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 'n' && objIsSpace(p[2])) {
+			p += 3;
+			for (int c = 0; c < 3; c++)
+				chunk.normals.push_back(objParseFloat(p, lineEnd));
+		}
+		else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 't' && objIsSpace(p[2])) {
+			p += 3;
+			chunk.uvs.push_back(objParseFloat(p, lineEnd));
+			chunk.uvs.push_back(objParseFloat(p, lineEnd));
+		}
+		else if (lineEnd - p > 2 && p[0] == 'f' && objIsSpace(p[1])) {
+			p += 2;
+			int count = 0;
+			while (count < 64) {
+				while (p < lineEnd && objIsSpace(*p))
+					p++;
+				if (p >= lineEnd || *p == '\r' || *p == '#')
+					break;
+				long v = objParseInt(p, lineEnd), vt = 0, vn = 0;
+				if (p < lineEnd && *p == '/') {
+					p++;
+					if (p < lineEnd && *p != '/')
+						vt = objParseInt(p, lineEnd);
+					if (p < lineEnd && *p == '/') {
+						p++;
+						vn = objParseInt(p, lineEnd);
+					}
+				}
+				polygon[count * 3 + 0] = objEncodeIndex(v, chunk.positions.size() / 3, chunk.hasRelative);
+				polygon[count * 3 + 1] = objEncodeIndex(vt, chunk.uvs.size() / 2, chunk.hasRelative);
+				polygon[count * 3 + 2] = objEncodeIndex(vn, chunk.normals.size() / 3, chunk.hasRelative);
+				count++;
+				while (p < lineEnd && !objIsSpace(*p))
+					p++;	// Skip anything unexpected in the token
+			}
+			for (int i = 1; i + 1 < count; i++) {
+				chunk.corners.insert(chunk.corners.end(), polygon, polygon + 3);
+				chunk.corners.insert(chunk.corners.end(), polygon + i * 3, polygon + i * 3 + 6);
+			}
+		}
+		p = lineEnd + 1;
+	}
+}
+
+inline uint32_t objResolve(uint32_t index, size_t base) {
+	if (index == OBJ_NONE || !(index & OBJ_RELATIVE))
+		return index;
+	int64_t local = (int32_t)(index << 1) >> 1;		// Sign extend the 31 bit position
+	int64_t global = (int64_t)base + local;
+	return global >= 0 && global < (int64_t)OBJ_NONE ? (uint32_t)global : OBJ_NONE;
+}
+
+inline uint64_t objHashCorner(const uint32_t* corner) {
+	uint64_t h = corner[0] * 0x9E3779B97F4A7C15ull;
+	h ^= (corner[1] + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+	h ^= (corner[2] + 0x85EBCA77C2B2AE63ull) * 0x165667B19E3779F9ull;
+	return h ^ (h >> 29);
+}
+
+inline bool loadObj(const char* path, Mesh& mesh, MeshLoadStats* stats = NULL, int threads = 0) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.open(path)) {
+		std::cout << "Failed to open mesh " << path << std::endl;
+		return false;
+	}
+	const char* text = (const char*)file.data();
+	size_t size = file.size();
+
+	// Chunk boundaries land just after a newline so no line is split
+	if (threads <= 0)
+		threads = defaultThreadCount();
+	int chunkCount = (int)std::min<size_t>((size_t)threads * 4, size / (64 * 1024) + 1);
+	std::vector<size_t> bounds(chunkCount + 1, size);
+	bounds[0] = 0;
+	for (int i = 1; i < chunkCount; i++) {
+		size_t at = std::max(size * i / chunkCount, bounds[i - 1]);
+		const char* nl = (const char*)memchr(text + at, '\n', size - at);
+		bounds[i] = nl ? (size_t)(nl - text) + 1 : size;
+	}
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	parallelFor(chunkCount, [&](int i) {
+		objParseChunk(text + bounds[i], text + bounds[i + 1], chunks[i]);
+	}, threads);
+
+	// Prefix sums give each chunk its global element offsets, then everything is concatenated
+	std::vector<float> positions, uvs, normals;
+	size_t cornerCount = 0;
+	for (ObjChunk& chunk : chunks) {
+		chunk.baseV = positions.size() / 3;
+		chunk.baseVt = uvs.size() / 2;
+		chunk.baseVn = normals.size() / 3;
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		cornerCount += chunk.corners.size() / 3;
+	}
+	size_t positionCount = positions.size() / 3, uvCount = uvs.size() / 2, normalCount = normals.size() / 3;
+
+	std::vector<uint32_t> corners(cornerCount * 3);
+	std::vector<size_t> cornerBase(chunkCount, 0);
+	for (int i = 1; i < chunkCount; i++)
+		cornerBase[i] = cornerBase[i - 1] + chunks[i - 1].corners.size();
+	parallelFor(chunkCount, [&](int i) {
+		ObjChunk& chunk = chunks[i];
+		uint32_t* out = &corners[0] + cornerBase[i];
+		for (size_t c = 0; c < chunk.corners.size(); c += 3) {
+			uint32_t v = objResolve(chunk.corners[c + 0], chunk.baseV);
+			uint32_t vt = objResolve(chunk.corners[c + 1], chunk.baseVt);
+			uint32_t vn = objResolve(chunk.corners[c + 2], chunk.baseVn);
+			out[c + 0] = v < positionCount ? v : OBJ_NONE;
+			out[c + 1] = vt < uvCount ? vt : OBJ_NONE;
+			out[c + 2] = vn < normalCount ? vn : OBJ_NONE;
+		}
+		std::vector<uint32_t>().swap(chunk.corners);
+	}, threads);
+
+	// Weld identical (v, vt, vn) corners with an open addressing table
+	size_t tableSize = 16;
+	while (tableSize < cornerCount * 2)
+		tableSize *= 2;
+	std::vector<uint32_t> table(tableSize, UINT32_MAX);
+	std::vector<uint32_t> unique;	// First corner of each output vertex
+	mesh.indices.clear();
+	mesh.indices.reserve(cornerCount);
+	bool missingNormals = false;
+	for (size_t c = 0; c < cornerCount; c++) {
+		const uint32_t* corner = &corners[c * 3];
+		if (c % 3 == 0 && (corner[0] == OBJ_NONE || corner[3] == OBJ_NONE || corner[6] == OBJ_NONE)) {
+			c += 2;	// Invalid position index, drop the whole triangle
+			continue;
+		}
+		missingNormals = missingNormals || corner[2] == OBJ_NONE;
+		size_t slot = objHashCorner(corner) & (tableSize - 1);
+		for (;;) {
+			uint32_t entry = table[slot];
+			if (entry == UINT32_MAX) {
+				table[slot] = (uint32_t)unique.size();
+				mesh.indices.push_back((unsigned int)unique.size());
+				unique.push_back((uint32_t)c);
+				break;
+			}
+			if (memcmp(&corners[(size_t)unique[entry] * 3], corner, sizeof(uint32_t) * 3) == 0) {
+				mesh.indices.push_back(entry);
+				break;
+			}
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+
+	mesh.vertices.assign(unique.size() * MESH_VERTEX_LEN, 0.0f);
+	parallelFor((int)unique.size(), [&](int i) {
+		const uint32_t* corner = &corners[(size_t)unique[i] * 3];
+		float* out = &mesh.vertices[(size_t)i * MESH_VERTEX_LEN];
+		memcpy(out, &positions[(size_t)corner[0] * 3], sizeof(float) * 3);
+		if (corner[2] != OBJ_NONE)
+			memcpy(out + 3, &normals[(size_t)corner[2] * 3], sizeof(float) * 3);
+		if (corner[1] != OBJ_NONE)
+			memcpy(out + 6, &uvs[(size_t)corner[1] * 2], sizeof(float) * 2);
+	}, threads, 4096);
+
+	if (missingNormals) {
+		// Area weighted face normals summed per position, so uv seams don't split the shading
+		std::vector<float> accum(positionCount * 3, 0.0f);
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+			const float* a = &mesh.vertices[(size_t)mesh.indices[t] * MESH_VERTEX_LEN];
+			const float* b = &mesh.vertices[(size_t)mesh.indices[t + 1] * MESH_VERTEX_LEN];
+			const float* c = &mesh.vertices[(size_t)mesh.indices[t + 2] * MESH_VERTEX_LEN];
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			for (int k = 0; k < 3; k++) {
+				uint32_t v = corners[(size_t)unique[mesh.indices[t + k]] * 3];
+				for (int j = 0; j < 3; j++)
+					accum[(size_t)v * 3 + j] += n[j];
+			}
+		}
+		for (size_t i = 0; i < unique.size(); i++) {
+			const uint32_t* corner = &corners[(size_t)unique[i] * 3];
+			if (corner[2] != OBJ_NONE)
+				continue;
+			const float* n = &accum[(size_t)corner[0] * 3];
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			float* out = &mesh.vertices[i * MESH_VERTEX_LEN + 3];
+			for (int j = 0; j < 3; j++)
+				out[j] = length > 0.0f ? n[j] / length : (j == 1 ? 1.0f : 0.0f);
+		}
+	}
+	mesh.computeBounds();
+
+	if (stats) {
+		stats->bytes = size;
+		stats->triangles = mesh.triangleCount();
+		stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	return true;
+}
+
+#endif
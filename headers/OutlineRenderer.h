@@ -0,0 +1,188 @@
+#ifndef OUTLINE_RENDERER_H
+#define OUTLINE_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int OUTLINE_COLORS = 4;	// Palette entries, an object's ID picks colors[id % OUTLINE_COLORS], also in outline.fs
+
+// Screen space outlines around selected objects. Selected objects are drawn once into a small ID mask, a jump flood
+// turns the mask into the nearest masked pixel for every pixel in log2(width) fullscreen passes, and one more pass
+// blends the outline over the frame wherever that pixel is close enough. Past the mask draws the cost depends only
+// on the screen size and the outline width, not on how many objects are selected.
+class OutlineRenderer {
+public:
+	float width = 3.0f;		// In screen pixels
+	int downscale = 1;		// Mask and flood resolution divisor, 2 quarters the flood cost for soft wide outlines
+
+	~OutlineRenderer() { release(); }
+
+	void init() {
+		release();
+		maskShader = new Shader("shaders/lighting.vs", "shaders/outline_mask.fs");
+		initShader = new Shader("shaders/fullscreen.vs", "shaders/jump_flood_init.fs");
+		floodShader = new Shader("shaders/fullscreen.vs", "shaders/jump_flood.fs");
+		outlineShader = new Shader("shaders/fullscreen.vs", "shaders/outline.fs");
+		glGenVertexArrays(1, &emptyVAO);	// Fullscreen triangles come from gl_VertexID, core profiles still need a VAO
+		for (int i = 0; i < OUTLINE_COLORS; i++)
+			colors[i] = glm::vec4(1.0f, 0.6f, 0.1f, 1.0f);
+	}
+
+	void release() {
+		releaseTargets();
+		if (emptyVAO)
+			glDeleteVertexArrays(1, &emptyVAO);
+		emptyVAO = 0;
+		for (Shader** shader : { &maskShader, &initShader, &floodShader, &outlineShader }) {
+			if (*shader)
+				glDeleteProgram((*shader)->ID);
+			delete *shader;
+			*shader = NULL;
+		}
+	}
+
+	void setColor(int id, const glm::vec4& color) { colors[id % OUTLINE_COLORS] = color; }
+
+	// Bind the mask and return the shader selected objects are drawn with. It takes lighting.vs uniforms (model,
+	// view, projection, tiModel, octNormals) plus objectId in [1, 255]. Depth is ignored so outlines show through.
+	const Shader& beginMask(int screenWidth, int screenHeight) {
+		resize(std::max(screenWidth / std::max(downscale, 1), 1), std::max(screenHeight / std::max(downscale, 1), 1));
+		screen = glm::ivec2(screenWidth, screenHeight);
+		glBindFramebuffer(GL_FRAMEBUFFER, maskFBO);
+		glViewport(0, 0, size.x, size.y);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glDisable(GL_DEPTH_TEST);
+		maskShader->use();
+		masked = true;
+		return *maskShader;
+	}
+
+	void endMask() {
+		glEnable(GL_DEPTH_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, screen.x, screen.y);
+	}
+
+	// Flood the mask and blend the outlines over the default framebuffer. Does nothing unless beginMask() was
+	// called since the last render(). Returns the number of fullscreen passes.
+	int render() {
+		if (!masked)
+			return 0;
+		masked = false;
+		glDisable(GL_DEPTH_TEST);
+		glBindVertexArray(emptyVAO);
+		glViewport(0, 0, size.x, size.y);
+
+		// Every masked pixel is its own seed
+		glBindFramebuffer(GL_FRAMEBUFFER, seedFBO[0]);
+		initShader->use();
+		initShader->setInt("mask", 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, maskTexture);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		// Halving steps from the first power of two covering the outline (steps k, k/2 .. 1 reach 2k - 1 pixels),
+		// each pixel keeps the nearest seed among its own and 8 neighbours step pixels away
+		float reach = width / std::max(downscale, 1) + 1.0f;
+		int step = 1;
+		while (step * 2 - 1 < reach)
+			step *= 2;
+		int source = 0;
+		int passes = 0;
+		floodShader->use();
+		floodShader->setInt("seeds", 0);
+		for (; step >= 1; step /= 2) {
+			glBindFramebuffer(GL_FRAMEBUFFER, seedFBO[1 - source]);
+			glBindTexture(GL_TEXTURE_2D, seedTexture[source]);
+			floodShader->setInt("stepSize", step);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			source = 1 - source;
+			passes++;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, screen.x, screen.y);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		outlineShader->use();
+		outlineShader->setInt("mask", 0);
+		outlineShader->setInt("seeds", 1);
+		outlineShader->setInt("downscale", std::max(downscale, 1));
+		outlineShader->setFloat("width", width);
+		glUniform4fv(glGetUniformLocation(outlineShader->ID, "colors"), OUTLINE_COLORS, &colors[0].x);
+		glBindTexture(GL_TEXTURE_2D, maskTexture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, seedTexture[source]);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDisable(GL_BLEND);
+		glEnable(GL_DEPTH_TEST);
+		glBindVertexArray(0);
+		return passes + 2;
+	}
+
+private:
+	void resize(int targetWidth, int targetHeight) {
+		if (maskFBO && size == glm::ivec2(targetWidth, targetHeight))
+			return;
+		releaseTargets();
+		size = glm::ivec2(targetWidth, targetHeight);
+		maskTexture = createTarget(GL_R8, GL_RED, GL_UNSIGNED_BYTE, maskFBO);
+		for (int i = 0; i < 2; i++)
+			seedTexture[i] = createTarget(GL_RG16UI, GL_RG_INTEGER, GL_UNSIGNED_SHORT, seedFBO[i]);	// Seed pixel + 1, 0 for none
+	}
+
+	unsigned int createTarget(GLenum internalFormat, GLenum format, GLenum type, unsigned int& fbo) {
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size.x, size.y, 0, format, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::OUTLINE_RENDERER::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return texture;
+	}
+
+	void releaseTargets() {
+		unsigned int fbos[] = { maskFBO, seedFBO[0], seedFBO[1] };
+		unsigned int textures[] = { maskTexture, seedTexture[0], seedTexture[1] };
+		if (maskFBO) {
+			glDeleteFramebuffers(3, fbos);
+			glDeleteTextures(3, textures);
+		}
+		maskFBO = seedFBO[0] = seedFBO[1] = 0;
+		maskTexture = seedTexture[0] = seedTexture[1] = 0;
+	}
+
+	Shader* maskShader = NULL;
+	Shader* initShader = NULL;
+	Shader* floodShader = NULL;
+	Shader* outlineShader = NULL;
+	glm::vec4 colors[OUTLINE_COLORS];
+	unsigned int emptyVAO = 0;
+	unsigned int maskFBO = 0;
+	unsigned int maskTexture = 0;
+	unsigned int seedFBO[2] = {};
+	unsigned int seedTexture[2] = {};
+	glm::ivec2 size = glm::ivec2(0);
+	glm::ivec2 screen = glm::ivec2(0);
+	bool masked = false;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use when the caller passes 0
+inline int defaultThreadCount() {
+	unsigned int n = std::thread::hardware_concurrency();
+	return n == 0 ? 1 : (int)n;
+}
+
+// Run fn(i) for every i in [0, count) across worker threads. Work is handed out in chunks of
+// `grain` items from a shared counter so uneven items still balance. Blocks until all are done.
+template <typename Fn>
+void parallelFor(int count, Fn fn, int threads = 0, int grain = 1) {
+	if (count <= 0)
+		return;
+	if (threads <= 0)
+		threads = defaultThreadCount();
+	grain = std::max(grain, 1);
+	threads = std::min(threads, (count + grain - 1) / grain);
+
+	if (threads <= 1) {
+		for (int i = 0; i < count; i++)
+			fn(i);
+		return;
+	}
+
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		for (;;) {
+			int begin = next.fetch_add(grain);
+			if (begin >= count)
+				break;
+			int end = std::min(begin + grain, count);
+			for (int i = begin; i < end; i++)
+				fn(i);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	pool.reserve(threads - 1);
+	for (int t = 1; t < threads; t++)
+		pool.emplace_back(worker);
+	worker();	// The calling thread works too
+	for (std::thread& t : pool)
+		t.join();
+}
+
+// Workers that stay alive between calls, for work issued every frame where parallelFor's thread start-up (and the
+// allocations it makes) would show. run() has the same contract as parallelFor. Threads start on the first run().
+class WorkerPool {
+public:
+	explicit WorkerPool(int threads = 0) : threads(threads <= 0 ? defaultThreadCount() : threads) {}
+
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& t : workers)
+			t.join();
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	int threadCount() const { return threads; }
+
+	template <typename Fn>
+	void run(int count, Fn fn, int grain = 1) {
+		if (count <= 0)
+			return;
+		grain = std::max(grain, 1);
+		if (threads <= 1 || count <= grain) {
+			for (int i = 0; i < count; i++)
+				fn(i);
+			return;
+		}
+		if (workers.empty()) {
+			workers.reserve(threads - 1);
+			for (int t = 1; t < threads; t++)
+				workers.emplace_back([this]() { workerLoop(); });
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			task = &invoke<Fn>;
+			context = &fn;
+			taskCount = count;
+			taskGrain = grain;
+			next = 0;
+			busy = (int)workers.size();
+			generation++;
+		}
+		wake.notify_all();
+		drain();	// The calling thread works too
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return busy == 0; });
+	}
+
+private:
+	template <typename Fn>
+	static void invoke(void* context, int i) {
+		(*static_cast<Fn*>(context))(i);
+	}
+
+	void drain() {
+		for (;;) {
+			int begin = next.fetch_add(taskGrain);
+			if (begin >= taskCount)
+				break;
+			int end = std::min(begin + taskGrain, taskCount);
+			for (int i = begin; i < end; i++)
+				task(context, i);
+		}
+	}
+
+	void workerLoop() {
+		uint64_t seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+			drain();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+
+	int threads;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	void (*task)(void*, int) = NULL;
+	void* context = NULL;
+	int taskCount = 0;
+	int taskGrain = 1;
+	std::atomic<int> next{ 0 };
+	int busy = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+};
+
+#endif
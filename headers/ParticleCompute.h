@@ -0,0 +1,188 @@
+#ifndef PARTICLE_COMPUTE_H
+#define PARTICLE_COMPUTE_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+#include "ParticleRenderer.h"
+#include "ParticleSystem.h"
+#include "Shader.h"
+
+#include <vector>
+
+const int PARTICLE_COMPUTE_GROUP = 256;		// local_size_x of particle_update.cs
+const int PARTICLE_TIMER_QUERIES = 4;		// Frames a timer result may lag behind
+
+// One particle as particle_update.cs sees it in std430
+struct GPUParticle {
+	float position[3];
+	float age;
+	float velocity[3];
+	float invLife;
+};
+
+// The same simulation as ParticleSystem run by a compute shader (GL 4.3). Particle state stays in a shader storage
+// buffer, the CPU only runs the emitters and writes new particles over the oldest slots of the ring, and the
+// shader writes ParticleInstance records straight into a buffer the ParticleRenderer draws from.
+class ParticleCompute {
+public:
+	~ParticleCompute() { release(); }
+
+	// False without compute support, the CPU system has to be used then
+	bool init(const GLExtensions& ext, ParticleRenderer& renderer, size_t capacity, const ParticleSettings& settings = ParticleSettings()) {
+		release();
+		if (!ext.computeShader)
+			return false;
+		dispatchCompute = ext.dispatchCompute;
+		memoryBarrier = ext.memoryBarrier;
+		program = new Shader("shaders/particle_update.cs");
+		this->capacity = capacity;
+		next = count = 0;
+
+		// Every slot starts dead, far past any lifetime
+		GPUParticle dead = {};
+		dead.age = PARTICLE_DEAD_AGE;
+		dead.invLife = 1.0f;
+		std::vector<GPUParticle> initial(capacity, dead);
+		glGenBuffers(1, &state);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, state);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GPUParticle), initial.data(), GL_DYNAMIC_DRAW);
+		glGenBuffers(1, &instances);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, instances);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(ParticleInstance), NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		vao = renderer.createVAO(instances);
+		glGenQueries(PARTICLE_TIMER_QUERIES, queries);
+		setSettings(settings);
+		return true;
+	}
+
+	void release() {
+		if (queries[0])
+			glDeleteQueries(PARTICLE_TIMER_QUERIES, queries);
+		if (state)
+			glDeleteBuffers(1, &state);
+		if (instances)
+			glDeleteBuffers(1, &instances);
+		delete program;
+		program = NULL;
+		state = instances = vao = 0;
+		queries[0] = 0;
+	}
+
+	void setSettings(const ParticleSettings& settings) {
+		this->settings = settings;
+		particleBakeCurve(settings.colors, colorCurve);
+	}
+
+	size_t addEmitter(const ParticleEmitter& emitter) {
+		emitters.push_back(emitter);
+		return emitters.size() - 1;
+	}
+
+	ParticleEmitter& emitter(size_t index) { return emitters[index]; }
+
+	void update(float dt) {
+		if (!program)
+			return;
+		spawned.clear();
+		for (ParticleEmitter& emitter : emitters) {
+			for (int due = emitter.due(dt); due > 0; due--) {
+				GPUParticle particle;
+				emitter.spawn(rng, particle.position, particle.velocity, particle.invLife);
+				particle.age = 0.0f;
+				spawned.push_back(particle);
+			}
+		}
+		upload();
+		readTimers();
+
+		bool timing = pending < PARTICLE_TIMER_QUERIES;
+		if (timing)
+			glBeginQuery(GL_TIME_ELAPSED, queries[(first + pending) % PARTICLE_TIMER_QUERIES]);
+		program->use();
+		program->setInt("count", (int)count);
+		program->setFloat("dt", dt);
+		program->setFloat("damping", std::max(1.0f - settings.drag * dt, 0.0f));
+		program->setVec3("gravityStep", settings.gravity * dt);
+		program->setFloat("sizeStart", settings.sizeStart);
+		program->setFloat("sizeDelta", settings.sizeEnd - settings.sizeStart);
+		glUniform4fv(glGetUniformLocation(program->ID, "colorCurve"), PARTICLE_CURVE_SIZE, &colorCurve[0].x);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, state);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instances);
+		dispatchCompute((GLuint)((count + PARTICLE_COMPUTE_GROUP - 1) / PARTICLE_COMPUTE_GROUP), 1, 1);
+		memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);	// Draw and next frame's spawns see the writes
+		if (timing) {
+			glEndQuery(GL_TIME_ELAPSED);
+			pendingCounts[(first + pending) % PARTICLE_TIMER_QUERIES] = count;
+			pending++;
+		}
+	}
+
+	// VAO to hand ParticleRenderer::draw, with slotCount() instances
+	unsigned int instanceVAO() const { return vao; }
+	size_t slotCount() const { return count; }
+	size_t maxParticles() const { return capacity; }
+
+	// Simulation throughput measured with timer queries so far, 0 until the first result arrives
+	double particlesPerMs() const { return gpuMs > 0.0 ? timedParticles / gpuMs : 0.0; }
+
+private:
+	// Write new particles over the oldest slots, in at most two pieces when the ring wraps
+	void upload() {
+		if (spawned.empty())
+			return;
+		size_t total = std::min(spawned.size(), capacity);
+		const GPUParticle* source = spawned.data() + (spawned.size() - total);	// More than fit, the newest win
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, state);
+		while (total > 0) {
+			size_t run = std::min(total, capacity - next);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, next * sizeof(GPUParticle), run * sizeof(GPUParticle), source);
+			source += run;
+			total -= run;
+			next = (next + run) % capacity;
+			count = std::max(count, next == 0 ? capacity : next);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	// Collect finished timer queries without waiting on the GPU
+	void readTimers() {
+		while (pending > 0) {
+			GLint available = 0;
+			glGetQueryObjectiv(queries[first], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				break;
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(queries[first], GL_QUERY_RESULT, &ns);
+			gpuMs += ns / 1e6;
+			timedParticles += (double)pendingCounts[first];
+			first = (first + 1) % PARTICLE_TIMER_QUERIES;
+			pending--;
+		}
+	}
+
+	ParticleSettings settings;
+	glm::vec4 colorCurve[PARTICLE_CURVE_SIZE];
+	std::vector<ParticleEmitter> emitters;
+	std::vector<GPUParticle> spawned;
+	GLDispatchComputeProc dispatchCompute = NULL;
+	GLMemoryBarrierProc memoryBarrier = NULL;
+	Shader* program = NULL;
+	unsigned int state = 0;
+	unsigned int instances = 0;
+	unsigned int vao = 0;		// Owned by the renderer
+	size_t capacity = 0;
+	size_t next = 0;			// Ring position the next spawn goes to
+	size_t count = 0;			// Slots ever written, what the shader runs over
+	uint32_t rng = 0x2545F491u;
+
+	unsigned int queries[PARTICLE_TIMER_QUERIES] = {};
+	size_t pendingCounts[PARTICLE_TIMER_QUERIES] = {};
+	int first = 0;
+	int pending = 0;
+	double gpuMs = 0.0;
+	double timedParticles = 0.0;
+};
+
+#endif
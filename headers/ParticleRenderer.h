@@ -0,0 +1,111 @@
+#ifndef PARTICLE_RENDERER_H
+#define PARTICLE_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "ParticleSystem.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Draws every particle as a camera facing quad in one instanced call. The quad corners come from a 4 vertex
+// strip, the per particle center, size and color from an instance buffer: either the renderer's own streaming
+// buffer the CPU simulation writes through map(), or one a compute shader fills (see createVAO()).
+class ParticleRenderer {
+public:
+	~ParticleRenderer() { release(); }
+
+	void init() {
+		release();
+		const float corners[] = { -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f };
+		glGenBuffers(1, &quad);
+		glBindBuffer(GL_ARRAY_BUFFER, quad);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glGenBuffers(1, &instances);
+		vao = createVAO(instances);
+	}
+
+	void release() {
+		if (vao)
+			glDeleteVertexArrays(1, &vao);
+		if (instances)
+			glDeleteBuffers(1, &instances);
+		if (quad)
+			glDeleteBuffers(1, &quad);
+		for (unsigned int extra : extraVAOs)
+			glDeleteVertexArrays(1, &extra);
+		extraVAOs.clear();
+		vao = instances = quad = 0;
+		capacity = 0;
+	}
+
+	// VAO reading ParticleInstance records from buffer: attribute 0 the quad corner, 1 center and size, 2 color
+	unsigned int createVAO(unsigned int buffer) {
+		unsigned int id;
+		glGenVertexArrays(1, &id);
+		glBindVertexArray(id);
+		glBindBuffer(GL_ARRAY_BUFFER, quad);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)0);
+		glVertexAttribDivisor(1, 1);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, color));
+		glVertexAttribDivisor(2, 1);
+		glEnableVertexAttribArray(2);
+		glBindVertexArray(0);
+		if (buffer != instances)
+			extraVAOs.push_back(id);
+		return id;
+	}
+
+	// Write pointer for count instances in the streaming buffer, the previous contents are orphaned so the
+	// GPU never stalls on last frame's draw. unmap() before drawing.
+	ParticleInstance* map(size_t count) {
+		size_t bytes = std::max(count, (size_t)1) * sizeof(ParticleInstance);
+		glBindBuffer(GL_ARRAY_BUFFER, instances);
+		if (bytes > capacity)
+			capacity = bytes;
+		glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+		return (ParticleInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+
+	void unmap() {
+		glBindBuffer(GL_ARRAY_BUFFER, instances);
+		if (!glUnmapBuffer(GL_ARRAY_BUFFER))
+			std::cout << "ERROR::PARTICLE_RENDERER::INSTANCES_LOST" << std::endl;	// Storage was corrupted, skip a frame
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Additive, depth tested against the scene but not written, so particles need no sorting
+	void draw(const Shader& shader, const glm::mat4& view, const glm::mat4& projection, size_t count, unsigned int fromVAO = 0) {
+		if (count == 0)
+			return;
+		shader.use();
+		shader.setMat4("view", glm::value_ptr(view));
+		shader.setMat4("projection", glm::value_ptr(projection));
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		glDepthMask(GL_FALSE);
+		glBindVertexArray(fromVAO ? fromVAO : vao);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+		glBindVertexArray(0);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+
+private:
+	unsigned int quad = 0;
+	unsigned int instances = 0;
+	unsigned int vao = 0;
+	std::vector<unsigned int> extraVAOs;
+	size_t capacity = 0;
+};
+
+#endif
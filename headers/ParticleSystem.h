@@ -0,0 +1,349 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <glm/glm.hpp>
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PARTICLES_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_USE_SSE2
+#endif
+
+const int PARTICLE_CURVE_SIZE = 32;		// Entries the color curve is baked into, also colorCurve[] in particle_update.cs
+const int PARTICLE_CHUNK = 16384;		// Particles per worker task
+const float PARTICLE_DEAD_AGE = 1e30f;	// Age of a free slot, past any lifetime
+
+// What the billboard shader reads per instance: center, size and RGBA8 color
+struct ParticleInstance {
+	float position[3];
+	float size;
+	uint32_t color;
+};
+
+// Color at a point of a particle's life, t = age / lifetime in [0, 1]
+struct ParticleColorKey {
+	float t;
+	glm::vec4 color;
+};
+
+// Behaviour shared by every particle of a system
+struct ParticleSettings {
+	glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+	float drag = 0.5f;			// Fraction of the velocity lost per second
+	float sizeStart = 0.04f;	// World space size, linear over the particle's life
+	float sizeEnd = 0.01f;
+	std::vector<ParticleColorKey> colors = {
+		{ 0.0f, glm::vec4(1.0f, 0.9f, 0.6f, 1.0f) },
+		{ 0.4f, glm::vec4(1.0f, 0.5f, 0.1f, 0.8f) },
+		{ 1.0f, glm::vec4(0.3f, 0.1f, 0.1f, 0.0f) }
+	};
+};
+
+inline uint32_t particlePackColor(const glm::vec4& color) {
+	uint32_t packed = 0;
+	for (int c = 0; c < 4; c++)
+		packed |= (uint32_t)(std::min(std::max(color[c], 0.0f), 1.0f) * 255.0f + 0.5f) << (c * 8);
+	return packed;
+}
+
+// Sample the piecewise linear color keys at PARTICLE_CURVE_SIZE evenly spaced points
+inline void particleBakeCurve(const std::vector<ParticleColorKey>& keys, glm::vec4* curve) {
+	for (int i = 0; i < PARTICLE_CURVE_SIZE; i++) {
+		float t = (float)i / (PARTICLE_CURVE_SIZE - 1);
+		glm::vec4 color = keys.empty() ? glm::vec4(1.0f) : keys.front().color;
+		for (size_t k = 1; k < keys.size(); k++) {
+			if (t > keys[k].t)
+				color = keys[k].color;
+			else {
+				float span = keys[k].t - keys[k - 1].t;
+				float f = span > 0.0f ? (t - keys[k - 1].t) / span : 1.0f;
+				color = keys[k - 1].color + (keys[k].color - keys[k - 1].color) * std::min(std::max(f, 0.0f), 1.0f);
+				break;
+			}
+		}
+		curve[i] = color;
+	}
+}
+
+// xorshift32, plenty for spawn jitter
+inline uint32_t particleRandom(uint32_t& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+inline float particleRandomFloat(uint32_t& state) {
+	return (particleRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Spawns particles at a steady rate inside a sphere, with a base velocity plus random spread
+struct ParticleEmitter {
+	glm::vec3 position = glm::vec3(0.0f);
+	float radius = 0.05f;
+	glm::vec3 velocity = glm::vec3(0.0f, 4.0f, 0.0f);
+	float spread = 1.5f;		// Up to this much added to the velocity along each axis
+	float rate = 1000.0f;		// Particles per second
+	float lifeMin = 1.0f;
+	float lifeMax = 2.0f;
+	bool enabled = true;
+	float accumulator = 0.0f;	// Fractional particles carried to the next frame
+
+	// Particles due after dt seconds
+	int due(float dt) {
+		if (!enabled)
+			return 0;
+		accumulator += rate * dt;
+		int count = (int)accumulator;
+		accumulator -= count;
+		return count;
+	}
+
+	void spawn(uint32_t& rng, float* p, float* v, float& invLife) const {
+		for (int c = 0; c < 3; c++) {
+			p[c] = position[c] + (particleRandomFloat(rng) * 2.0f - 1.0f) * radius;
+			v[c] = velocity[c] + (particleRandomFloat(rng) * 2.0f - 1.0f) * spread;
+		}
+		invLife = 1.0f / (lifeMin + (lifeMax - lifeMin) * particleRandomFloat(rng));
+	}
+};
+
+// CPU particle simulation. Particles live as structure of arrays, updated 8 (AVX) or 4 (SSE) at a time in chunks
+// spread over worker threads, and the same pass writes the render instances so the data is touched once.
+// Slots are never moved: dead particles keep their slot (drawn with size 0) until an emitter reuses it,
+// so instance i always belongs to slot i and the pass can stream straight into a mapped buffer.
+class ParticleSystem {
+public:
+	bool simd = true;	// Off runs the scalar kernel, for comparison
+
+	void init(size_t capacity, const ParticleSettings& settings = ParticleSettings()) {
+		this->capacity = capacity;
+		size_t padded = (capacity + 7) & ~(size_t)7;
+		for (std::vector<float>* array : { &posX, &posY, &posZ, &velX, &velY, &velZ, &age, &invLife })
+			array->assign(padded, 0.0f);
+		std::fill(age.begin(), age.end(), PARTICLE_DEAD_AGE);
+		freeSlots.clear();
+		count = 0;
+		setSettings(settings);
+	}
+
+	void setSettings(const ParticleSettings& settings) {
+		this->settings = settings;
+		glm::vec4 curve[PARTICLE_CURVE_SIZE];
+		particleBakeCurve(settings.colors, curve);
+		for (int i = 0; i < PARTICLE_CURVE_SIZE; i++)
+			colorCurve[i] = particlePackColor(curve[i]);
+	}
+
+	const ParticleSettings& getSettings() const { return settings; }
+
+	size_t addEmitter(const ParticleEmitter& emitter) {
+		emitters.push_back(emitter);
+		return emitters.size() - 1;
+	}
+
+	ParticleEmitter& emitter(size_t index) { return emitters[index]; }
+
+	// Spawn, integrate and age every particle by dt, see emit() and simulate()
+	void update(float dt, ParticleInstance* instances = NULL, int threads = 0) {
+		emit(dt);
+		simulate(dt, instances, threads);
+	}
+
+	// Run the emitters, filling free slots first. Afterwards slotCount() is final for this frame.
+	void emit(float dt) {
+		for (ParticleEmitter& emitter : emitters) {
+			for (int due = emitter.due(dt); due > 0; due--) {
+				size_t slot;
+				if (!freeSlots.empty()) {
+					slot = freeSlots.back();
+					freeSlots.pop_back();
+				}
+				else if (count < capacity)
+					slot = count++;
+				else
+					break;	// Full, the rest of this frame's particles are dropped
+				float p[3], v[3];
+				emitter.spawn(rng, p, v, invLife[slot]);
+				posX[slot] = p[0]; posY[slot] = p[1]; posZ[slot] = p[2];
+				velX[slot] = v[0]; velY[slot] = v[1]; velZ[slot] = v[2];
+				age[slot] = 0.0f;
+			}
+		}
+	}
+
+	// Integrate and age every slot. With instances (room for slotCount() entries) the render data of every
+	// slot is written in the same pass. threads = 0 uses every core.
+	void simulate(float dt, ParticleInstance* instances = NULL, int threads = 0) {
+		if (threads <= 0)
+			threads = defaultThreadCount();
+		if (!pool || pool->threadCount() != threads)
+			pool.reset(new WorkerPool(threads));
+		int chunks = (int)((count + PARTICLE_CHUNK - 1) / PARTICLE_CHUNK);
+		if ((size_t)chunks > died.size())
+			died.resize(chunks);
+		pool->run(chunks, [&](int chunk) {
+			size_t begin = (size_t)chunk * PARTICLE_CHUNK;
+			size_t end = std::min(begin + PARTICLE_CHUNK, count);
+			died[chunk].clear();
+			updateRange(begin, end, dt, instances, died[chunk]);
+		});
+
+		// Slots that died this frame become free, parked far past any lifetime so they stay dead
+		for (int chunk = 0; chunk < chunks; chunk++) {
+			for (uint32_t slot : died[chunk]) {
+				age[slot] = PARTICLE_DEAD_AGE;
+				velX[slot] = velY[slot] = velZ[slot] = 0.0f;
+				freeSlots.push_back(slot);
+			}
+		}
+	}
+
+	// Slots in use, live or dead: how many instances update() writes and a draw should cover
+	size_t slotCount() const { return count; }
+	size_t aliveCount() const { return count - freeSlots.size(); }
+	size_t maxParticles() const { return capacity; }
+
+private:
+	void updateRange(size_t begin, size_t end, float dt, ParticleInstance* instances, std::vector<uint32_t>& dead) {
+		float damping = std::max(1.0f - settings.drag * dt, 0.0f);
+		float g[3] = { settings.gravity.x * dt, settings.gravity.y * dt, settings.gravity.z * dt };
+		float sizeStart = settings.sizeStart, sizeDelta = settings.sizeEnd - settings.sizeStart;
+		alignas(32) float size[8];
+		alignas(32) int curveIndex[8];
+		size_t i = begin;
+
+		// Stores the lanes the SIMD loops computed, AoS instances can't be written with vector stores
+		auto emit = [&](size_t first, int lanes, int deadMask) {
+			if (!instances && !deadMask)
+				return;
+			for (int lane = 0; lane < lanes; lane++) {
+				size_t p = first + lane;
+				if (deadMask & (1 << lane))
+					dead.push_back((uint32_t)p);
+				if (instances) {
+					ParticleInstance& instance = instances[p];
+					instance.position[0] = posX[p];
+					instance.position[1] = posY[p];
+					instance.position[2] = posZ[p];
+					instance.size = size[lane];
+					instance.color = colorCurve[curveIndex[lane]];
+				}
+			}
+		};
+		(void)emit;	// Unused without SSE2
+
+#if defined(PARTICLES_USE_AVX)
+		if (simd) {
+			__m256 vDt = _mm256_set1_ps(dt), vDamping = _mm256_set1_ps(damping), one = _mm256_set1_ps(1.0f);
+			__m256 gx = _mm256_set1_ps(g[0]), gy = _mm256_set1_ps(g[1]), gz = _mm256_set1_ps(g[2]);
+			__m256 vSizeStart = _mm256_set1_ps(sizeStart), vSizeDelta = _mm256_set1_ps(sizeDelta), curveMax = _mm256_set1_ps(PARTICLE_CURVE_SIZE - 1.0f);
+			for (; i + 8 <= end; i += 8) {
+				__m256 vx = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&velX[i]), vDamping), gx);
+				__m256 vy = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&velY[i]), vDamping), gy);
+				__m256 vz = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&velZ[i]), vDamping), gz);
+				_mm256_storeu_ps(&velX[i], vx);
+				_mm256_storeu_ps(&velY[i], vy);
+				_mm256_storeu_ps(&velZ[i], vz);
+				_mm256_storeu_ps(&posX[i], _mm256_add_ps(_mm256_loadu_ps(&posX[i]), _mm256_mul_ps(vx, vDt)));
+				_mm256_storeu_ps(&posY[i], _mm256_add_ps(_mm256_loadu_ps(&posY[i]), _mm256_mul_ps(vy, vDt)));
+				_mm256_storeu_ps(&posZ[i], _mm256_add_ps(_mm256_loadu_ps(&posZ[i]), _mm256_mul_ps(vz, vDt)));
+
+				__m256 a = _mm256_loadu_ps(&age[i]), inv = _mm256_loadu_ps(&invLife[i]);
+				__m256 before = _mm256_mul_ps(a, inv);
+				a = _mm256_add_ps(a, vDt);
+				_mm256_storeu_ps(&age[i], a);
+				__m256 t = _mm256_mul_ps(a, inv);
+				__m256 alive = _mm256_cmp_ps(t, one, _CMP_LT_OQ);
+				int deadMask = _mm256_movemask_ps(_mm256_andnot_ps(alive, _mm256_cmp_ps(before, one, _CMP_LT_OQ)));
+
+				_mm256_store_ps(size, _mm256_and_ps(alive, _mm256_add_ps(vSizeStart, _mm256_mul_ps(vSizeDelta, t))));
+				__m256 index = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(t, curveMax), _mm256_setzero_ps()), curveMax);
+				_mm256_store_si256((__m256i*)curveIndex, _mm256_cvttps_epi32(index));
+				emit(i, 8, deadMask);
+			}
+		}
+#endif
+#if defined(PARTICLES_USE_SSE2) || defined(PARTICLES_USE_AVX)
+		if (simd) {
+			__m128 vDt = _mm_set1_ps(dt), vDamping = _mm_set1_ps(damping), one = _mm_set1_ps(1.0f);
+			__m128 gx = _mm_set1_ps(g[0]), gy = _mm_set1_ps(g[1]), gz = _mm_set1_ps(g[2]);
+			__m128 vSizeStart = _mm_set1_ps(sizeStart), vSizeDelta = _mm_set1_ps(sizeDelta), curveMax = _mm_set1_ps(PARTICLE_CURVE_SIZE - 1.0f);
+			for (; i + 4 <= end; i += 4) {
+				__m128 vx = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&velX[i]), vDamping), gx);
+				__m128 vy = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&velY[i]), vDamping), gy);
+				__m128 vz = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&velZ[i]), vDamping), gz);
+				_mm_storeu_ps(&velX[i], vx);
+				_mm_storeu_ps(&velY[i], vy);
+				_mm_storeu_ps(&velZ[i], vz);
+				_mm_storeu_ps(&posX[i], _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(vx, vDt)));
+				_mm_storeu_ps(&posY[i], _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(vy, vDt)));
+				_mm_storeu_ps(&posZ[i], _mm_add_ps(_mm_loadu_ps(&posZ[i]), _mm_mul_ps(vz, vDt)));
+
+				__m128 a = _mm_loadu_ps(&age[i]), inv = _mm_loadu_ps(&invLife[i]);
+				__m128 before = _mm_mul_ps(a, inv);
+				a = _mm_add_ps(a, vDt);
+				_mm_storeu_ps(&age[i], a);
+				__m128 t = _mm_mul_ps(a, inv);
+				__m128 alive = _mm_cmplt_ps(t, one);
+				int deadMask = _mm_movemask_ps(_mm_andnot_ps(alive, _mm_cmplt_ps(before, one)));
+
+				_mm_store_ps(size, _mm_and_ps(alive, _mm_add_ps(vSizeStart, _mm_mul_ps(vSizeDelta, t))));
+				__m128 index = _mm_min_ps(_mm_max_ps(_mm_mul_ps(t, curveMax), _mm_setzero_ps()), curveMax);
+				_mm_store_si128((__m128i*)curveIndex, _mm_cvttps_epi32(index));
+				emit(i, 4, deadMask);
+			}
+		}
+#endif
+		// Scalar kernel, the reference for the SIMD loops above and the tail they leave
+		for (; i < end; i++) {
+			velX[i] = velX[i] * damping + g[0];
+			velY[i] = velY[i] * damping + g[1];
+			velZ[i] = velZ[i] * damping + g[2];
+			posX[i] += velX[i] * dt;
+			posY[i] += velY[i] * dt;
+			posZ[i] += velZ[i] * dt;
+			float before = age[i] * invLife[i];
+			age[i] += dt;
+			float t = age[i] * invLife[i];
+			bool alive = t < 1.0f;
+			if (!alive && before < 1.0f)
+				dead.push_back((uint32_t)i);
+			if (instances) {
+				ParticleInstance& instance = instances[i];
+				instance.position[0] = posX[i];
+				instance.position[1] = posY[i];
+				instance.position[2] = posZ[i];
+				instance.size = alive ? sizeStart + sizeDelta * t : 0.0f;
+				instance.color = colorCurve[(int)std::min(std::max(t * (PARTICLE_CURVE_SIZE - 1), 0.0f), PARTICLE_CURVE_SIZE - 1.0f)];
+			}
+		}
+	}
+
+	ParticleSettings settings;
+	uint32_t colorCurve[PARTICLE_CURVE_SIZE];
+	std::vector<ParticleEmitter> emitters;
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> velX, velY, velZ;
+	std::vector<float> age;
+	std::vector<float> invLife;
+	std::vector<uint32_t> freeSlots;
+	std::vector<std::vector<uint32_t>> died;	// Per chunk, so workers never share a list
+	std::unique_ptr<WorkerPool> pool;
+	size_t capacity = 0;
+	size_t count = 0;
+	uint32_t rng = 0x9E3779B9u;
+};
+
+#endif
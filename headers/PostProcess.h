@@ -0,0 +1,362 @@
+#ifndef POST_PROCESS_H
+#define POST_PROCESS_H
+
+#include <glad/glad.h>
+
+#include "DebugOutput.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+const int RENDER_TARGET_IDLE_FRAMES = 3;	// Pooled targets unused for longer are deleted
+
+struct RenderTargetDesc {
+	int width;
+	int height;
+	GLenum format;		// Color internal format
+	bool depth;			// With a 24 bit depth / 8 bit stencil renderbuffer
+
+	bool operator==(const RenderTargetDesc& other) const {
+		return width == other.width && height == other.height && format == other.format && depth == other.depth;
+	}
+};
+
+struct RenderTarget {
+	RenderTargetDesc desc;
+	unsigned int fbo;
+	unsigned int texture;
+	unsigned int depthBuffer;
+	uint64_t lastUsed;
+	bool inUse;
+};
+
+// Framebuffers for data that lives within a frame, keyed by (size, format). acquire() hands out a free target with
+// the same description or makes one, release() returns it for the next pass or frame, and targets nobody asked for
+// in the last few frames are deleted, so a resize doesn't keep the old sizes around.
+class RenderTargetPool {
+public:
+	~RenderTargetPool() { release(); }
+
+	RenderTarget* acquire(const RenderTargetDesc& desc) {
+		for (RenderTarget* target : targets) {
+			if (!target->inUse && target->desc == desc) {
+				target->inUse = true;
+				target->lastUsed = frame;
+				reused++;
+				return target;
+			}
+		}
+		RenderTarget* target = new RenderTarget();
+		target->desc = desc;
+		target->inUse = true;
+		target->lastUsed = frame;
+		glGenTextures(1, &target->texture);
+		glBindTexture(GL_TEXTURE_2D, target->texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glGenFramebuffers(1, &target->fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+		target->depthBuffer = 0;
+		if (desc.depth) {
+			glGenRenderbuffers(1, &target->depthBuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, target->depthBuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, desc.width, desc.height);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target->depthBuffer);
+		}
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::RENDER_TARGET_POOL::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		targets.push_back(target);
+		created++;
+		return target;
+	}
+
+	void release(RenderTarget* target) {
+		if (target)
+			target->inUse = false;
+	}
+
+	// Once per frame, deletes targets that have been idle for RENDER_TARGET_IDLE_FRAMES
+	void endFrame() {
+		frame++;
+		for (size_t i = 0; i < targets.size();) {
+			RenderTarget* target = targets[i];
+			if (!target->inUse && frame - target->lastUsed > RENDER_TARGET_IDLE_FRAMES) {
+				destroy(target);
+				targets[i] = targets.back();
+				targets.pop_back();
+			}
+			else
+				i++;
+		}
+	}
+
+	void release() {
+		for (RenderTarget* target : targets)
+			destroy(target);
+		targets.clear();
+	}
+
+	size_t count() const { return targets.size(); }
+
+	size_t bytes() const {
+		size_t total = 0;
+		for (const RenderTarget* target : targets)
+			total += (size_t)target->desc.width * target->desc.height * (textureTexelBytes(target->desc.format) + (target->desc.depth ? 4 : 0));
+		return total;
+	}
+
+	void printReport() const {
+		printf("Render targets: %zu live, %.1f MB, %llu created, %llu reused\n", targets.size(), bytes() / 1e6,
+			(unsigned long long)created, (unsigned long long)reused);
+	}
+
+private:
+	void destroy(RenderTarget* target) {
+		glDeleteFramebuffers(1, &target->fbo);
+		glDeleteTextures(1, &target->texture);
+		if (target->depthBuffer)
+			glDeleteRenderbuffers(1, &target->depthBuffer);
+		delete target;
+	}
+
+	std::vector<RenderTarget*> targets;
+	uint64_t frame = 0;
+	uint64_t created = 0;
+	uint64_t reused = 0;
+};
+
+enum PostPassType {
+	POST_PIXEL,			// Reads only its own pixel, fused with neighbouring POST_PIXEL passes
+	POST_SAMPLE,		// Samples source itself (upscale, sharpen), starts a fused stage the POST_PIXEL passes after it join
+	POST_FULLSCREEN		// Samples freely (blur, ...) and writes a whole image, always a stage of its own
+};
+
+// One step of the post-processing chain. A POST_PIXEL pass is a GLSL snippet (no #version) declaring its uniforms and
+// `vec4 function(vec4 color, vec2 uv)`, a POST_SAMPLE pass one declaring `vec4 function(vec2 uv)` that reads source
+// in place of the stage's plain texture read. A POST_FULLSCREEN pass is a fragment shader for fullscreen.vs. Every stage
+// gets `sampler2D source` (unit 0), `vec2 sourceUVScale` (part of source holding the image), `vec2 texelSize` and
+// `int frame`; other texture units are left as the caller bound them.
+struct PostPass {
+	std::string name;
+	PostPassType type;
+	std::string path;
+	std::string function;
+	GLenum format = GL_RGBA8;	// Format written, intermediate targets come from the pool in this format
+	bool enabled = true;
+};
+
+// Runs a list of passes over an image and writes the result to the default framebuffer. build() merges every run
+// of adjacent POST_PIXEL passes into one generated shader, so a screen sized image is read and written once per run
+// instead of once per pass.
+class PostChain {
+public:
+	~PostChain() { release(); }
+
+	void init() {
+		release();
+		glGenVertexArrays(1, &emptyVAO);
+	}
+
+	void release() {
+		releaseStages();
+		if (emptyVAO)
+			glDeleteVertexArrays(1, &emptyVAO);
+		emptyVAO = 0;
+	}
+
+	size_t add(const PostPass& pass) {
+		passes.push_back(pass);
+		return passes.size() - 1;
+	}
+
+	PostPass* find(const std::string& name) {
+		for (PostPass& pass : passes) {
+			if (pass.name == name)
+				return &pass;
+		}
+		return NULL;
+	}
+
+	// Group the enabled passes into stages and compile them, again after enabling or disabling passes
+	void build() {
+		releaseStages();
+		for (size_t i = 0; i < passes.size(); i++) {
+			if (!passes[i].enabled)
+				continue;
+			bool fuse = passes[i].type == POST_PIXEL && !stages.empty() && stages.back().fused;
+			if (!fuse) {
+				stages.push_back(Stage());
+				stages.back().fused = passes[i].type != POST_FULLSCREEN;
+			}
+			stages.back().passes.push_back(i);
+			stages.back().label += (stages.back().passes.size() > 1 ? " + " : "post: ") + passes[i].name;
+		}
+		for (Stage& stage : stages) {
+			stage.format = passes[stage.passes.back()].format;
+			std::string fragment = stage.fused ? fusedSource(stage) : readSource(passes[stage.passes[0]].path);
+			stage.program = new Shader(Shader::fromSource(readSource("shaders/fullscreen.vs").c_str(), fragment.c_str(), stage.label.c_str()));
+		}
+	}
+
+	// Program running a pass (shared with the passes fused into the same stage), for setting its uniforms.
+	// NULL when the pass is missing or disabled. use() it before setting anything.
+	const Shader* program(const std::string& name) const {
+		for (const Stage& stage : stages) {
+			for (size_t index : stage.passes) {
+				if (passes[index].name == name)
+					return stage.program;
+			}
+		}
+		return NULL;
+	}
+
+	// Process the bottom left viewWidth x viewHeight of source into the default framebuffer at width x height.
+	// Depth testing is off while it runs.
+	void run(RenderTargetPool& pool, const RenderTarget& source, int viewWidth, int viewHeight, int width, int height) {
+		glDisable(GL_DEPTH_TEST);
+		glBindVertexArray(emptyVAO);
+		glActiveTexture(GL_TEXTURE0);
+		glViewport(0, 0, width, height);
+		trafficBytes = savedBytes = 0;
+		size_t pixels = (size_t)width * height;
+		RenderTarget* input = NULL;
+		unsigned int texture = source.texture;
+		glm::vec2 uvScale((float)viewWidth / source.desc.width, (float)viewHeight / source.desc.height);
+		glm::vec2 texelSize(1.0f / source.desc.width, 1.0f / source.desc.height);
+		int readBytes = textureTexelBytes(source.desc.format);
+
+		if (stages.empty()) {
+			// Nothing enabled, copy the image across
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, source.fbo);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			glBlitFramebuffer(0, 0, viewWidth, viewHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		}
+		for (size_t s = 0; s < stages.size(); s++) {
+			const Stage& stage = stages[s];
+			bool last = s + 1 == stages.size();
+			RenderTarget* output = last ? NULL : pool.acquire(RenderTargetDesc{ width, height, stage.format, false });
+			debugPushGroup(stage.label.c_str());
+			glBindFramebuffer(GL_FRAMEBUFFER, output ? output->fbo : 0);
+			stage.program->use();
+			stage.program->setInt("source", 0);
+			stage.program->setVec2("sourceUVScale", uvScale);
+			stage.program->setVec2("texelSize", texelSize);
+			stage.program->setInt("frame", (int)frame);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			pool.release(input);
+			debugPopGroup();
+
+			int writeBytes = last ? 4 : textureTexelBytes(stage.format);
+			trafficBytes += pixels * (readBytes + writeBytes);
+			// Unfused, every pass but the last would write its result and the next pass read it back
+			for (size_t p = 0; p + 1 < stage.passes.size(); p++)
+				savedBytes += pixels * 2 * textureTexelBytes(passes[stage.passes[p]].format);
+
+			input = output;
+			texture = output ? output->texture : 0;
+			uvScale = glm::vec2(1.0f);
+			texelSize = glm::vec2(1.0f / width, 1.0f / height);
+			readBytes = writeBytes;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindVertexArray(0);
+		glEnable(GL_DEPTH_TEST);
+		frame++;
+		totalSavedBytes += savedBytes;
+	}
+
+	size_t stageCount() const { return stages.size(); }
+	size_t bandwidth() const { return trafficBytes; }			// Bytes read and written by the last run()
+	size_t bandwidthSaved() const { return savedBytes; }		// Bytes the last run() didn't move thanks to fusion
+
+	void printReport() const {
+		size_t enabled = 0;
+		for (const PostPass& pass : passes)
+			enabled += pass.enabled ? 1 : 0;
+		printf("Post-processing: %zu passes in %zu stages, %.2f MB/frame moved, %.2f MB/frame saved by fusion (%.1f MB total)\n",
+			enabled, stages.size(), trafficBytes / 1e6, savedBytes / 1e6, totalSavedBytes / 1e6);
+	}
+
+private:
+	struct Stage {
+		std::vector<size_t> passes;
+		bool fused = false;
+		GLenum format = GL_RGBA8;
+		Shader* program = NULL;
+		std::string label;		// "post: " and the pass names, for debug output and frame debuggers
+	};
+
+	static std::string readSource(const std::string& path) {
+		std::ifstream file(path);
+		if (!file) {
+			std::cout << "ERROR::POST_CHAIN::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+			return "";
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		return stream.str();
+	}
+
+	// One fragment shader calling every pass function of the stage in order on a single texture read
+	std::string fusedSource(const Stage& stage) const {
+		std::string source =
+			"#version 330 core\n"
+			"in vec2 TexCoords;\n"
+			"out vec4 FragColor;\n"
+			"uniform sampler2D source;\n"
+			"uniform vec2 sourceUVScale;\n"
+			"uniform vec2 texelSize;\n"
+			"uniform int frame;\n";
+		std::string calls;
+		for (size_t index : stage.passes) {
+			const PostPass& pass = passes[index];
+			source += "\n// " + pass.name + " (" + pass.path + ")\n" + readSource(pass.path);
+			if (pass.type == POST_SAMPLE)
+				calls += "\tvec4 color = " + pass.function + "(TexCoords);\n";
+			else {
+				if (calls.empty())
+					calls += "\tvec4 color = texture(source, TexCoords * sourceUVScale);\n";
+				calls += "\tcolor = " + pass.function + "(color, TexCoords);\n";
+			}
+		}
+		source += "\nvoid main() {\n" + calls + "\tFragColor = color;\n}\n";
+		return source;
+	}
+
+	void releaseStages() {
+		for (Stage& stage : stages) {
+			if (stage.program)
+				glDeleteProgram(stage.program->ID);
+			delete stage.program;
+		}
+		stages.clear();
+	}
+
+	std::vector<PostPass> passes;
+	std::vector<Stage> stages;
+	unsigned int emptyVAO = 0;
+	uint64_t frame = 0;
+	size_t trafficBytes = 0;
+	size_t savedBytes = 0;
+	size_t totalSavedBytes = 0;
+};
+
+#endif
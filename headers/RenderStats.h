@@ -0,0 +1,527 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+
+#include <cstdint>
+#include <cstdio>
+
+// Per frame rendering counters. With RENDER_STATS defined, init() swaps glad's function pointers (and the
+// GLExtensions ones) for counting versions that forward to the driver, so every call site in every module is
+// counted without touching it. Without RENDER_STATS nothing is hooked, the GL calls go straight to the driver and
+// every counter reads 0; only the frame rate is still reported. Debug builds define RENDER_STATS, Release ones only
+// with the LEARNOPENGL_RENDER_STATS CMake option.
+//
+// Buffer bytes are what glBufferData / glBufferSubData send and the length of ranges mapped for writing, texture
+// bytes what glTex(Sub)Image and the compressed forms send, from client memory or a pixel unpack buffer. Uploads
+// through a pixel buffer count in both. Primitives generated and samples passed come from GL queries over the whole
+// frame, post-processing included, and are read without waiting, so they lag the CPU counters by a few frames.
+
+#ifdef RENDER_STATS
+const bool RENDER_STATS_ENABLED = true;
+#else
+const bool RENDER_STATS_ENABLED = false;
+#endif
+
+const int RENDER_STATS_QUERY_FRAMES = 4;	// Frames of queries that may be in flight
+
+enum RenderStat {
+	RENDER_STAT_DRAW_CALLS,
+	RENDER_STAT_TRIANGLES,
+	RENDER_STAT_VERTICES,				// Submitted, instances included
+	RENDER_STAT_DISPATCHES,
+	RENDER_STAT_PROGRAM_BINDS,
+	RENDER_STAT_VAO_BINDS,
+	RENDER_STAT_TEXTURE_BINDS,
+	RENDER_STAT_UNIFORM_CALLS,
+	RENDER_STAT_BUFFER_BYTES,
+	RENDER_STAT_TEXTURE_BYTES,
+	RENDER_STAT_PRIMITIVES_GENERATED,	// GL_PRIMITIVES_GENERATED query
+	RENDER_STAT_SAMPLES_PASSED,			// GL_SAMPLES_PASSED query
+	RENDER_STAT_COUNT
+};
+
+// Keys in the benchmark JSON
+const char* const RENDER_STAT_NAMES[RENDER_STAT_COUNT] = {
+	"drawCalls", "triangles", "vertices", "dispatches", "programBinds", "vaoBinds", "textureBinds", "uniformCalls",
+	"bufferBytes", "textureBytes", "primitivesGenerated", "samplesPassed"
+};
+
+struct RenderStatsFrame {
+	uint64_t value[RENDER_STAT_COUNT] = {};
+
+	uint64_t operator[](RenderStat stat) const { return value[stat]; }
+};
+
+// The frame being counted, bumped by the hooks
+inline RenderStatsFrame& renderStatsCounters() {
+	static RenderStatsFrame counters;
+	return counters;
+}
+
+#ifdef RENDER_STATS
+inline uint64_t renderStatsTriangles(GLenum mode, uint64_t vertices) {
+	switch (mode) {
+	case GL_TRIANGLES: return vertices / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN: return vertices >= 3 ? vertices - 2 : 0;
+	case GL_TRIANGLES_ADJACENCY: return vertices / 6;
+	case GL_TRIANGLE_STRIP_ADJACENCY: return vertices >= 6 ? (vertices - 4) / 2 : 0;
+	default: return 0;
+	}
+}
+
+inline void renderStatsDraw(GLenum mode, uint64_t vertices, uint64_t instances) {
+	RenderStatsFrame& counters = renderStatsCounters();
+	counters.value[RENDER_STAT_VERTICES] += vertices * instances;
+	counters.value[RENDER_STAT_TRIANGLES] += renderStatsTriangles(mode, vertices) * instances;
+}
+
+// Size of one pixel of client data, ignoring unpack row padding
+inline uint64_t renderStatsPixelBytes(GLenum format, GLenum type) {
+	switch (type) {
+	case GL_UNSIGNED_BYTE_3_3_2: case GL_UNSIGNED_BYTE_2_3_3_REV: return 1;
+	case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_5_6_5_REV: case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_4_4_4_4_REV: case GL_UNSIGNED_SHORT_5_5_5_1: case GL_UNSIGNED_SHORT_1_5_5_5_REV: return 2;
+	case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_10_10_10_2:
+	case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+	case GL_UNSIGNED_INT_5_9_9_9_REV: return 4;
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV: return 8;
+	}
+	uint64_t size = type == GL_UNSIGNED_BYTE || type == GL_BYTE ? 1 : (type == GL_UNSIGNED_SHORT || type == GL_SHORT || type == GL_HALF_FLOAT ? 2 : 4);
+	switch (format) {
+	case GL_RG: case GL_RG_INTEGER: return size * 2;
+	case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER: return size * 3;
+	case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: case GL_BGRA_INTEGER: return size * 4;
+	default: return size;
+	}
+}
+
+// Pixel unpack buffer binding, while one is bound a NULL pixel pointer is an offset into it rather than no data
+inline GLuint& renderStatsUnpackBuffer() {
+	static GLuint buffer = 0;
+	return buffer;
+}
+
+inline void renderStatsTextureUpload(const void* pixels, uint64_t bytes) {
+	if (pixels || renderStatsUnpackBuffer())
+		renderStatsCounters().value[RENDER_STAT_TEXTURE_BYTES] += bytes;
+}
+
+// An entry point that only needs counting. Slot tells apart entry points of the same signature.
+template <int Slot, typename... Args>
+struct RenderStatsCallHook {
+	static void (APIENTRYP real)(Args...);
+	static RenderStat stat;
+
+	static void APIENTRY call(Args... args) {
+		renderStatsCounters().value[stat]++;
+		real(args...);
+	}
+};
+
+template <int Slot, typename... Args>
+void (APIENTRYP RenderStatsCallHook<Slot, Args...>::real)(Args...) = NULL;
+template <int Slot, typename... Args>
+RenderStat RenderStatsCallHook<Slot, Args...>::stat = RENDER_STAT_COUNT;
+
+template <int Slot, typename... Args>
+void renderStatsHookCall(void (APIENTRYP& proc)(Args...), RenderStat stat) {
+	if (!proc)
+		return;
+	RenderStatsCallHook<Slot, Args...>::real = proc;
+	RenderStatsCallHook<Slot, Args...>::stat = stat;
+	proc = RenderStatsCallHook<Slot, Args...>::call;
+}
+
+// The driver's entry points behind the hooks that need their arguments
+struct RenderStatsDriver {
+	PFNGLDRAWARRAYSPROC drawArrays;
+	PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced;
+	PFNGLDRAWELEMENTSPROC drawElements;
+	PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
+	PFNGLDRAWELEMENTSBASEVERTEXPROC drawElementsBaseVertex;
+	PFNGLDRAWRANGEELEMENTSPROC drawRangeElements;
+	PFNGLMULTIDRAWARRAYSPROC multiDrawArrays;
+	PFNGLMULTIDRAWELEMENTSPROC multiDrawElements;
+	GLMultiDrawElementsIndirectProc multiDrawElementsIndirect;
+	GLDispatchComputeProc dispatchCompute;
+	PFNGLBINDBUFFERPROC bindBuffer;
+	PFNGLBUFFERDATAPROC bufferData;
+	PFNGLBUFFERSUBDATAPROC bufferSubData;
+	PFNGLMAPBUFFERRANGEPROC mapBufferRange;
+	PFNGLTEXIMAGE2DPROC texImage2D;
+	PFNGLTEXSUBIMAGE2DPROC texSubImage2D;
+	PFNGLTEXIMAGE3DPROC texImage3D;
+	PFNGLTEXSUBIMAGE3DPROC texSubImage3D;
+	PFNGLCOMPRESSEDTEXIMAGE2DPROC compressedTexImage2D;
+	PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC compressedTexSubImage2D;
+};
+
+inline RenderStatsDriver& renderStatsDriver() {
+	static RenderStatsDriver driver = {};
+	return driver;
+}
+
+// Draws count their vertices and triangles, uploads their bytes, then forward
+struct RenderStatsHooks {
+	static void APIENTRY drawArrays(GLenum mode, GLint first, GLsizei count) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		renderStatsDraw(mode, count, 1);
+		renderStatsDriver().drawArrays(mode, first, count);
+	}
+
+	static void APIENTRY drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		renderStatsDraw(mode, count, instances);
+		renderStatsDriver().drawArraysInstanced(mode, first, count, instances);
+	}
+
+	static void APIENTRY drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		renderStatsDraw(mode, count, 1);
+		renderStatsDriver().drawElements(mode, count, type, indices);
+	}
+
+	static void APIENTRY drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		renderStatsDraw(mode, count, instances);
+		renderStatsDriver().drawElementsInstanced(mode, count, type, indices, instances);
+	}
+
+	static void APIENTRY drawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint baseVertex) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		renderStatsDraw(mode, count, 1);
+		renderStatsDriver().drawElementsBaseVertex(mode, count, type, indices, baseVertex);
+	}
+
+	static void APIENTRY drawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void* indices) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		renderStatsDraw(mode, count, 1);
+		renderStatsDriver().drawRangeElements(mode, start, end, count, type, indices);
+	}
+
+	// A multi-draw is one call, its triangles are counted per sub-draw since strips restart between them
+	static void APIENTRY multiDrawArrays(GLenum mode, const GLint* first, const GLsizei* count, GLsizei drawCount) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		for (GLsizei i = 0; i < drawCount; i++)
+			renderStatsDraw(mode, count[i], 1);
+		renderStatsDriver().multiDrawArrays(mode, first, count, drawCount);
+	}
+
+	static void APIENTRY multiDrawElements(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei drawCount) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		for (GLsizei i = 0; i < drawCount; i++)
+			renderStatsDraw(mode, count[i], 1);
+		renderStatsDriver().multiDrawElements(mode, count, type, indices, drawCount);
+	}
+
+	// The counts are in a GPU buffer, the caller reports them through renderStatsIndirect()
+	static void APIENTRY multiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride) {
+		renderStatsCounters().value[RENDER_STAT_DRAW_CALLS]++;
+		renderStatsDriver().multiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+	}
+
+	static void APIENTRY dispatchCompute(GLuint groupsX, GLuint groupsY, GLuint groupsZ) {
+		renderStatsCounters().value[RENDER_STAT_DISPATCHES]++;
+		renderStatsDriver().dispatchCompute(groupsX, groupsY, groupsZ);
+	}
+
+	static void APIENTRY bindBuffer(GLenum target, GLuint buffer) {
+		if (target == GL_PIXEL_UNPACK_BUFFER)
+			renderStatsUnpackBuffer() = buffer;
+		renderStatsDriver().bindBuffer(target, buffer);
+	}
+
+	// Without data glBufferData only allocates
+	static void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		if (data)
+			renderStatsCounters().value[RENDER_STAT_BUFFER_BYTES] += size;
+		renderStatsDriver().bufferData(target, size, data, usage);
+	}
+
+	static void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+		renderStatsCounters().value[RENDER_STAT_BUFFER_BYTES] += size;
+		renderStatsDriver().bufferSubData(target, offset, size, data);
+	}
+
+	static void* APIENTRY mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+		if (access & GL_MAP_WRITE_BIT)
+			renderStatsCounters().value[RENDER_STAT_BUFFER_BYTES] += length;
+		return renderStatsDriver().mapBufferRange(target, offset, length, access);
+	}
+
+	static void APIENTRY texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+		renderStatsTextureUpload(pixels, (uint64_t)width * height * renderStatsPixelBytes(format, type));
+		renderStatsDriver().texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+	}
+
+	static void APIENTRY texSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+		renderStatsTextureUpload(pixels, (uint64_t)width * height * renderStatsPixelBytes(format, type));
+		renderStatsDriver().texSubImage2D(target, level, x, y, width, height, format, type, pixels);
+	}
+
+	static void APIENTRY texImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) {
+		renderStatsTextureUpload(pixels, (uint64_t)width * height * depth * renderStatsPixelBytes(format, type));
+		renderStatsDriver().texImage3D(target, level, internalFormat, width, height, depth, border, format, type, pixels);
+	}
+
+	static void APIENTRY texSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+		renderStatsTextureUpload(pixels, (uint64_t)width * height * depth * renderStatsPixelBytes(format, type));
+		renderStatsDriver().texSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+	}
+
+	static void APIENTRY compressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data) {
+		renderStatsTextureUpload(data, imageSize);
+		renderStatsDriver().compressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data);
+	}
+
+	static void APIENTRY compressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data) {
+		renderStatsTextureUpload(data, imageSize);
+		renderStatsDriver().compressedTexSubImage2D(target, level, x, y, width, height, format, imageSize, data);
+	}
+};
+
+// Replace proc with hook, keeping the driver's function in real
+template <typename Proc>
+void renderStatsHook(Proc& proc, Proc hook, Proc& real) {
+	real = proc;
+	if (proc)
+		proc = hook;
+}
+#endif
+
+// Vertices an indirect draw submitted, for callers that build the commands on the CPU
+inline void renderStatsIndirect(GLenum mode, uint64_t vertices) {
+#ifdef RENDER_STATS
+	renderStatsDraw(mode, vertices, 1);
+#else
+	(void)mode;
+	(void)vertices;
+#endif
+}
+
+// Frames the counters: beginFrame() / endFrame() around the render loop body, then last() holds the frame just
+// ended. report() replaces the old once a second fps printout, adding the counters averaged over that second.
+class RenderStats {
+public:
+	double reportInterval = 1.0;	// Seconds between report() printouts, 0 for none
+
+	~RenderStats() { release(); }
+
+	// Needs the context current and ext loaded, and must run before any module copies a GLExtensions entry point
+	void init(GLExtensions& ext) {
+#ifdef RENDER_STATS
+		static bool hooked = false;
+		if (!hooked) {
+			hooked = true;
+			RenderStatsDriver& driver = renderStatsDriver();
+			renderStatsHook(glad_glDrawArrays, &RenderStatsHooks::drawArrays, driver.drawArrays);
+			renderStatsHook(glad_glDrawArraysInstanced, &RenderStatsHooks::drawArraysInstanced, driver.drawArraysInstanced);
+			renderStatsHook(glad_glDrawElements, &RenderStatsHooks::drawElements, driver.drawElements);
+			renderStatsHook(glad_glDrawElementsInstanced, &RenderStatsHooks::drawElementsInstanced, driver.drawElementsInstanced);
+			renderStatsHook(glad_glDrawElementsBaseVertex, &RenderStatsHooks::drawElementsBaseVertex, driver.drawElementsBaseVertex);
+			renderStatsHook(glad_glDrawRangeElements, &RenderStatsHooks::drawRangeElements, driver.drawRangeElements);
+			renderStatsHook(glad_glMultiDrawArrays, &RenderStatsHooks::multiDrawArrays, driver.multiDrawArrays);
+			renderStatsHook(glad_glMultiDrawElements, &RenderStatsHooks::multiDrawElements, driver.multiDrawElements);
+			renderStatsHook(glad_glBindBuffer, &RenderStatsHooks::bindBuffer, driver.bindBuffer);
+			renderStatsHook(glad_glBufferData, &RenderStatsHooks::bufferData, driver.bufferData);
+			renderStatsHook(glad_glBufferSubData, &RenderStatsHooks::bufferSubData, driver.bufferSubData);
+			renderStatsHook(glad_glMapBufferRange, &RenderStatsHooks::mapBufferRange, driver.mapBufferRange);
+			renderStatsHook(glad_glTexImage2D, &RenderStatsHooks::texImage2D, driver.texImage2D);
+			renderStatsHook(glad_glTexSubImage2D, &RenderStatsHooks::texSubImage2D, driver.texSubImage2D);
+			renderStatsHook(glad_glTexImage3D, &RenderStatsHooks::texImage3D, driver.texImage3D);
+			renderStatsHook(glad_glTexSubImage3D, &RenderStatsHooks::texSubImage3D, driver.texSubImage3D);
+			renderStatsHook(glad_glCompressedTexImage2D, &RenderStatsHooks::compressedTexImage2D, driver.compressedTexImage2D);
+			renderStatsHook(glad_glCompressedTexSubImage2D, &RenderStatsHooks::compressedTexSubImage2D, driver.compressedTexSubImage2D);
+			renderStatsHook(ext.multiDrawElementsIndirect, &RenderStatsHooks::multiDrawElementsIndirect, driver.multiDrawElementsIndirect);
+			renderStatsHook(ext.dispatchCompute, &RenderStatsHooks::dispatchCompute, driver.dispatchCompute);
+
+			renderStatsHookCall<0>(glad_glUseProgram, RENDER_STAT_PROGRAM_BINDS);
+			renderStatsHookCall<1>(glad_glBindVertexArray, RENDER_STAT_VAO_BINDS);
+			renderStatsHookCall<2>(glad_glBindTexture, RENDER_STAT_TEXTURE_BINDS);
+			renderStatsHookCall<10>(glad_glUniform1f, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<11>(glad_glUniform2f, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<12>(glad_glUniform3f, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<13>(glad_glUniform4f, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<14>(glad_glUniform1i, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<15>(glad_glUniform2i, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<16>(glad_glUniform3i, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<17>(glad_glUniform4i, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<18>(glad_glUniform1ui, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<19>(glad_glUniform2ui, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<20>(glad_glUniform3ui, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<21>(glad_glUniform4ui, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<22>(glad_glUniform1fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<23>(glad_glUniform2fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<24>(glad_glUniform3fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<25>(glad_glUniform4fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<26>(glad_glUniform1iv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<27>(glad_glUniform2iv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<28>(glad_glUniform3iv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<29>(glad_glUniform4iv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<30>(glad_glUniform1uiv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<31>(glad_glUniform2uiv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<32>(glad_glUniform3uiv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<33>(glad_glUniform4uiv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<34>(glad_glUniformMatrix2fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<35>(glad_glUniformMatrix3fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<36>(glad_glUniformMatrix4fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<37>(glad_glUniformMatrix2x3fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<38>(glad_glUniformMatrix3x2fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<39>(glad_glUniformMatrix2x4fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<40>(glad_glUniformMatrix4x2fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<41>(glad_glUniformMatrix3x4fv, RENDER_STAT_UNIFORM_CALLS);
+			renderStatsHookCall<42>(glad_glUniformMatrix4x3fv, RENDER_STAT_UNIFORM_CALLS);
+		}
+		release();
+		glGenQueries(RENDER_STATS_QUERY_FRAMES * 2, queries);
+		first = pending = 0;
+		active = false;
+#else
+		(void)ext;
+#endif
+	}
+
+	void release() {
+#ifdef RENDER_STATS
+		if (queries[0])
+			glDeleteQueries(RENDER_STATS_QUERY_FRAMES * 2, queries);
+		queries[0] = 0;
+#endif
+	}
+
+	void beginFrame() {
+		if (frames == 0)
+			renderStatsCounters() = RenderStatsFrame();		// Loading traffic is not a frame's
+#ifdef RENDER_STATS
+		poll();
+		active = queries[0] && pending < RENDER_STATS_QUERY_FRAMES;
+		if (active) {
+			int slot = (first + pending) % RENDER_STATS_QUERY_FRAMES;
+			glBeginQuery(GL_PRIMITIVES_GENERATED, queries[slot * 2]);
+			glBeginQuery(GL_SAMPLES_PASSED, queries[slot * 2 + 1]);
+		}
+#endif
+	}
+
+	// Calls between endFrame() and the next beginFrame() count towards the next frame
+	void endFrame() {
+#ifdef RENDER_STATS
+		if (active) {
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+			glEndQuery(GL_SAMPLES_PASSED);
+			pending++;
+			active = false;
+		}
+#endif
+		RenderStatsFrame& counters = renderStatsCounters();
+		counters.value[RENDER_STAT_PRIMITIVES_GENERATED] = primitivesGenerated;
+		counters.value[RENDER_STAT_SAMPLES_PASSED] = samplesPassed;
+		lastFrame = counters;
+		counters = RenderStatsFrame();
+		for (int i = 0; i < RENDER_STAT_COUNT; i++) {
+			intervalSums[i] += lastFrame.value[i];
+			totals[i] += lastFrame.value[i];
+		}
+		intervalFrames++;
+		frames++;
+	}
+
+	const RenderStatsFrame& last() const { return lastFrame; }
+	uint64_t last(RenderStat stat) const { return lastFrame[stat]; }
+	uint64_t frameCount() const { return frames; }
+	double average(RenderStat stat) const { return frames ? (double)totals[stat] / frames : 0.0; }
+
+	// Print the frame rate and the per frame averages once every reportInterval seconds, call once per frame
+	void report(double now) {
+		if (intervalStart < 0.0)
+			intervalStart = now;
+		double elapsed = now - intervalStart;
+		if (reportInterval <= 0.0 || elapsed < reportInterval || intervalFrames == 0)
+			return;
+		printf("%.1f fps, %.2f ms/frame\n", intervalFrames / elapsed, 1000.0 * elapsed / intervalFrames);
+		if (RENDER_STATS_ENABLED) {
+			double frame[RENDER_STAT_COUNT];
+			for (int i = 0; i < RENDER_STAT_COUNT; i++)
+				frame[i] = (double)intervalSums[i] / intervalFrames;
+			printStats(frame);
+		}
+		for (int i = 0; i < RENDER_STAT_COUNT; i++)
+			intervalSums[i] = 0;
+		intervalFrames = 0;
+		intervalStart = now;
+	}
+
+	// Averages over every frame of the run
+	void printReport() const {
+		if (!RENDER_STATS_ENABLED || frames == 0)
+			return;
+		printf("Render stats: %llu frames, per frame on average\n", (unsigned long long)frames);
+		double frame[RENDER_STAT_COUNT];
+		for (int i = 0; i < RENDER_STAT_COUNT; i++)
+			frame[i] = average((RenderStat)i);
+		printStats(frame);
+	}
+
+private:
+	static const char* scaled(double value, char* buffer, size_t size) {
+		if (value >= 1e9)
+			snprintf(buffer, size, "%.2fG", value / 1e9);
+		else if (value >= 1e6)
+			snprintf(buffer, size, "%.2fM", value / 1e6);
+		else if (value >= 1e4)
+			snprintf(buffer, size, "%.1fK", value / 1e3);
+		else
+			snprintf(buffer, size, "%.0f", value);
+		return buffer;
+	}
+
+	static void printStats(const double* frame) {
+		char a[16], b[16], c[16], d[16];
+		printf("  %.0f draws, %s triangles, %s vertices, %.0f dispatches, %.0f program / %.0f VAO / %.0f texture binds, %.0f uniforms\n",
+			frame[RENDER_STAT_DRAW_CALLS], scaled(frame[RENDER_STAT_TRIANGLES], a, sizeof(a)), scaled(frame[RENDER_STAT_VERTICES], b, sizeof(b)),
+			frame[RENDER_STAT_DISPATCHES], frame[RENDER_STAT_PROGRAM_BINDS], frame[RENDER_STAT_VAO_BINDS], frame[RENDER_STAT_TEXTURE_BINDS],
+			frame[RENDER_STAT_UNIFORM_CALLS]);
+		printf("  %sB to buffers, %sB to textures, GPU: %s primitives generated, %s samples passed\n",
+			scaled(frame[RENDER_STAT_BUFFER_BYTES], a, sizeof(a)), scaled(frame[RENDER_STAT_TEXTURE_BYTES], b, sizeof(b)),
+			scaled(frame[RENDER_STAT_PRIMITIVES_GENERATED], c, sizeof(c)), scaled(frame[RENDER_STAT_SAMPLES_PASSED], d, sizeof(d)));
+	}
+
+#ifdef RENDER_STATS
+	// Collect finished queries without waiting, the newest result is what later frames report
+	void poll() {
+		while (pending > 0) {
+			GLint available = 0;
+			glGetQueryObjectiv(queries[first * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				break;
+			GLuint64 primitives = 0, samples = 0;
+			glGetQueryObjectui64v(queries[first * 2], GL_QUERY_RESULT, &primitives);
+			glGetQueryObjectui64v(queries[first * 2 + 1], GL_QUERY_RESULT, &samples);
+			primitivesGenerated = primitives;
+			samplesPassed = samples;
+			first = (first + 1) % RENDER_STATS_QUERY_FRAMES;
+			pending--;
+		}
+	}
+
+	unsigned int queries[RENDER_STATS_QUERY_FRAMES * 2] = {};
+	int first = 0;
+	int pending = 0;
+	bool active = false;
+#endif
+	uint64_t primitivesGenerated = 0;
+	uint64_t samplesPassed = 0;
+
+	RenderStatsFrame lastFrame;
+	uint64_t totals[RENDER_STAT_COUNT] = {};
+	uint64_t intervalSums[RENDER_STAT_COUNT] = {};
+	uint64_t intervalFrames = 0;
+	double intervalStart = -1.0;
+	uint64_t frames = 0;
+};
+
+#endif
@@ -0,0 +1,337 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <glad/glad.h>
+
+#include "DebugOutput.h"
+#include "GLExtensions.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+enum ResourceType {
+	RESOURCE_BUFFER,
+	RESOURCE_TEXTURE,
+	RESOURCE_PROGRAM,
+	RESOURCE_TYPE_COUNT
+};
+
+// Handle to a managed GL object. The generation makes handles to released slots fail instead of aliasing whatever
+// reuses the slot, and the type parameter keeps a buffer handle from being passed where a texture is expected.
+template <int Type>
+struct ResourceHandle {
+	uint32_t index = 0;
+	uint32_t generation = 0;	// 0 is never issued, so a default handle is invalid
+
+	bool valid() const { return generation != 0; }
+	bool operator==(const ResourceHandle& other) const { return index == other.index && generation == other.generation; }
+};
+
+typedef ResourceHandle<RESOURCE_BUFFER> BufferHandle;
+typedef ResourceHandle<RESOURCE_TEXTURE> TextureHandle;
+typedef ResourceHandle<RESOURCE_PROGRAM> ProgramHandle;
+
+// FNV-1a over 8 byte words (bytes for the tail), content keys for buffers. Word steps keep hashing a
+// large mesh in the milliseconds, the key also carries the size so collisions need equal lengths too.
+inline uint64_t resourceHash(const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 0xCBF29CE484222325ull;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * 0x100000001B3ull;
+		hash ^= hash >> 29;		// Plain FNV only mixes the low bits of a wide input upwards
+	}
+	for (; i < size; i++)
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	return hash;
+}
+
+// Approximate bytes per texel drivers allocate for an uncompressed internal format (3 channel formats are padded to 4)
+inline int textureTexelBytes(GLint internalFormat) {
+	switch (internalFormat) {
+	case GL_R8: return 1;
+	case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+	case GL_RGBA16F: case GL_RGB16F: case GL_RG32F: return 8;
+	case GL_RGBA32F: case GL_RGB32F: return 16;
+	default: return 4;
+	}
+}
+
+// Owns the GL buffers, textures and programs handed to it. Identical assets are shared: static buffers are keyed
+// on their target and a hash of their contents, textures on the path they were loaded from. Each acquire adds a reference, and an
+// object whose last reference is released is only deleted once a fence shows the GPU has finished the frames
+// that could still use it. Bytes are tallied per type so budgets can be checked at runtime.
+class ResourceManager {
+public:
+	~ResourceManager() { shutdown(); }
+
+	void init(const GLExtensions& ext) {
+		programBinary = ext.getProgramBinary;
+	}
+
+	// Upload data to a new buffer, or share an existing one with the same key, or for GL_STATIC_DRAW data the same
+	// target and contents. Buffers that will be written (other usages) or are only allocated (data NULL) without a
+	// key are never shared, a glBufferSubData on them must not reach other users. Either way the buffer is left
+	// bound to target. A given key also labels it for debug output.
+	BufferHandle createBuffer(GLenum target, const void* data, size_t size, GLenum usage = GL_STATIC_DRAW, const std::string& key = "") {
+		std::string name = key;
+		if (name.empty() && data != NULL && usage == GL_STATIC_DRAW) {
+			char hash[64];
+			snprintf(hash, sizeof(hash), "#%04x:%016llx:%zu", target, (unsigned long long)resourceHash(data, size), size);
+			name = hash;
+		}
+		BufferHandle handle;
+		if (!name.empty() && find(RESOURCE_BUFFER, name, handle.index, handle.generation)) {
+			glBindBuffer(target, slots[handle.index].id);
+			return handle;
+		}
+
+		unsigned int id;
+		glGenBuffers(1, &id);
+		glBindBuffer(target, id);
+		glBufferData(target, size, data, usage);
+		if (!key.empty())
+			debugLabel(GL_BUFFER, id, key.c_str());
+		add(RESOURCE_BUFFER, id, size, name, handle.index, handle.generation);
+		return handle;
+	}
+
+	// Texture loaded from path by create() (which returns the GL name and leaves it bound to target),
+	// created only if no live texture was loaded from that path yet. The path labels it for debug output.
+	template <typename Create>
+	TextureHandle loadTexture(const std::string& path, GLenum target, Create create) {
+		TextureHandle handle;
+		if (find(RESOURCE_TEXTURE, path, handle.index, handle.generation))
+			return handle;
+		unsigned int id = create();
+		debugLabel(GL_TEXTURE, id, path.c_str());
+		add(RESOURCE_TEXTURE, id, textureBytes(target, id), path, handle.index, handle.generation);
+		return handle;
+	}
+
+	// Take ownership of a texture created elsewhere, e.g. a texture array
+	TextureHandle adoptTexture(unsigned int id, GLenum target) {
+		TextureHandle handle;
+		add(RESOURCE_TEXTURE, id, textureBytes(target, id), "", handle.index, handle.generation);
+		return handle;
+	}
+
+	// Take ownership of a linked program, e.g. Shader::ID
+	ProgramHandle adoptProgram(unsigned int id) {
+		ProgramHandle handle;
+		GLint binaryLength = 0;
+		if (programBinary)
+			glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &binaryLength);	// Closest thing to the program's footprint
+		add(RESOURCE_PROGRAM, id, (size_t)binaryLength, "", handle.index, handle.generation);
+		return handle;
+	}
+
+	// GL name behind a handle, 0 once it has been released
+	template <int Type>
+	unsigned int get(ResourceHandle<Type> handle) const {
+		const Slot* slot = lookup(Type, handle.index, handle.generation);
+		return slot ? slot->id : 0;
+	}
+
+	template <int Type>
+	void acquire(ResourceHandle<Type> handle) {
+		Slot* slot = lookup(Type, handle.index, handle.generation);
+		if (slot)
+			slot->refCount++;
+	}
+
+	// Drop a reference, the GL object is deleted by a later endFrame() once the GPU is done with it
+	template <int Type>
+	void release(ResourceHandle<Type>& handle) {
+		Slot* slot = lookup(Type, handle.index, handle.generation);
+		handle = ResourceHandle<Type>();
+		if (slot == NULL || --slot->refCount > 0)
+			return;
+		if (!slot->key.empty())
+			keys[slot->type].erase(slot->key);
+		slot->generation++;		// Outstanding copies of the handle stop resolving right away
+		slot->retired = true;
+		pendingBytes[slot->type] += slot->bytes;
+		retiring.push_back((uint32_t)(slot - &slots[0]));
+	}
+
+	// Call once per frame after submitting it: fences this frame's releases and deletes those the GPU has finished with
+	void endFrame() {
+		if (!retiring.empty()) {
+			retired.push_back(Retired{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), retiring });
+			retiring.clear();
+		}
+		while (!retired.empty()) {
+			GLenum status = glClientWaitSync(retired.front().fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;	// Later batches are newer, no point checking them
+			glDeleteSync(retired.front().fence);
+			for (uint32_t index : retired.front().slots)
+				destroy(index);
+			retired.pop_front();
+		}
+	}
+
+	// Wait for the GPU and delete everything released so far, e.g. at exit. What is still counted after it was
+	// never released.
+	void finish() {
+		endFrame();
+		for (Retired& batch : retired)
+			glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+		endFrame();
+	}
+
+	// Delete everything now, the context must still be current
+	void shutdown() {
+		for (Retired& batch : retired)
+			glDeleteSync(batch.fence);
+		retired.clear();
+		retiring.clear();
+		for (size_t i = 0; i < slots.size(); i++) {
+			if (slots[i].id != 0)
+				destroy((uint32_t)i);
+		}
+		for (int t = 0; t < RESOURCE_TYPE_COUNT; t++)
+			keys[t].clear();
+	}
+
+	// Bytes held by live objects of a type (including released ones still waiting on their fence)
+	size_t bytes(ResourceType type) const { return totalBytes[type]; }
+	size_t bytesPendingDelete(ResourceType type) const { return pendingBytes[type]; }
+	size_t count(ResourceType type) const { return counts[type]; }
+
+	void printReport() const {
+		static const char* names[RESOURCE_TYPE_COUNT] = { "buffers", "textures", "programs" };
+		for (int t = 0; t < RESOURCE_TYPE_COUNT; t++)
+			printf("%-9s %4zu objects %9.2f MB (%.2f MB pending delete)\n", names[t], counts[t], totalBytes[t] / 1048576.0, pendingBytes[t] / 1048576.0);
+	}
+
+private:
+	struct Slot {
+		unsigned int id = 0;
+		ResourceType type = RESOURCE_BUFFER;
+		size_t bytes = 0;
+		uint32_t refCount = 0;
+		uint32_t generation = 1;
+		bool retired = false;
+		std::string key;
+	};
+
+	struct Retired {
+		GLsync fence;
+		std::vector<uint32_t> slots;
+	};
+
+	Slot* lookup(int type, uint32_t index, uint32_t generation) {
+		if (index >= slots.size() || slots[index].generation != generation || slots[index].type != type || slots[index].id == 0 || slots[index].retired)
+			return NULL;
+		return &slots[index];
+	}
+
+	const Slot* lookup(int type, uint32_t index, uint32_t generation) const {
+		return const_cast<ResourceManager*>(this)->lookup(type, index, generation);
+	}
+
+	// Live object under key: add a reference and return its handle
+	bool find(ResourceType type, const std::string& key, uint32_t& index, uint32_t& generation) {
+		auto it = keys[type].find(key);
+		if (it == keys[type].end())
+			return false;
+		Slot& slot = slots[it->second];
+		slot.refCount++;
+		index = it->second;
+		generation = slot.generation;
+		return true;
+	}
+
+	void add(ResourceType type, unsigned int id, size_t size, const std::string& key, uint32_t& index, uint32_t& generation) {
+		if (freeSlots.empty()) {
+			freeSlots.push_back((uint32_t)slots.size());
+			slots.emplace_back();
+		}
+		index = freeSlots.back();
+		freeSlots.pop_back();
+		Slot& slot = slots[index];
+		slot.id = id;
+		slot.type = type;
+		slot.bytes = size;
+		slot.refCount = 1;
+		slot.retired = false;
+		slot.key = key;
+		generation = slot.generation;
+		if (!key.empty())
+			keys[type][key] = index;
+		totalBytes[type] += size;
+		counts[type]++;
+	}
+
+	void destroy(uint32_t index) {
+		Slot& slot = slots[index];
+		if (slot.type == RESOURCE_BUFFER)
+			glDeleteBuffers(1, &slot.id);
+		else if (slot.type == RESOURCE_TEXTURE)
+			glDeleteTextures(1, &slot.id);
+		else
+			glDeleteProgram(slot.id);
+		totalBytes[slot.type] -= slot.bytes;
+		counts[slot.type]--;
+		if (slot.retired)
+			pendingBytes[slot.type] -= slot.bytes;
+		slot.id = 0;
+		slot.retired = false;
+		slot.generation++;
+		slot.key.clear();
+		freeSlots.push_back(index);
+	}
+
+	// Sum the storage of every level the texture has, as the driver reports it
+	static size_t textureBytes(GLenum target, unsigned int id) {
+		GLint previous = 0;
+		glGetIntegerv(target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &previous);
+		glBindTexture(target, id);
+		size_t total = 0;
+		for (int level = 0; level < 16; level++) {
+			GLint width = 0, height = 0, depth = 0, compressed = 0, format = 0;
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+				break;
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+			if (compressed) {
+				GLint size = 0;
+				glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+				total += (size_t)size;
+			}
+			else {
+				glGetTexLevelParameteriv(target, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
+				total += (size_t)width * height * (depth > 0 ? depth : 1) * textureTexelBytes(format);
+			}
+		}
+		glBindTexture(target, previous);
+		return total;
+	}
+
+	bool programBinary = false;
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<std::string, uint32_t> keys[RESOURCE_TYPE_COUNT];
+	std::vector<uint32_t> retiring;
+	std::deque<Retired> retired;
+	size_t totalBytes[RESOURCE_TYPE_COUNT] = {};
+	size_t pendingBytes[RESOURCE_TYPE_COUNT] = {};
+	size_t counts[RESOURCE_TYPE_COUNT] = {};
+};
+
+#endif
@@ -6,6 +6,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "DebugOutput.h"
+#include "GLExtensions.h"
+
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -18,14 +23,6 @@ struct Material {
 	float shininess;
 };
 
-struct Light {
-	glm::vec3 position;
-
-	glm::vec3 ambient;
-	glm::vec3 diffuse;
-	glm::vec3 specular;
-};
-
 class Shader {
 public:
 	unsigned int ID;	// Program ID
@@ -61,106 +58,168 @@ public:
 		}
 
 		// 2. Compile shaders
-		const char* vShaderCode = vertexCode.c_str();
-		const char* fShaderCode = fragmentCode.c_str();
+		build(vertexCode.c_str(), fragmentCode.c_str(), (std::string(vertexPath) + " + " + fragmentPath).c_str());
+	}
 
-		unsigned int vertex, fragment;
-		int success;
-		char infoLog[512];
+	// Program built from source held in memory, e.g. generated by PostChain. label names it in debug output.
+	static Shader fromSource(const char* vertexCode, const char* fragmentCode, const char* label = "generated") {
+		Shader shader;
+		shader.build(vertexCode, fragmentCode, label);
+		return shader;
+	}
 
-		// Create vertex shader
-		vertex = glCreateShader(GL_VERTEX_SHADER);				// Create a vertex shader
-		glShaderSource(vertex, 1, &vShaderCode, NULL);			// Attach the vertex shader source code
-		glCompileShader(vertex);								// Compile the vertex shader
-		// Check for vertex shader compile errors
-		glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+	// Compute program from a single shader, needs GL 4.3 (GLExtensions::computeShader)
+	explicit Shader(const char* computePath) {
+		std::string computeCode;
+		std::ifstream cShaderFile;
+		cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+		try {
+			cShaderFile.open(computePath);
+			std::stringstream cShaderStream;
+			cShaderStream << cShaderFile.rdbuf();
+			cShaderFile.close();
+			computeCode = cShaderStream.str();
+		}
+		catch (std::ifstream::failure e) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
 		}
 
-		// Create fragment shader
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);			// Create a fragment shader
-		glShaderSource(fragment, 1, &fShaderCode, NULL);		// Attach the fragment shader source code
-		glCompileShader(fragment);								// Compile the fragment shader
-		// Check for fragment shader compile errors
-		glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+		const char* cShaderCode = computeCode.c_str();
+		int success;
+
+		unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(compute, 1, &cShaderCode, NULL);
+		glCompileShader(compute);
+		glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
 		if (!success) {
-			glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+			std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED " << computePath << "\n" << shaderInfoLog(compute) << std::endl;
 		}
 
-		// Shader program
 		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
+		glAttachShader(ID, compute);
 		glLinkProgram(ID);
-		// Check for shader program linking errors
 		glGetProgramiv(ID, GL_LINK_STATUS, &success);
 		if (!success) {
-			glGetProgramInfoLog(ID, 512, NULL, infoLog);
-			std::cout << "ERROR::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+			std::cout << "ERROR::PROGRAM::LINKING_FAILED " << computePath << "\n" << programInfoLog(ID) << std::endl;
 		}
+		debugLabel(GL_PROGRAM, ID, computePath);
 
-		// Delete vertex and fragment shader instances as they have been linked
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		glDeleteShader(compute);
 	}
 
 	// Use / Activate the shader
-	void use() {
+	void use() const {
 		glUseProgram(ID);
 	}
 
-	void setMaterial(Material material) {
-		setVec3("material.ambient", material.ambient);
-		setVec3("material.diffuse", material.diffuse);
-		setVec3("material.specular", material.specular);
-		setFloat("material.shininess", material.shininess);
+	// Uniform names are C strings so literals don't build a std::string on every call
+	void setBool(const char* name, bool value) const {
+		glUniform1i(glGetUniformLocation(ID, name), (int)value);
+	}
+
+	void setInt(const char* name, int value) const {
+		glUniform1i(glGetUniformLocation(ID, name), value);
+	}
+
+	void setIntArray(const char* name, const int* values, int count) const {
+		glUniform1iv(glGetUniformLocation(ID, name), count, values);
+	}
+
+	void setFloat(const char* name, float value) const {
+		glUniform1f(glGetUniformLocation(ID, name), value);
 	}
 
-	void setLight(Light light) {
-		setVec3("light.position", light.position);
-		setVec3("light.ambient", light.ambient);
-		setVec3("light.diffuse", light.diffuse);
-		setVec3("light.specular", light.specular);
+	void setFloat3(const char* name, float value1, float value2, float value3) const {
+		glUniform3f(glGetUniformLocation(ID, name), value1, value2, value3);
 	}
 
-	void setBool(const std::string& name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	void setFloat4(const char* name, float value1, float value2, float value3, float value4) const {
+		glUniform4f(glGetUniformLocation(ID, name), value1, value2, value3, value4);
 	}
 
-	void setInt(const std::string& name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	void setMat3(const char* name, const GLfloat* mat) const {
+		glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, mat);
 	}
 
-	void setFloat(const std::string& name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	void setMat4(const char* name, const GLfloat* mat) const {
+		glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, mat);
 	}
 
-	void setFloat3(const std::string& name, float value1, float value2, float value3) const {
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), value1, value2, value3);
+	void setVec2(const char* name, const glm::vec2& vec) const {
+		glUniform2f(glGetUniformLocation(ID, name), vec.x, vec.y);
 	}
 
-	void setFloat4(const std::string& name, float value1, float value2, float value3, float value4) const {
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), value1, value2, value3, value4);
+	void setVec3(const char* name, const glm::vec3& vec) const {
+		glUniform3f(glGetUniformLocation(ID, name), vec.x, vec.y, vec.z);
 	}
 
-	void setMat3(const std::string& name, const GLfloat* mat) {
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, mat);
+	void setVec4(const char* name, const glm::vec4& vec) const {
+		glUniform4f(glGetUniformLocation(ID, name), vec.x, vec.y, vec.z, vec.w);
 	}
 
-	void setMat4(const std::string& name, const GLfloat* mat) {
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, mat);
+private:
+	Shader() : ID(0) {}
+
+	// The whole log, however long the driver's is
+	static std::string shaderInfoLog(unsigned int shader) {
+		GLint length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+		std::string log(std::max(length, 1), '\0');
+		glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+		log.resize(strlen(log.c_str()));
+		return log;
 	}
 
-	void setVec3(const std::string& name, glm::vec3 vec) {
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), vec.x, vec.y, vec.z);
+	static std::string programInfoLog(unsigned int program) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+		std::string log(std::max(length, 1), '\0');
+		glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, &log[0]);
+		log.resize(strlen(log.c_str()));
+		return log;
 	}
 
-	void setVec4(const std::string& name, glm::vec4 vec) {
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), vec.x, vec.y, vec.z, vec.w);
+	void build(const char* vShaderCode, const char* fShaderCode, const char* label) {
+		unsigned int vertex, fragment;
+		int success;
+
+		// Create vertex shader
+		vertex = glCreateShader(GL_VERTEX_SHADER);				// Create a vertex shader
+		glShaderSource(vertex, 1, &vShaderCode, NULL);			// Attach the vertex shader source code
+		glCompileShader(vertex);								// Compile the vertex shader
+		// Check for vertex shader compile errors
+		glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED " << label << "\n" << shaderInfoLog(vertex) << std::endl;
+		}
+
+		// Create fragment shader
+		fragment = glCreateShader(GL_FRAGMENT_SHADER);			// Create a fragment shader
+		glShaderSource(fragment, 1, &fShaderCode, NULL);		// Attach the fragment shader source code
+		glCompileShader(fragment);								// Compile the fragment shader
+		// Check for fragment shader compile errors
+		glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED " << label << "\n" << shaderInfoLog(fragment) << std::endl;
+		}
+
+		// Shader program
+		ID = glCreateProgram();
+		glAttachShader(ID, vertex);
+		glAttachShader(ID, fragment);
+		glLinkProgram(ID);
+		// Check for shader program linking errors
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		if (!success) {
+			std::cout << "ERROR::PROGRAM::LINKING_FAILED " << label << "\n" << programInfoLog(ID) << std::endl;
+		}
+		debugLabel(GL_PROGRAM, ID, label);
+
+		// Delete vertex and fragment shader instances as they have been linked
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
 	}
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,309 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "MipGenerator.h"
+#include "TexturePack.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Regions a shader can index, MAX_TEXTURES in shaders/fragment_shader_2.fs
+const int TEXTURE_ARRAY_MAX_REGIONS = 32;
+
+// Where a packed texture ended up: the array layer and its UV rectangle (xy offset, zw scale) within that layer
+struct TextureRegion {
+	int layer;
+	glm::vec4 rect;
+};
+
+// Bottom-left skyline bin packer for one atlas page
+class SkylinePacker {
+public:
+	SkylinePacker(int width, int height) : width(width), height(height) {
+		skyline.push_back(Node{ 0, 0, width });
+	}
+
+	// Find a spot for a w x h rectangle, returns false when the page is full
+	bool insert(int w, int h, int& outX, int& outY) {
+		int bestIndex = -1, bestY = height, bestWidth = width + 1;
+		for (size_t i = 0; i < skyline.size(); i++) {
+			int y;
+			if (!fits(i, w, h, y))
+				continue;
+			// Lowest position first, then the tightest segment to keep the skyline flat
+			if (y < bestY || (y == bestY && skyline[i].width < bestWidth)) {
+				bestIndex = (int)i;
+				bestY = y;
+				bestWidth = skyline[i].width;
+			}
+		}
+		if (bestIndex < 0)
+			return false;
+
+		outX = skyline[bestIndex].x;
+		outY = bestY;
+		skyline.insert(skyline.begin() + bestIndex, Node{ outX, bestY + h, w });
+
+		// Shrink or drop the segments now covered by the new one
+		for (size_t i = bestIndex + 1; i < skyline.size(); i++) {
+			Node& prev = skyline[i - 1];
+			Node& node = skyline[i];
+			int overlap = prev.x + prev.width - node.x;
+			if (overlap <= 0)
+				break;
+			node.x += overlap;
+			node.width -= overlap;
+			if (node.width > 0)
+				break;
+			skyline.erase(skyline.begin() + i);
+			i--;
+		}
+		// Merge neighbours at the same height
+		for (size_t i = 0; i + 1 < skyline.size(); i++) {
+			if (skyline[i].y == skyline[i + 1].y) {
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+				i--;
+			}
+		}
+		return true;
+	}
+
+private:
+	struct Node {
+		int x;
+		int y;
+		int width;
+	};
+
+	// Height a rectangle would rest at when its left edge is on node i
+	bool fits(size_t i, int w, int h, int& y) const {
+		int x = skyline[i].x;
+		if (x + w > width)
+			return false;
+		y = 0;
+		int remaining = w;
+		while (remaining > 0) {
+			if (i >= skyline.size())
+				return false;
+			y = std::max(y, skyline[i].y);
+			if (y + h > height)
+				return false;
+			remaining -= skyline[i].width;
+			i++;
+		}
+		return true;
+	}
+
+	int width;
+	int height;
+	std::vector<Node> skyline;
+};
+
+// Collects textures and packs them into one GL_TEXTURE_2D_ARRAY so any number of materials can sample
+// them without rebinding. Everything is expanded to RGBA8, which drivers use to store RGB8 anyway.
+// When all textures share a size each one becomes a layer, otherwise they are skyline packed into atlas pages.
+class TextureArrayBuilder {
+public:
+	// pageSize 0 picks the smallest power of two that fits the largest texture
+	TextureArrayBuilder(int pageSize = 0, int padding = 4) : pageSize(pageSize), padding(padding) {}
+
+	// Queue an image, returns its index into the regions produced by build(), or -1 once TEXTURE_ARRAY_MAX_REGIONS
+	// are queued
+	int add(const unsigned char* pixels, int width, int height, int channels, int rowPitch = 0) {
+		if (images.size() >= (size_t)TEXTURE_ARRAY_MAX_REGIONS) {
+			std::cout << "ERROR::TEXTURE_ARRAY::TOO_MANY_TEXTURES more than " << TEXTURE_ARRAY_MAX_REGIONS << std::endl;
+			return -1;
+		}
+		if (rowPitch == 0)
+			rowPitch = width * channels;
+		Image image = { width, height, std::vector<unsigned char>((size_t)width * height * 4) };
+		for (int y = 0; y < height; y++) {
+			const unsigned char* in = pixels + (size_t)y * rowPitch;
+			unsigned char* out = &image.rgba[(size_t)y * width * 4];
+			for (int x = 0; x < width; x++, in += channels, out += 4) {
+				bool grey = channels < 3;
+				out[0] = in[0];
+				out[1] = grey ? in[0] : in[1];
+				out[2] = grey ? in[0] : in[2];
+				out[3] = (channels == 2 || channels == 4) ? in[channels - 1] : 255;
+			}
+		}
+		images.push_back(std::move(image));
+		return (int)images.size() - 1;
+	}
+
+	// Queue an image from a cooked pack, decoding its blocks when it is compressed, or from path when the pack
+	// doesn't have it. Returns -1 on failure.
+	int add(const TexturePack& pack, const char* path) {
+		const TexturePackEntry* entry = pack.isOpen() ? pack.find(path) : NULL;
+		if (entry != NULL && entry->format == BC_NONE)
+			return add(pack.mipData(*entry, 0), entry->width, entry->height, entry->channels, entry->mips[0].rowPitch);
+		if (entry != NULL) {
+			std::vector<unsigned char> rgba((size_t)entry->width * entry->height * 4);
+			bcDecompress(pack.mipData(*entry, 0), entry->width, entry->height, (BCFormat)entry->format, rgba.data());
+			return add(rgba.data(), entry->width, entry->height, 4);
+		}
+
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+		if (!data) {
+			std::cout << "Failed to load texture " << path << std::endl;
+			return -1;
+		}
+		int index = add(data, width, height, channels);
+		stbi_image_free(data);
+		return index;
+	}
+
+	// 1x1 white image, shared by every caller standing in for a texture that failed to load
+	int placeholder() {
+		if (placeholderIndex < 0) {
+			const unsigned char white[4] = { 255, 255, 255, 255 };
+			placeholderIndex = add(white, 1, 1, 4);
+		}
+		return placeholderIndex;
+	}
+
+	// Pack, build mips and upload. regions[i] tells where image i landed. Returns the texture array ID.
+	unsigned int build(std::vector<TextureRegion>& regions) {
+		regions.assign(images.size(), TextureRegion{ 0, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) });
+		if (images.empty())
+			return 0;
+
+		bool uniform = true;
+		int largest = 0;
+		for (const Image& image : images) {
+			uniform = uniform && image.width == images[0].width && image.height == images[0].height;
+			largest = std::max(largest, std::max(image.width, image.height));
+		}
+
+		int layerWidth, layerHeight;
+		std::vector<std::vector<unsigned char>> pages;
+		if (uniform) {
+			// One layer per texture, nothing to pad
+			layerWidth = images[0].width;
+			layerHeight = images[0].height;
+			for (size_t i = 0; i < images.size(); i++) {
+				regions[i].layer = (int)i;
+				pages.push_back(std::move(images[i].rgba));
+			}
+		}
+		else {
+			int size = pageSize;
+			if (size == 0) {
+				size = 256;
+				while (size < largest + 2 * padding)
+					size *= 2;
+			}
+			int maxSize;
+			glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+			size = std::min(size, maxSize);
+			layerWidth = layerHeight = size;
+			packAtlas(size, regions, pages);
+		}
+		images.clear();
+		placeholderIndex = -1;
+
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, uniform ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, uniform ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Mips are built per layer on the CPU, then every level is uploaded for all layers at once. Atlas pages stop
+		// at the level where the padding shrinks to a texel, smaller ones would blend neighbouring regions.
+		int levels = 16;
+		if (!uniform) {
+			levels = 1;
+			while ((2 << (levels - 1)) <= padding)
+				levels++;
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		std::vector<std::vector<MipLevel>> chains;
+		for (const std::vector<unsigned char>& page : pages)
+			chains.push_back(generateMipChain(page.data(), layerWidth, layerHeight, 4, levels));
+		std::vector<unsigned char> level;
+		for (size_t l = 0; l < chains[0].size(); l++) {
+			const MipLevel& first = chains[0][l];
+			size_t layerBytes = first.pixels.size();
+			level.resize(layerBytes * chains.size());
+			for (size_t layer = 0; layer < chains.size(); layer++)
+				memcpy(&level[layer * layerBytes], chains[layer][l].pixels.data(), layerBytes);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, GL_RGBA8, first.width, first.height, (GLsizei)chains.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data());
+		}
+		return texture;
+	}
+
+private:
+	struct Image {
+		int width;
+		int height;
+		std::vector<unsigned char> rgba;
+	};
+
+	// Tallest first gives the skyline packer its best results
+	void packAtlas(int size, std::vector<TextureRegion>& regions, std::vector<std::vector<unsigned char>>& pages) {
+		std::vector<int> order(images.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = (int)i;
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return images[a].height > images[b].height; });
+
+		std::vector<SkylinePacker> packers;
+		for (int index : order) {
+			const Image& image = images[index];
+			int w = std::min(image.width + 2 * padding, size);
+			int h = std::min(image.height + 2 * padding, size);
+			int x = 0, y = 0;
+			size_t page = 0;
+			for (; page < packers.size(); page++) {
+				if (packers[page].insert(w, h, x, y))
+					break;
+			}
+			if (page == packers.size()) {
+				packers.push_back(SkylinePacker(size, size));
+				pages.emplace_back((size_t)size * size * 4, 0);
+				packers.back().insert(w, h, x, y);
+			}
+
+			// Copy with the border filled by the edge texels so filtering and mips don't bleed in neighbours
+			int innerW = w - 2 * padding, innerH = h - 2 * padding;
+			std::vector<unsigned char>& dst = pages[page];
+			for (int py = 0; py < h; py++) {
+				int sy = std::min(std::max(py - padding, 0), innerH - 1) * image.height / innerH;
+				for (int px = 0; px < w; px++) {
+					int sx = std::min(std::max(px - padding, 0), innerW - 1) * image.width / innerW;
+					memcpy(&dst[((size_t)(y + py) * size + x + px) * 4], &image.rgba[((size_t)sy * image.width + sx) * 4], 4);
+				}
+			}
+
+			regions[index].layer = (int)page;
+			regions[index].rect = glm::vec4((float)(x + padding) / size, (float)(y + padding) / size, (float)innerW / size, (float)innerH / size);
+		}
+	}
+
+	int pageSize;
+	int padding;
+	std::vector<Image> images;
+	int placeholderIndex = -1;
+};
+
+// Bake a region into mesh UVs (UVs must stay within 0..1, repeating UVs need the shader side remap instead)
+inline void remapUVs(float* vertices, int vertexCount, int vertexLen, int uvOffset, const TextureRegion& region) {
+	for (int i = 0; i < vertexCount; i++) {
+		float* uv = vertices + (size_t)i * vertexLen + uvOffset;
+		uv[0] = region.rect.x + uv[0] * region.rect.z;
+		uv[1] = region.rect.y + uv[1] * region.rect.w;
+	}
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef TEXTURE_PACK_H
+#define TEXTURE_PACK_H
+
+#include "BlockCompress.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Texture pack layout (written by tools/texcook.cpp, read at runtime through a memory mapping):
+//   TexturePackHeader
+//   mip data, every level starts on a TEXPACK_DATA_ALIGNMENT boundary, rows padded to TEXPACK_ROW_ALIGNMENT
+//   TexturePackEntry[textureCount] (the index, at header.indexOffset)
+// Rows are padded so the default GL_UNPACK_ALIGNMENT of 4 can upload a level straight from the mapping.
+// Block compressed levels (entry.format != BC_NONE) are stored as rows of 4x4 blocks without padding.
+
+const uint32_t TEXPACK_MAGIC = 0x4B415054;	// "TPAK"
+const uint32_t TEXPACK_VERSION = 2;
+const uint32_t TEXPACK_DATA_ALIGNMENT = 16;
+const uint32_t TEXPACK_ROW_ALIGNMENT = 4;
+const int TEXPACK_MAX_MIPS = 16;
+const int TEXPACK_NAME_LEN = 64;
+
+struct TexturePackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t textureCount;
+	uint32_t rowAlignment;
+	uint64_t indexOffset;
+};
+
+struct TexturePackMip {
+	uint32_t width;
+	uint32_t height;
+	uint32_t rowPitch;
+	uint32_t reserved;
+	uint64_t offset;	// From the start of the file
+	uint64_t size;
+};
+
+struct TexturePackEntry {
+	char name[TEXPACK_NAME_LEN];	// Source path, e.g. "rsc/imgs/image.png"
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t mipCount;
+	uint32_t format;	// BCFormat
+	uint32_t reserved;
+	TexturePackMip mips[TEXPACK_MAX_MIPS];
+};
+
+// Bytes per row of a level once padded for upload
+inline uint32_t texturePackRowPitch(uint32_t width, uint32_t channels) {
+	uint32_t row = width * channels;
+	return (row + TEXPACK_ROW_ALIGNMENT - 1) & ~(TEXPACK_ROW_ALIGNMENT - 1);
+}
+
+// A texture pack mapped into memory, mip data is handed out as pointers into the mapping
+class TexturePack {
+public:
+	bool open(const char* path) {
+		if (!file.open(path))
+			return false;
+		if (file.size() < sizeof(TexturePackHeader))
+			return fail();
+		const TexturePackHeader* header = reinterpret_cast<const TexturePackHeader*>(file.data());
+		if (header->magic != TEXPACK_MAGIC || header->version != TEXPACK_VERSION)
+			return fail();
+		if (header->indexOffset + (uint64_t)header->textureCount * sizeof(TexturePackEntry) > file.size())
+			return fail();
+		entries = reinterpret_cast<const TexturePackEntry*>(file.data() + header->indexOffset);
+		count = header->textureCount;
+		for (uint32_t i = 0; i < count; i++) {
+			if (!valid(entries[i]))
+				return fail();
+		}
+		return true;
+	}
+
+	bool isOpen() const { return file.isOpen(); }
+	uint32_t size() const { return count; }
+	const TexturePackEntry& entry(uint32_t index) const { return entries[index]; }
+
+	// Look up a texture by its source path, returns NULL when the pack does not contain it
+	const TexturePackEntry* find(const char* name) const {
+		for (uint32_t i = 0; i < count; i++) {
+			if (strncmp(entries[i].name, name, TEXPACK_NAME_LEN) == 0)
+				return &entries[i];
+		}
+		return NULL;
+	}
+
+	const unsigned char* mipData(const TexturePackEntry& entry, uint32_t level) const {
+		return file.data() + entry.mips[level].offset;
+	}
+
+private:
+	// Every level must lie inside the file and hold at least the bytes its size and format need, so a truncated
+	// or corrupt pack fails to open instead of uploading from past the end of the mapping
+	bool valid(const TexturePackEntry& entry) const {
+		if (entry.channels < 1 || entry.channels > 4 || entry.mipCount < 1 || entry.mipCount > (uint32_t)TEXPACK_MAX_MIPS)
+			return false;
+		if (entry.format != BC_NONE && entry.format != BC1 && entry.format != BC3 && entry.format != BC7)
+			return false;
+		for (uint32_t level = 0; level < entry.mipCount; level++) {
+			const TexturePackMip& mip = entry.mips[level];
+			if (mip.width == 0 || mip.height == 0 || mip.width > 65536 || mip.height > 65536 || mip.offset > file.size() || mip.size > file.size() - mip.offset)
+				return false;
+			if (entry.format == BC_NONE && (uint64_t)mip.rowPitch < (uint64_t)mip.width * entry.channels)
+				return false;
+			uint64_t needed = entry.format == BC_NONE ? (uint64_t)mip.rowPitch * mip.height
+				: (uint64_t)bcCompressedSize((BCFormat)entry.format, mip.width, mip.height);
+			if (mip.size < needed)
+				return false;
+		}
+		return true;
+	}
+
+	bool fail() {
+		file.close();
+		entries = NULL;
+		count = 0;
+		return false;
+	}
+
+	MappedFile file;
+	const TexturePackEntry* entries = NULL;
+	uint32_t count = 0;
+};
+
+// Streams textures into a pack file, the index is appended by finish()
+class TexturePackWriter {
+public:
+	~TexturePackWriter() {
+		if (out)
+			fclose(out);
+	}
+
+	bool open(const char* path) {
+		out = fopen(path, "wb");
+		if (!out)
+			return false;
+		TexturePackHeader header = {};
+		fwrite(&header, sizeof(header), 1, out);
+		offset = sizeof(header);
+		return true;
+	}
+
+	// Add a texture, levels[i] holds tightly packed rows of mip i (or its blocks when format is compressed)
+	bool add(const char* name, uint32_t width, uint32_t height, uint32_t channels, BCFormat format, const std::vector<std::vector<unsigned char>>& levels) {
+		if (levels.empty() || levels.size() > (size_t)TEXPACK_MAX_MIPS || strlen(name) >= (size_t)TEXPACK_NAME_LEN)
+			return false;
+
+		TexturePackEntry entry = {};
+		strncpy(entry.name, name, TEXPACK_NAME_LEN - 1);
+		entry.width = width;
+		entry.height = height;
+		entry.channels = channels;
+		entry.mipCount = (uint32_t)levels.size();
+		entry.format = format;
+
+		std::vector<unsigned char> padded;
+		uint32_t w = width, h = height;
+		for (size_t level = 0; level < levels.size(); level++) {
+			pad(TEXPACK_DATA_ALIGNMENT);
+			TexturePackMip& mip = entry.mips[level];
+			mip.width = w;
+			mip.height = h;
+			mip.offset = offset;
+
+			if (format != BC_NONE) {
+				mip.rowPitch = (uint32_t)(((w + 3) / 4) * bcBlockBytes(format));
+				mip.size = bcCompressedSize(format, w, h);
+				if (levels[level].size() != mip.size)
+					return false;
+				write(levels[level].data(), levels[level].size());
+			}
+			else {
+				uint32_t row = w * channels;
+				uint32_t pitch = texturePackRowPitch(w, channels);
+				padded.assign((size_t)pitch * h, 0);
+				for (uint32_t y = 0; y < h; y++)
+					memcpy(&padded[(size_t)y * pitch], &levels[level][(size_t)y * row], row);
+				mip.rowPitch = pitch;
+				mip.size = padded.size();
+				write(padded.data(), padded.size());
+			}
+
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+		index.push_back(entry);
+		return true;
+	}
+
+	// Write the index and patch the header, returns false on any I/O error
+	bool finish() {
+		pad(TEXPACK_DATA_ALIGNMENT);
+		TexturePackHeader header = {};
+		header.magic = TEXPACK_MAGIC;
+		header.version = TEXPACK_VERSION;
+		header.textureCount = (uint32_t)index.size();
+		header.rowAlignment = TEXPACK_ROW_ALIGNMENT;
+		header.indexOffset = offset;
+		if (!index.empty())
+			write(index.data(), index.size() * sizeof(TexturePackEntry));
+		fseek(out, 0, SEEK_SET);
+		fwrite(&header, sizeof(header), 1, out);
+		bool ok = !ferror(out);
+		ok = fclose(out) == 0 && ok;
+		out = NULL;
+		return ok;
+	}
+
+	uint64_t bytesWritten() const { return offset; }
+
+private:
+	void write(const void* data, size_t size) {
+		fwrite(data, 1, size, out);
+		offset += size;
+	}
+
+	void pad(uint32_t alignment) {
+		static const unsigned char zeros[TEXPACK_DATA_ALIGNMENT] = {};
+		size_t padding = (size_t)((alignment - offset % alignment) % alignment);
+		if (padding)
+			write(zeros, padding);
+	}
+
+	FILE* out = NULL;
+	uint64_t offset = 0;
+	std::vector<TexturePackEntry> index;
+};
+
+#endif
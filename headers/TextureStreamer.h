@@ -0,0 +1,309 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+#include "MipGenerator.h"
+#include "TexturePack.h"
+#include "TextureUploader.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Residency counters, misses are requests for detail that wasn't on the GPU yet
+struct TextureStreamStats {
+	size_t residentBytes = 0;
+	size_t budgetBytes = 0;
+	uint64_t requests = 0;
+	uint64_t misses = 0;
+	uint64_t streamedLevels = 0;
+	uint64_t evictedLevels = 0;
+
+	float utilization() const { return budgetBytes ? (float)residentBytes / budgetBytes : 0.0f; }
+
+	void print() const {
+		printf("Texture streaming: %.2f / %.2f MB (%.0f%%), %llu requests, %llu misses, %llu levels streamed, %llu evicted\n",
+			residentBytes / 1048576.0, budgetBytes / 1048576.0, utilization() * 100.0f, (unsigned long long)requests,
+			(unsigned long long)misses, (unsigned long long)streamedLevels, (unsigned long long)evictedLevels);
+	}
+};
+
+// Keeps only the mips that are actually visible on the GPU, within a byte budget. Every texture starts with just
+// the levels up to residentSize pixels. Each frame callers request the screen size objects using a texture cover,
+// finer levels are streamed in through a TextureUploader, and when the budget runs out the least recently used
+// textures drop their finest levels: GL_TEXTURE_BASE_LEVEL is raised past them and they are respecified empty,
+// which frees their storage. The full chains stay on the CPU (decoded) or in the pack mapping as the backing store.
+class TextureStreamer {
+public:
+	~TextureStreamer() { release(); }
+
+	void init(const GLExtensions& ext, size_t budgetBytes, size_t uploadBytesPerFrame = 4 << 20, int residentSize = 64) {
+		release();
+		s3tc = ext.textureCompressionS3TC;
+		bptc = ext.textureCompressionBPTC;
+		stats.budgetBytes = budgetBytes;
+		uploadBudget = uploadBytesPerFrame;
+		this->residentSize = residentSize;
+		uploader.init();
+	}
+
+	void release() {
+		uploader.release();
+		for (Texture& texture : textures)
+			glDeleteTextures(1, &texture.id);
+		textures.clear();
+		indexOf.clear();
+		stats = TextureStreamStats{ 0, stats.budgetBytes };
+	}
+
+	// Stream a texture decoded from path, keeping its mip chain in memory. Returns its index or -1.
+	int add(const char* path, const MipOptions& options = MipOptions()) {
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+		if (!data) {
+			std::cout << "Failed to load texture " << path << std::endl;
+			return -1;
+		}
+		Texture texture;
+		texture.channels = channels;
+		texture.chain = generateMipChain(data, width, height, channels, 16, options);
+		stbi_image_free(data);
+		for (const MipLevel& mip : texture.chain)
+			texture.levels.push_back(Level{ mip.pixels.data(), (size_t)mip.width * channels, mip.pixels.size(), mip.width, mip.height });
+		return create(texture);
+	}
+
+	// Stream a cooked texture straight from the pack mapping, decoding from path when it isn't there or the
+	// driver can't sample its compression format
+	int add(const TexturePack& pack, const char* path) {
+		const TexturePackEntry* entry = pack.isOpen() ? pack.find(path) : NULL;
+		if (entry == NULL || !supported((BCFormat)entry->format))
+			return add(path);
+		Texture texture;
+		texture.channels = entry->channels;
+		texture.compression = (BCFormat)entry->format;
+		for (uint32_t level = 0; level < entry->mipCount; level++) {
+			const TexturePackMip& mip = entry->mips[level];
+			texture.levels.push_back(Level{ pack.mipData(*entry, level), mip.rowPitch, (size_t)mip.size, (int)mip.width, (int)mip.height });
+		}
+		return create(texture);
+	}
+
+	unsigned int texture(int index) const { return textures[index].id; }
+
+	// Finest level currently sampled
+	int residentLevel(int index) const { return textures[index].residentBase; }
+
+	// An object using the texture covers screenPixels across this frame (its projected size), call for every use
+	void request(int index, float screenPixels) {
+		Texture& texture = textures[index];
+		const Level& top = texture.levels[0];
+		float texels = (float)std::max(top.width, top.height);
+		int level = screenPixels >= texels ? 0 : (int)std::log2(texels / std::max(screenPixels, 1.0f));
+		level = std::min(level, texture.floorLevel);
+		texture.wanted = std::min(texture.wanted, level);
+		texture.lastUsed = frame;
+		stats.requests++;
+		if (level < texture.residentBase)
+			stats.misses++;
+	}
+
+	// Call once per frame after the requests: advances uploads, then evicts and streams to meet this frame's requests
+	void update() {
+		finished.clear();
+		uploader.update(uploadBudget, &finished);
+		for (const UploadedLevel& done : finished) {
+			auto it = indexOf.find(done.texture);
+			if (it != indexOf.end())
+				textures[it->second].residentBase = done.level;
+		}
+
+		for (size_t i = 0; i < textures.size(); i++) {
+			Texture& texture = textures[i];
+			if (texture.lastUsed != frame || texture.wanted >= texture.allocatedBase || texture.residentBase != texture.allocatedBase)
+				continue;	// Not used, already detailed enough, or still streaming the last request
+
+			// Take whatever detail fits, coarsest extra level first
+			int target = texture.allocatedBase;
+			size_t bytes = 0;
+			while (target > texture.wanted) {
+				size_t level = levelBytes(texture, target - 1);
+				if (stats.residentBytes + bytes + level > stats.budgetBytes && !evict(bytes + level, i))
+					break;
+				bytes += level;
+				target--;
+			}
+			stream(texture, target);
+		}
+
+		for (Texture& texture : textures)
+			texture.wanted = texture.floorLevel;
+		frame++;
+	}
+
+	void setBudget(size_t bytes) { stats.budgetBytes = bytes; }
+	const TextureStreamStats& statistics() const { return stats; }
+
+private:
+	struct Level {
+		const unsigned char* data;
+		size_t rowPitch;
+		size_t size;
+		int width;
+		int height;
+	};
+
+	struct Texture {
+		unsigned int id = 0;
+		int channels = 4;
+		BCFormat compression = BC_NONE;
+		int floorLevel = 0;			// Coarsest detail kept, never evicted
+		int residentBase = 0;		// Finest level with its pixels on the GPU
+		int allocatedBase = 0;		// Finest level with storage, below residentBase while streaming
+		int wanted = 0;				// Finest level requested this frame
+		uint64_t lastUsed = 0;
+		std::vector<Level> levels;
+		std::vector<MipLevel> chain;	// Backing store when decoded from a file
+	};
+
+	bool supported(BCFormat format) const {
+		if (format == BC1 || format == BC3)
+			return s3tc;
+		if (format == BC7)
+			return bptc;
+		return format == BC_NONE;
+	}
+
+	// Storage a level takes on the GPU, 3 channel formats are padded to 4 by drivers
+	static size_t levelBytes(const Texture& texture, int level) {
+		const Level& mip = texture.levels[level];
+		if (texture.compression != BC_NONE)
+			return mip.size;
+		return (size_t)mip.width * mip.height * (texture.channels == 3 ? 4 : texture.channels);
+	}
+
+	int create(Texture& texture) {
+		glGenTextures(1, &texture.id);
+		glBindTexture(GL_TEXTURE_2D, texture.id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)texture.levels.size() - 1);
+		if (texture.compression == BC_NONE)
+			setTextureSwizzle(textureFormatForChannels(texture.channels));
+
+		// Upload the small levels right away so the texture is usable from the first frame
+		int floor = (int)texture.levels.size() - 1;
+		while (floor > 0 && std::max(texture.levels[floor - 1].width, texture.levels[floor - 1].height) <= residentSize)
+			floor--;
+		for (int level = (int)texture.levels.size() - 1; level >= floor; level--) {
+			specify(texture, level, texture.levels[level].data);
+			stats.residentBytes += levelBytes(texture, level);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, floor);
+		texture.floorLevel = texture.residentBase = texture.allocatedBase = texture.wanted = floor;
+		texture.lastUsed = frame;
+
+		indexOf[texture.id] = textures.size();
+		textures.push_back(std::move(texture));
+		return (int)textures.size() - 1;
+	}
+
+	// (Re)specify a level with the texture bound: storage plus pixels when given, or empty storage
+	void specify(const Texture& texture, int level, const unsigned char* pixels) {
+		const Level& mip = texture.levels[level];
+		if (texture.compression != BC_NONE) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, bcGLFormat(texture.compression), mip.width, mip.height, 0, (GLsizei)mip.size, pixels);
+			return;
+		}
+		TextureFormat format = textureFormatForChannels(texture.channels);
+		// Decoded rows are tight, pack rows are padded to the default alignment
+		size_t tight = (size_t)mip.width * texture.channels;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, mip.rowPitch == tight ? unpackAlignmentFor(tight) : TEXPACK_ROW_ALIGNMENT);
+		glTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, mip.width, mip.height, 0, format.format, GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	// Allocate the levels from allocatedBase - 1 down to target and queue their pixels, coarsest first so
+	// the uploader can lower the base level as each one lands
+	void stream(Texture& texture, int target) {
+		glBindTexture(GL_TEXTURE_2D, texture.id);
+		for (int level = texture.allocatedBase - 1; level >= target; level--) {
+			const Level& mip = texture.levels[level];
+			stats.residentBytes += levelBytes(texture, level);
+			stats.streamedLevels++;
+			if (texture.compression != BC_NONE) {
+				// Blocks go straight from the mapping, there are no rows to slice
+				specify(texture, level, mip.data);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+				texture.residentBase = level;
+				continue;
+			}
+			specify(texture, level, NULL);
+			size_t tight = (size_t)mip.width * texture.channels;
+			std::vector<unsigned char> pixels(tight * mip.height);
+			for (int y = 0; y < mip.height; y++)
+				memcpy(&pixels[y * tight], mip.data + y * mip.rowPitch, tight);
+			uploader.upload(texture.id, level, mip.width, mip.height, texture.channels, std::move(pixels));
+		}
+		texture.allocatedBase = std::min(texture.allocatedBase, target);
+	}
+
+	// Free at least bytes within the budget by dropping the finest levels of the least recently used textures.
+	// Textures still streaming, at their floor, or needing their levels this frame are left alone.
+	bool evict(size_t bytes, size_t requester) {
+		candidates.clear();
+		for (size_t i = 0; i < textures.size(); i++) {
+			const Texture& texture = textures[i];
+			bool spare = texture.lastUsed != frame || texture.residentBase < texture.wanted;
+			if (i != requester && spare && texture.residentBase < texture.floorLevel && texture.residentBase == texture.allocatedBase)
+				candidates.push_back(i);
+		}
+		std::sort(candidates.begin(), candidates.end(), [this](size_t a, size_t b) { return textures[a].lastUsed < textures[b].lastUsed; });
+
+		for (size_t index : candidates) {
+			Texture& texture = textures[index];
+			int keep = texture.lastUsed == frame ? texture.wanted : texture.floorLevel;
+			glBindTexture(GL_TEXTURE_2D, texture.id);
+			while (stats.residentBytes + bytes > stats.budgetBytes && texture.residentBase < keep) {
+				int level = texture.residentBase++;
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentBase);
+				// Levels below the base don't count towards completeness, so an empty image frees the memory
+				if (texture.compression != BC_NONE)
+					glCompressedTexImage2D(GL_TEXTURE_2D, level, bcGLFormat(texture.compression), 0, 0, 0, 0, NULL);
+				else {
+					TextureFormat format = textureFormatForChannels(texture.channels);
+					glTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, 0, 0, 0, format.format, GL_UNSIGNED_BYTE, NULL);
+				}
+				stats.residentBytes -= levelBytes(texture, level);
+				stats.evictedLevels++;
+			}
+			texture.allocatedBase = texture.residentBase;
+			if (stats.residentBytes + bytes <= stats.budgetBytes)
+				return true;
+		}
+		return false;
+	}
+
+	TextureUploader uploader;
+	std::vector<Texture> textures;
+	std::unordered_map<unsigned int, size_t> indexOf;
+	std::vector<UploadedLevel> finished;
+	std::vector<size_t> candidates;
+	TextureStreamStats stats;
+	size_t uploadBudget = 4 << 20;
+	int residentSize = 64;
+	bool s3tc = false;
+	bool bptc = false;
+	uint64_t frame = 1;
+};
+
+#endif
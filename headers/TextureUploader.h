@@ -0,0 +1,204 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+struct TextureFormat {
+	GLenum internalFormat;
+	GLenum format;
+	GLint swizzle[4];	// Stored channel each of r, g, b, a samples as
+};
+
+// Internal / pixel format pair for a stbi channel count (1 grey, 2 grey + alpha, 3 RGB, 4 RGBA). Grey is stored
+// in red (and alpha in green), the swizzle spreads it back out so shaders read (grey, grey, grey, alpha).
+inline TextureFormat textureFormatForChannels(int channels) {
+	switch (channels) {
+	case 1: return { GL_R8, GL_RED, { GL_RED, GL_RED, GL_RED, GL_ONE } };
+	case 2: return { GL_RG8, GL_RG, { GL_RED, GL_RED, GL_RED, GL_GREEN } };
+	case 4: return { GL_RGBA8, GL_RGBA, { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA } };
+	default: return { GL_RGB8, GL_RGB, { GL_RED, GL_GREEN, GL_BLUE, GL_ONE } };
+	}
+}
+
+// Set the format's swizzle on the bound GL_TEXTURE_2D, wherever storage of that format is allocated
+inline void setTextureSwizzle(const TextureFormat& format) {
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, format.swizzle);
+}
+
+// Largest GL_UNPACK_ALIGNMENT that tightly packed rows of this size satisfy
+inline int unpackAlignmentFor(size_t rowBytes) {
+	if (rowBytes % 8 == 0) return 8;
+	if (rowBytes % 4 == 0) return 4;
+	if (rowBytes % 2 == 0) return 2;
+	return 1;
+}
+
+// A level whose rows have all been issued
+struct UploadedLevel {
+	unsigned int texture;
+	int level;
+};
+
+// Streams texture levels to the GPU through a ring of pixel unpack buffers. Rows are copied into a free
+// buffer and glTexSubImage2D sources from it, so the call returns without the driver copying or stalling.
+// Each update() moves at most a byte budget, so large textures arrive in row slices over several frames.
+class TextureUploader {
+public:
+	~TextureUploader() { release(); }
+
+	void init(int slotCount = 4, size_t slotBytes = 4 << 20) {
+		release();
+		this->slotBytes = slotBytes;
+		slots.resize(slotCount);
+		for (Slot& slot : slots) {
+			glGenBuffers(1, &slot.buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, slotBytes, NULL, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	void release() {
+		for (Slot& slot : slots) {
+			if (slot.fence)
+				glDeleteSync(slot.fence);
+			glDeleteBuffers(1, &slot.buffer);
+		}
+		slots.clear();
+		jobs.clear();
+	}
+
+	// Queue a level, storage must already exist (see allocate). Pixels are tightly packed rows.
+	void upload(unsigned int texture, int level, int width, int height, int channels, std::vector<unsigned char> pixels) {
+		if ((size_t)width * channels > slotBytes) {
+			std::cout << "ERROR::TEXTURE_UPLOADER::ROW_LARGER_THAN_STAGING_BUFFER" << std::endl;
+			return;
+		}
+		Job job;
+		job.texture = texture;
+		job.level = level;
+		job.width = width;
+		job.height = height;
+		job.format = textureFormatForChannels(channels).format;
+		job.rowBytes = (size_t)width * channels;
+		job.nextRow = 0;
+		job.pixels = std::move(pixels);
+		jobs.push_back(std::move(job));
+	}
+
+	// Reserve storage for every level without any pixel transfer
+	static void allocate(unsigned int texture, int width, int height, int channels, int levels) {
+		TextureFormat format = textureFormatForChannels(channels);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);	// Lowered as levels arrive
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		setTextureSwizzle(format);
+		for (int level = 0; level < levels; level++) {
+			glTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, width, height, 0, format.format, GL_UNSIGNED_BYTE, NULL);
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+	}
+
+	// Move up to byteBudget bytes of queued rows, call once per frame. Returns the bytes issued.
+	// Levels completed by this call are appended to finished when given.
+	size_t update(size_t byteBudget, std::vector<UploadedLevel>* finished = NULL) {
+		size_t issued = 0;
+		while (!jobs.empty() && issued < byteBudget) {
+			Slot* slot = freeSlot();
+			if (slot == NULL)
+				break;	// Every buffer is still being read by the GPU, try again next frame
+
+			Job& job = jobs.front();
+			size_t budget = std::min(slotBytes, byteBudget - issued);
+			int rows = (int)std::min<size_t>(budget / job.rowBytes, (size_t)(job.height - job.nextRow));
+			if (rows == 0) {
+				if (issued > 0)
+					break;
+				rows = 1;	// Always make progress, even when one row exceeds the budget
+			}
+			size_t bytes = (size_t)rows * job.rowBytes;
+
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+			// The slot's fence has signaled, so the write can't race the GPU's previous read
+			void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (dst == NULL) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				break;
+			}
+			memcpy(dst, &job.pixels[(size_t)job.nextRow * job.rowBytes], bytes);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignmentFor(job.rowBytes));
+			glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, job.nextRow, job.width, rows, job.format, GL_UNSIGNED_BYTE, (void*)0);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+			job.nextRow += rows;
+			issued += bytes;
+			totalBytes += bytes;
+			if (job.nextRow == job.height) {
+				// Levels are queued smallest first, so each finished level can become the sampled base
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+				if (finished)
+					finished->push_back(UploadedLevel{ job.texture, job.level });
+				jobs.pop_front();
+			}
+		}
+		return issued;
+	}
+
+	bool idle() const { return jobs.empty(); }
+	size_t pendingJobs() const { return jobs.size(); }
+	size_t uploadedBytes() const { return totalBytes; }
+
+private:
+	struct Slot {
+		unsigned int buffer = 0;
+		GLsync fence = NULL;
+	};
+
+	struct Job {
+		unsigned int texture;
+		int level;
+		int width;
+		int height;
+		GLenum format;
+		size_t rowBytes;
+		int nextRow;
+		std::vector<unsigned char> pixels;
+	};
+
+	// Next ring slot whose previous transfer has finished, without blocking
+	Slot* freeSlot() {
+		for (size_t i = 0; i < slots.size(); i++) {
+			Slot& slot = slots[(nextSlot + i) % slots.size()];
+			if (slot.fence) {
+				GLenum status = glClientWaitSync(slot.fence, 0, 0);
+				if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+					continue;
+				glDeleteSync(slot.fence);
+				slot.fence = NULL;
+			}
+			nextSlot = (nextSlot + i + 1) % slots.size();
+			return &slot;
+		}
+		return NULL;
+	}
+
+	std::vector<Slot> slots;
+	std::deque<Job> jobs;
+	size_t slotBytes = 0;
+	size_t nextSlot = 0;
+	size_t totalBytes = 0;
+};
+
+#endif
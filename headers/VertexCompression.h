@@ -0,0 +1,308 @@
+#ifndef VERTEX_COMPRESSION_H
+#define VERTEX_COMPRESSION_H
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Packed vertex formats. A Mesh vertex is 32 bytes of floats, the compact form is 16:
+//   position  3 x unorm16 against the mesh bounds (8 bytes with padding), or 4 x half float relative to the bounds center
+//   normal    octahedral, 2 x snorm16 (4 bytes), decoded in lighting.vs
+//   uv        2 x half float (4 bytes)
+// Position dequantization is a scale and offset, it folds into the model matrix (dequantizeMatrix in main.cpp) so the
+// vertex shader pays nothing for it. Normals are unpacked in the shader when the layout has VERTEX_OCT_NORMALS.
+
+enum VertexPositionFormat {
+	VERTEX_POSITION_FLOAT,
+	VERTEX_POSITION_HALF,
+	VERTEX_POSITION_UNORM16
+};
+
+struct VertexFormat {
+	VertexPositionFormat position = VERTEX_POSITION_UNORM16;
+	bool octNormals = true;
+	bool halfUVs = true;
+};
+
+// IEEE half from float, round to nearest even, overflow goes to infinity
+inline uint16_t floatToHalf(float value) {
+	uint32_t f;
+	memcpy(&f, &value, 4);
+	uint32_t sign = (f >> 16) & 0x8000;
+	int32_t exponent = (int32_t)((f >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = f & 0x7FFFFF;
+
+	if (((f >> 23) & 0xFF) == 0xFF)
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));	// Inf / NaN
+	if (exponent >= 31)
+		return (uint16_t)(sign | 0x7C00);
+	if (exponent <= 0) {
+		if (exponent < -10)
+			return (uint16_t)sign;
+		// Denormal, shift in the implicit bit and round
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t midpoint = 1u << (shift - 1);
+		if (rest > midpoint || (rest == midpoint && (half & 1)))
+			half++;
+		return (uint16_t)(sign | half);
+	}
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;	// May carry into the exponent, which is still the right answer
+	return (uint16_t)(sign | half);
+}
+
+inline float halfToFloat(uint16_t h) {
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1F;
+	uint32_t mantissa = h & 0x3FF;
+	uint32_t f;
+	if (exponent == 0) {
+		if (mantissa == 0)
+			f = sign;
+		else {
+			// Normalize the denormal
+			exponent = 127 - 15 + 1;
+			while (!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			f = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+	}
+	else if (exponent == 31)
+		f = sign | 0x7F800000 | (mantissa << 13);
+	else
+		f = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	float value;
+	memcpy(&value, &f, 4);
+	return value;
+}
+
+inline int16_t floatToSnorm16(float v) {
+	v = std::min(std::max(v, -1.0f), 1.0f);
+	return (int16_t)std::lround(v * 32767.0f);
+}
+
+inline float snorm16ToFloat(int16_t v) {
+	return std::max(v / 32767.0f, -1.0f);
+}
+
+// Unit vector to the octahedron unfolded onto [-1, 1]^2
+inline void octEncode(const float* n, float& u, float& v) {
+	float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+	if (l1 == 0.0f) {
+		u = v = 0.0f;
+		return;
+	}
+	u = n[0] / l1;
+	v = n[1] / l1;
+	if (n[2] < 0.0f) {
+		float x = u, y = v;
+		u = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		v = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+	}
+}
+
+// Same math as octDecode in lighting.vs
+inline void octDecode(float u, float v, float* n) {
+	n[0] = u;
+	n[1] = v;
+	n[2] = 1.0f - std::fabs(u) - std::fabs(v);
+	float t = std::max(-n[2], 0.0f);
+	n[0] += n[0] >= 0.0f ? -t : t;
+	n[1] += n[1] >= 0.0f ? -t : t;
+	float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	for (int c = 0; c < 3; c++)
+		n[c] /= length;
+}
+
+// Snorm16 octahedral encoding. Rounding each axis independently can cost a few ulps, so the four
+// neighbouring codes are tried and the one that decodes closest to n wins.
+inline void octEncodeSnorm16(const float* n, int16_t* out) {
+	float u, v;
+	octEncode(n, u, v);
+	float bestDot = -2.0f;
+	int16_t base[2] = { floatToSnorm16(u), floatToSnorm16(v) };
+	out[0] = base[0];
+	out[1] = base[1];
+	for (int i = 0; i < 4; i++) {
+		int16_t cu = (int16_t)std::min(std::max((int)base[0] + (i & 1 ? (u * 32767.0f > base[0] ? 1 : -1) : 0), -32767), 32767);
+		int16_t cv = (int16_t)std::min(std::max((int)base[1] + (i & 2 ? (v * 32767.0f > base[1] ? 1 : -1) : 0), -32767), 32767);
+		float d[3];
+		octDecode(snorm16ToFloat(cu), snorm16ToFloat(cv), d);
+		float dot = d[0] * n[0] + d[1] * n[1] + d[2] * n[2];
+		if (dot > bestDot) {
+			bestDot = dot;
+			out[0] = cu;
+			out[1] = cv;
+		}
+	}
+}
+
+// Pack mesh vertices into out using the given format, returns the layout to hand to addVertexAttrib
+inline VertexLayout encodeVertices(const Mesh& mesh, const VertexFormat& format, std::vector<unsigned char>& out) {
+	VertexLayout layout = {};
+	uint32_t offset = 0;
+	uint32_t positionType = format.position == VERTEX_POSITION_FLOAT ? MESH_FLOAT : (format.position == VERTEX_POSITION_HALF ? MESH_HALF_FLOAT : MESH_UNSIGNED_SHORT);
+	layout.attribs[0] = { 0, 3, positionType, format.position == VERTEX_POSITION_UNORM16, offset };
+	offset += format.position == VERTEX_POSITION_FLOAT ? 12 : 8;	// 16 bit positions keep 4 byte alignment
+	layout.attribs[1] = format.octNormals ? VertexAttrib{ 1, 2, MESH_SHORT, 1, offset } : VertexAttrib{ 1, 3, MESH_FLOAT, 0, offset };
+	offset += format.octNormals ? 4 : 12;
+	layout.attribs[2] = { 2, 2, format.halfUVs ? (uint32_t)MESH_HALF_FLOAT : (uint32_t)MESH_FLOAT, 0, offset };
+	offset += format.halfUVs ? 4 : 8;
+	layout.attribCount = 3;
+	layout.stride = offset;
+	layout.flags = format.octNormals ? VERTEX_OCT_NORMALS : 0;
+
+	for (int c = 0; c < 3; c++) {
+		float extent = mesh.boundsMax[c] - mesh.boundsMin[c];
+		layout.positionScale[c] = 1.0f;
+		layout.positionOffset[c] = 0.0f;
+		if (format.position == VERTEX_POSITION_UNORM16) {
+			layout.positionScale[c] = extent > 0.0f ? extent : 1.0f;
+			layout.positionOffset[c] = mesh.boundsMin[c];
+		}
+		else if (format.position == VERTEX_POSITION_HALF)
+			layout.positionOffset[c] = (mesh.boundsMin[c] + mesh.boundsMax[c]) * 0.5f;	// Halves are most precise near 0
+	}
+
+	size_t count = mesh.vertexCount();
+	out.assign(count * layout.stride, 0);
+	for (size_t i = 0; i < count; i++) {
+		const float* in = &mesh.vertices[i * MESH_VERTEX_LEN];
+		unsigned char* vertex = &out[i * layout.stride];
+
+		if (format.position == VERTEX_POSITION_FLOAT)
+			memcpy(vertex, in, 12);
+		else {
+			uint16_t p[4] = { 0, 0, 0, 0 };
+			for (int c = 0; c < 3; c++) {
+				float local = (in[c] - layout.positionOffset[c]) / layout.positionScale[c];
+				if (format.position == VERTEX_POSITION_HALF)
+					p[c] = floatToHalf(local);
+				else
+					p[c] = (uint16_t)std::lround(std::min(std::max(local, 0.0f), 1.0f) * 65535.0f);
+			}
+			memcpy(vertex, p, 8);
+		}
+
+		vertex += layout.attribs[1].offset;
+		if (format.octNormals) {
+			int16_t n[2];
+			octEncodeSnorm16(in + 3, n);
+			memcpy(vertex, n, 4);
+			vertex += 4;
+		}
+		else {
+			memcpy(vertex, in + 3, 12);
+			vertex += 12;
+		}
+
+		if (format.halfUVs) {
+			uint16_t uv[2] = { floatToHalf(in[6]), floatToHalf(in[7]) };
+			memcpy(vertex, uv, 4);
+		}
+		else
+			memcpy(vertex, in + 6, 8);
+	}
+	return layout;
+}
+
+// Read one packed vertex back the way the GPU sees it (position already dequantized)
+inline void decodeVertex(const VertexLayout& layout, const unsigned char* vertex, float* position, float* normal, float* uv) {
+	const VertexAttrib& p = layout.attribs[0];
+	for (int c = 0; c < 3; c++) {
+		float value;
+		if (p.type == MESH_FLOAT)
+			memcpy(&value, vertex + p.offset + c * 4, 4);
+		else {
+			uint16_t h;
+			memcpy(&h, vertex + p.offset + c * 2, 2);
+			value = p.type == MESH_HALF_FLOAT ? halfToFloat(h) : h / 65535.0f;
+		}
+		position[c] = value * layout.positionScale[c] + layout.positionOffset[c];
+	}
+
+	const VertexAttrib& n = layout.attribs[1];
+	if (layout.flags & VERTEX_OCT_NORMALS) {
+		int16_t e[2];
+		memcpy(e, vertex + n.offset, 4);
+		octDecode(snorm16ToFloat(e[0]), snorm16ToFloat(e[1]), normal);
+	}
+	else
+		memcpy(normal, vertex + n.offset, 12);
+
+	const VertexAttrib& t = layout.attribs[2];
+	for (int c = 0; c < 2; c++) {
+		if (t.type == MESH_HALF_FLOAT) {
+			uint16_t h;
+			memcpy(&h, vertex + t.offset + c * 2, 2);
+			uv[c] = halfToFloat(h);
+		}
+		else
+			memcpy(&uv[c], vertex + t.offset + c * 4, 4);
+	}
+}
+
+// How far a packed mesh drifts from the float original
+struct VertexErrorReport {
+	size_t vertices = 0;
+	size_t originalBytes = 0;
+	size_t packedBytes = 0;
+	float maxPosition = 0.0f;		// Mesh units
+	float rmsPosition = 0.0f;
+	float extent = 0.0f;			// Longest bounds side, to put the position error in proportion
+	float maxNormalDegrees = 0.0f;
+	float maxUV = 0.0f;
+
+	void print(const char* name) const {
+		printf("%s: %zu vertices, %zu -> %zu bytes (%.0f%%), position error max %.3g rms %.3g (%.4f%% of extent), normal error max %.4f deg, uv error max %.3g\n",
+			name, vertices, originalBytes, packedBytes, originalBytes ? 100.0 * packedBytes / originalBytes : 0.0, maxPosition, rmsPosition,
+			extent > 0.0f ? 100.0f * maxPosition / extent : 0.0f, maxNormalDegrees, maxUV);
+	}
+};
+
+inline VertexErrorReport measureVertexError(const Mesh& mesh, const VertexLayout& layout, const std::vector<unsigned char>& packed) {
+	VertexErrorReport report;
+	report.vertices = mesh.vertexCount();
+	report.originalBytes = mesh.vertices.size() * sizeof(float);
+	report.packedBytes = packed.size();
+	for (int c = 0; c < 3; c++)
+		report.extent = std::max(report.extent, mesh.boundsMax[c] - mesh.boundsMin[c]);
+
+	double sumSquared = 0.0;
+	float maxAngle = 0.0f;
+	for (size_t i = 0; i < report.vertices; i++) {
+		const float* in = &mesh.vertices[i * MESH_VERTEX_LEN];
+		float p[3], n[3], uv[2];
+		decodeVertex(layout, &packed[i * layout.stride], p, n, uv);
+
+		float d2 = 0.0f;
+		for (int c = 0; c < 3; c++)
+			d2 += (p[c] - in[c]) * (p[c] - in[c]);
+		sumSquared += d2;
+		report.maxPosition = std::max(report.maxPosition, std::sqrt(d2));
+
+		// atan2 of |cross| and dot stays accurate for tiny angles where acos(dot) is all rounding
+		float cx = n[1] * in[5] - n[2] * in[4], cy = n[2] * in[3] - n[0] * in[5], cz = n[0] * in[4] - n[1] * in[3];
+		float dot = n[0] * in[3] + n[1] * in[4] + n[2] * in[5];
+		if (in[3] != 0.0f || in[4] != 0.0f || in[5] != 0.0f)
+			maxAngle = std::max(maxAngle, std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot));
+		report.maxUV = std::max(report.maxUV, std::max(std::fabs(uv[0] - in[6]), std::fabs(uv[1] - in[7])));
+	}
+	report.rmsPosition = report.vertices ? (float)std::sqrt(sumSquared / report.vertices) : 0.0f;
+	report.maxNormalDegrees = maxAngle * 57.2957795f;
+	return report;
+}
+
+#endif
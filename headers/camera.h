@@ -125,6 +125,14 @@ public:
 		updateCameraVectors();
 	}
 
+	// Sets the Euler angles directly, e.g. from a recorded camera path
+	void SetOrientation(float yaw, float pitch)
+	{
+		Yaw = yaw;
+		Pitch = pitch;
+		updateCameraVectors();
+	}
+
 	// Processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
 	void ProcessMouseScroll(float yoffset)
 	{
@@ -0,0 +1,3 @@
+// stb_image implementation, compiled once here so the headers can include stb_image.h freely
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
@@ -2,28 +2,76 @@
 #include <GLFW/glfw3.h>
 #include "headers/Shader.h"
 #include "headers/camera.h"
+#include "headers/AllocationTracker.h"
+#include "headers/AutoExposure.h"
+#include "headers/BlockCompress.h"
+#include "headers/DynamicResolution.h"
+#include "headers/FramePacer.h"
+#include "headers/Benchmark.h"
+#include "headers/InputRecorder.h"
+#include "headers/RenderStats.h"
+#include "headers/DebugOutput.h"
+#include "headers/FrameArena.h"
+#include "headers/GLExtensions.h"
+#include "headers/GltfLoader.h"
+#include "headers/LightManager.h"
+#include "headers/MaterialRegistry.h"
+#include "headers/MeshPack.h"
+#include "headers/MeshletRenderer.h"
+#include "headers/MipGenerator.h"
+#include "headers/ResourceManager.h"
+#include "headers/ObjLoader.h"
+#include "headers/OutlineRenderer.h"
+#include "headers/ParticleCompute.h"
+#include "headers/ParticleRenderer.h"
+#include "headers/ParticleSystem.h"
+#include "headers/PostProcess.h"
+#include "headers/TextureArray.h"
+#include "headers/TexturePack.h"
+#include "headers/TextureStreamer.h"
+#include "headers/TextureUploader.h"
+#include "headers/VertexCompression.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "headers/stb_image.h"
 
+#define ALLOCATION_TRACKER_IMPLEMENTATION	// Counting operator new when TRACK_ALLOCATIONS is defined
+#include "headers/AllocationTracker.h"
+
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 // Window
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
+void mouse_callback(GLFWwindow* window, double xPos, double yPos);
+void scroll_callback(GLFWwindow* window, double xOffset, double yOffset);
 GLFWwindow* initWindow(int& width, int& height);
 
 // OpenGL
 unsigned int createVAO();
-void createVBO(float* vertices, int byteSize, int vertexLen);
+BufferHandle createVBO(const float* vertices, int byteSize, int vertexLen, const char* label);
 void addVertexAttrib(int location, int attribLen, int vertexLen, int offset);
-void createEBO(unsigned int* indices, int byteSize);
-unsigned int createTexture(const char* path);
-void calcFPS(int& nbFrames, double& lastTime);
+void addVertexAttrib(const VertexAttrib& attrib, int stride);
+BufferHandle createEBO(const unsigned int* indices, int byteSize, const char* label);
+unsigned int createMeshVAO(const Mesh& mesh, VertexLayout& layout);
+unsigned int createMeshVAO(const MeshPack& pack, const MeshPackEntry& entry);
+glm::mat4 fitModelMatrix(const float* boundsMin, const float* boundsMax, glm::vec3 position, float size);
+glm::mat4 dequantizeMatrix(const VertexLayout& layout);
+glm::mat4 galleryModel(int slot, int slots);
+TextureHandle createTexture(const char* path);
+TextureHandle createTexture(const TexturePack& pack, const char* path);
+TextureHandle createTextureAsync(TextureUploader& uploader, const char* path);
+unsigned int uploadTexture(const char* path);
+unsigned int uploadTexture(const TexturePack& pack, const char* path);
+unsigned int uploadTextureAsync(TextureUploader& uploader, const char* path);
+bool isCompressionSupported(BCFormat format);
+void applyBenchmarkScene(const JsonValue& scene);
 
 // Global Variables
 int width = 1080;
@@ -41,30 +89,236 @@ glm::vec3 lightOffset(1.0f, 1.0f, 4.0f);
 glm::vec3 lightPos(0.0f, 0.0f, 4.0f);					// Light source position
 glm::vec3 lightColor(1.0f);
 
-int main()
+GLExtensions glExt;
+
+// Static geometry, loaded textures and the demo's programs go through here: shared when identical, deleted once the
+// GPU is done with them. Buffers rewritten every frame (particles, lights, materials, glTF, post) belong to their systems.
+ResourceManager resources;
+
+// References to mesh buffers held by the VAOs, released at exit
+std::vector<BufferHandle> sceneBuffers;
+
+// Block compress textures that are decoded at load time (BC_NONE uploads them uncompressed)
+BCFormat loadTimeCompression = BC_NONE;
+BCQuality loadTimeQuality = BC_QUALITY_FAST;
+
+// Build mip chains for decoded textures on the CPU (gamma correct) instead of glGenerateMipmap
+bool cpuMipmaps = true;
+MipOptions loadTimeMipOptions;
+
+// Textures created with createTextureAsync stream in through pixel buffers, at most this many bytes per frame
+TextureUploader textureUploader;
+size_t uploadBytesPerFrame = 4 << 20;
+
+// Streamed textures keep only the mips their on screen size needs, evicting least recently used levels past the budget
+TextureStreamer textureStreamer;
+size_t textureBudgetBytes = 64 << 20;
+
+// Pack loaded meshes into 16 byte vertices (quantized positions, octahedral normals, half UVs) instead of 32 bytes of floats
+bool compressMeshVertices = true;
+VertexFormat meshVertexFormat;
+
+// Split loaded meshes into meshlets and draw only the clusters that pass frustum and back face cone culling
+bool meshletCulling = true;
+MeshletRenderer meshletRenderer;
+
+// Every material in one uniform buffer, draws pick theirs by ID
+MaterialRegistry materials;
+
+// Point, spot and directional lights, culled to the frustum and handed to each draw as its strongest few
+LightManager lights;
+int lightBufferUnit = 1;
+int extraLights = 0;		// Scatter this many small colored point lights around the cubes to test light counts
+
+// Particle fountain above the cubes, simulated with SIMD on worker threads and drawn as one instanced call.
+// gpuParticles runs the simulation in a compute shader instead (GL 4.3), falling back to the CPU without it.
+ParticleSystem particles;
+ParticleRenderer particleRenderer;
+ParticleCompute particleCompute;
+bool gpuParticles = false;
+size_t maxParticles = 1 << 20;
+float particleRate = 20000.0f;		// Per second, about 660000 keeps all of maxParticles alive
+
+// Screen space outlines around selected objects (the center cube and a loaded .obj), a fixed cost however many are selected
+OutlineRenderer outline;
+bool outlineSelection = true;
+
+// The scene renders into a pooled offscreen target, then the post chain writes it to the window. Adjacent per-pixel
+// passes are fused into one shader, so the image is read and written once for all of them.
+RenderTargetPool renderTargets;
+PostChain postChain;
+bool postProcessing = true;
+
+// The scene is lit in RGBA16F, exposed from its luminance histogram (compute on 4.3, a mip chain otherwise) and tonemapped
+AutoExposure autoExposure;
+GLenum sceneFormat = GL_RGBA16F;
+int exposureTextureUnit = 2;
+
+// Scale the scene's resolution to hold the GPU frame time at dynamicResolution.targetMs, upscaled and sharpened by the chain
+DynamicResolution dynamicResolution;
+
+// Swap interval plus an optional frame rate cap, waited out with a sleep then a short spin. Swap to swap times are reported on exit.
+FramePacer framePacer;
+SwapMode swapMode = SWAP_ADAPTIVE;
+double targetFps = 0.0;		// 0 for no cap beyond the swap mode, e.g. 60 with SWAP_IMMEDIATE saves power without vsync latency
+
+// Captures the session's input with --record <file>, feeds a captured one back with its frame times with --replay <file>
+InputRecorder inputRecorder;
+
+// Draws, binds, uniforms and uploads per frame from wrapped GL entry points (RENDER_STATS builds), printed every second with the fps
+RenderStats renderStats;
+
+// GL errors and driver warnings from the KHR_debug callback, deduplicated. Debug builds ask for a debug context, which
+// makes drivers report more.
+DebugOutput debugOutput;
+#ifdef NDEBUG
+bool debugContext = false;
+#else
+bool debugContext = true;
+#endif
+
+// Scratch memory for data that only lives for one frame, reset at the top of the render loop
+FrameArena frameArena;
+
+// With TRACK_ALLOCATIONS (Debug builds) report heap allocations in the render loop once it is warmed up
+FrameAllocationCheck allocationCheck;
+
+int main(int argc, char** argv)
 {
+	// [model] [--benchmark <description.json> [output.json]] [--record <file> | --replay <file>]
+	// --benchmark flies a scripted camera path at a fixed timestep and writes its metrics
+	const char* modelPath = NULL;
+	const char* benchmarkPath = NULL;
+	const char* benchmarkOutput = "benchmark.json";
+	const char* recordPath = NULL;
+	const char* replayPath = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+		{
+			benchmarkPath = argv[++i];
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+				benchmarkOutput = argv[++i];
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			recordPath = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replayPath = argv[++i];
+		else
+			modelPath = argv[i];
+	}
+	Benchmark benchmark;
+	bool benchmarking = benchmarkPath != NULL;
+	if (benchmarking)
+	{
+		if (!benchmark.load(benchmarkPath))
+			return -1;
+		applyBenchmarkScene(benchmark.scene());
+		width = benchmark.width(width);
+		height = benchmark.height(height);
+		swapMode = SWAP_IMMEDIATE;		// Vsync or a cap would measure the display instead of the renderer
+		targetFps = 0.0;
+	}
+
 	// Create window
 	GLFWwindow* window = initWindow(width, height);
 	if (window == NULL)
 		return -1;
+	resources.init(glExt);
+	textureUploader.init();
+	textureStreamer.init(glExt, textureBudgetBytes, uploadBytesPerFrame);
+	meshletRenderer.init(glExt);
+	materials.init();
+	lights.init();
+	particleRenderer.init();
+	outline.init();
+	outline.setColor(2, glm::vec4(0.2f, 0.7f, 1.0f, 1.0f));	// Loaded model
+	autoExposure.init(glExt);
+	dynamicResolution.init();
+	postChain.init();
+	postChain.add({ "upscale", POST_SAMPLE, "shaders/post_upscale.glsl", "upscale", GL_RGBA16F });
+	postChain.add({ "tonemap", POST_PIXEL, "shaders/post_tonemap.glsl", "tonemap" });
+	postChain.add({ "colorGrade", POST_PIXEL, "shaders/post_color_grade.glsl", "colorGrade" });
+	postChain.add({ "vignette", POST_PIXEL, "shaders/post_vignette.glsl", "vignette" });
+	postChain.add({ "dither", POST_PIXEL, "shaders/post_dither.glsl", "dither" });
+	postChain.build();
+	if (const Shader* tonemapProgram = postChain.program("tonemap"))
+	{
+		tonemapProgram->use();
+		tonemapProgram->setInt("exposureTexture", exposureTextureUnit);
+	}
+	const Shader* upscaleProgram = postChain.program("upscale");
 
 	// Create shader program
 	Shader shader1("shaders/vertex_shader_1.vs", "shaders/fragment_shader_1.fs");
 	Shader shader2("shaders/vertex_shader_2.vs", "shaders/fragment_shader_2.fs");
+	Shader texturedShader("shaders/vertex_shader_2.vs", "shaders/textured.fs");
 	Shader lightingShader("shaders/lighting.vs", "shaders/lighting.fs");
 	Shader lightShader("shaders/lighting.vs", "shaders/light.fs");
+	Shader particleShader("shaders/particle.vs", "shaders/particle.fs");
+	std::vector<ProgramHandle> programs;
+	programs.push_back(resources.adoptProgram(shader1.ID));
+	programs.push_back(resources.adoptProgram(shader2.ID));
+	programs.push_back(resources.adoptProgram(texturedShader.ID));
+	programs.push_back(resources.adoptProgram(lightingShader.ID));
+	programs.push_back(resources.adoptProgram(lightShader.ID));
+	programs.push_back(resources.adoptProgram(particleShader.ID));
+	materials.attach(lightingShader);
+	lights.attach(lightingShader, lightBufferUnit);
 
 	// Total system attributes
 	int nrAttributes;
 	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
 	std::cout << "Maximum nr of vertex attributes supported: " << nrAttributes << std::endl;
 
-	// Create textures
-	unsigned int texture1 = createTexture("rsc/imgs/image.png");
-	unsigned int texture2 = createTexture("rsc/imgs/pattern.jpg");
+	// Create textures, cooked ones come straight from the pack (see tools/texcook.cpp)
+	TexturePack texturePack;
+	if (!texturePack.open("rsc/textures.pack"))
+		std::cout << "No texture pack found, decoding textures at load time" << std::endl;
+
+	// Pack every texture into one array so materials only pick indices, no per-draw texture binds
+	TextureArrayBuilder textureArrayBuilder;
+	int texture1 = textureArrayBuilder.add(texturePack, "rsc/imgs/image.png");
+	int texture2 = textureArrayBuilder.add(texturePack, "rsc/imgs/pattern.jpg");
+	if (texture1 < 0)
+		texture1 = textureArrayBuilder.placeholder();	// Never index textureRects[-1]
+	if (texture2 < 0)
+		texture2 = textureArrayBuilder.placeholder();
+	std::vector<TextureRegion> textureRegions;
+	TextureHandle textureArray = resources.adoptTexture(textureArrayBuilder.build(textureRegions), GL_TEXTURE_2D_ARRAY);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, resources.get(textureArray));
+
 	shader2.use();
-	shader2.setInt("texture1", 0);
-	shader2.setInt("texture2", 1);
+	shader2.setInt("textures", 0);
+	for (size_t i = 0; i < textureRegions.size(); i++)
+	{
+		shader2.setVec4(("textureRects[" + std::to_string(i) + "]").c_str(), textureRegions[i].rect);
+		shader2.setInt(("textureLayers[" + std::to_string(i) + "]").c_str(), textureRegions[i].layer);
+	}
+	shader2.setInt("texture1", texture1);
+	shader2.setInt("texture2", texture2);
+	texturedShader.use();
+	texturedShader.setInt("image", 0);
+
+	// Standalone textures for the gallery quads, cooked from the pack or decoded with CPU mips / BC compression
+	std::vector<TextureHandle> galleryTextures;
+	galleryTextures.push_back(createTexture(texturePack, "rsc/imgs/image.png"));
+	galleryTextures.push_back(createTextureAsync(textureUploader, "rsc/imgs/pattern.jpg"));	// Sharpens as its levels arrive
+	// Grey and grey + alpha images must come out grey on every path, not red (see setTextureSwizzle)
+	galleryTextures.push_back(createTexture(texturePack, "rsc/imgs/grey.png"));
+	galleryTextures.push_back(createTextureAsync(textureUploader, "rsc/imgs/grey_alpha.png"));
+
+	// The same images streamed for the last gallery quads, starting from their 64 pixel mips
+	std::vector<int> streamedTextures;
+	const char* streamedPaths[] = { "rsc/imgs/image.png", "rsc/imgs/pattern.jpg", "rsc/imgs/grey.png" };
+	for (const char* path : streamedPaths)
+	{
+		int streamed = textureStreamer.add(texturePack, path);
+		if (streamed >= 0)
+			streamedTextures.push_back(streamed);
+	}
+	int gallerySlots = 1 + (int)galleryTextures.size() + (int)streamedTextures.size();
 
 	// Cube vertices
 	float cube[] = {
@@ -115,16 +369,76 @@ int main()
 
 	// VAO & VBO for the object
 	unsigned int objectVAO = createVAO();
-	createVBO(cube, sizeof(cube), cubeVertexLen);
+	createVBO(cube, sizeof(cube), cubeVertexLen, "cube vertices");
 	addVertexAttrib(0, 3, cubeVertexLen, 0); // Attribute 0 for the vertex coordinates
 	addVertexAttrib(1, 3, cubeVertexLen, 3); // Attribute 1 for the normal vecotr
 
-	// VAO & VBO for the light source
+	// VAO for the light source, same vertices so the VBO is shared
 	unsigned int lightVAO = createVAO();
-	createVBO(cube, sizeof(cube), cubeVertexLen);
+	createVBO(cube, sizeof(cube), cubeVertexLen, "cube vertices");
 	addVertexAttrib(0, 3, cubeVertexLen, 0); // Attribute 0 for the vertex coordinates
 	addVertexAttrib(1, 3, cubeVertexLen, 3); // Attribute 1 for the normal vecotr
 
+	// Gallery quad above the cubes, one per texture path: position, color, uv
+	float quad[] = {
+		-0.5f, -0.5f, 0.0f,  1.0f, 1.0f, 1.0f,  0.0f, 0.0f,
+		 0.5f, -0.5f, 0.0f,  1.0f, 1.0f, 1.0f,  1.0f, 0.0f,
+		 0.5f,  0.5f, 0.0f,  1.0f, 1.0f, 1.0f,  1.0f, 1.0f,
+		 0.5f,  0.5f, 0.0f,  1.0f, 1.0f, 1.0f,  1.0f, 1.0f,
+		-0.5f,  0.5f, 0.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f,
+		-0.5f, -0.5f, 0.0f,  1.0f, 1.0f, 1.0f,  0.0f, 0.0f
+	};
+	int quadVertexLen = 8;
+	unsigned int quadVAO = createVAO();
+	createVBO(quad, sizeof(quad), quadVertexLen, "gallery quad vertices");
+	addVertexAttrib(0, 3, quadVertexLen, 0);
+	addVertexAttrib(1, 3, quadVertexLen, 3);
+	addVertexAttrib(2, 2, quadVertexLen, 6);
+	glBindVertexArray(0);
+
+	// Optional model given on the command line (.obj, .gltf or .glb, or a cooked .pack of meshes), drawn next to the cubes
+	if (benchmarking)
+		modelPath = benchmark.scene()["model"].isString() ? benchmark.scene()["model"].asString().c_str() : NULL;
+	Mesh objMesh;
+	unsigned int objVAO = 0;
+	VertexLayout objLayout;
+	MeshletMesh objMeshlets;
+	GltfModel gltfModel;
+	glm::mat4 assetModel(1.0f);
+	MeshPack meshPack;
+	std::vector<unsigned int> packVAOs;
+	if (modelPath)
+	{
+		std::string extension = modelPath;
+		extension = extension.substr(extension.find_last_of('.') + 1);
+		MeshLoadStats loadStats;
+		if (extension == "obj" && loadObj(modelPath, objMesh, &loadStats))
+		{
+			if (meshletCulling)
+				objMeshlets = buildMeshlets(objMesh);	// Reorders the indices, so before the upload
+			objVAO = createMeshVAO(objMesh, objLayout);
+			assetModel = fitModelMatrix(objMesh.boundsMin, objMesh.boundsMax, glm::vec3(0.0f, 0.0f, -3.0f), 2.0f);
+			loadStats.print(modelPath);
+		}
+		else if ((extension == "gltf" || extension == "glb") && loadGltf(modelPath, gltfModel, &loadStats))
+		{
+			assetModel = fitModelMatrix(gltfModel.boundsMin, gltfModel.boundsMax, glm::vec3(0.0f, 0.0f, -3.0f), 2.0f);
+			loadStats.print(modelPath);
+		}
+		else if (extension == "pack" && meshPack.open(modelPath))
+		{
+			// Nothing to parse, every buffer is filled straight from the mapping
+			auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < meshPack.size(); i++)
+				packVAOs.push_back(createMeshVAO(meshPack, meshPack.entry(i)));
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			printf("%s: %u meshes, %.1f MB in %.2f ms\n", modelPath, meshPack.size(), meshPack.bytes() / 1e6, ms);
+		}
+		else
+			std::cout << "Failed to load model " << modelPath << std::endl;
+	}
+	resources.printReport();
+
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);		// Wireframe mode
 
 	// Light source model matrix
@@ -134,54 +448,142 @@ int main()
 
 	// Object mode matrix
 	glm::mat4 model = glm::mat4(1.0f);
-	glm::mat4 wireModel = glm::scale(model, glm::vec3(1.05f));
 
 	// Materials
-	Material ruby = {
+	uint32_t ruby = materials.add("ruby", {
 		glm::vec3(0.1745f, 0.01175f, 0.01175f),
 		glm::vec3(0.61424f, 0.04136f, 0.04136f),
 		glm::vec3(0.727811f, 0.626959f, 0.626959f),
 		0.6f
-	};
+	});
 
-	Material gold = {
+	uint32_t gold = materials.add("gold", {
 		glm::vec3(0.24725f, 0.1995f, 0.0745f),
 		glm::vec3(0.75164f, 0.60648f, 0.22648f),
 		glm::vec3(0.628281f, 0.555802f, 0.366065f),
 		0.4f
-	};
+	});
 
-	Material mat = {
+	uint32_t mat = materials.add("mat", {
 		glm::vec3(1.0f, 0.5f, 0.31f),
 		glm::vec3(1.0f, 0.5f, 0.31f),
 		glm::vec3(0.5f, 0.5f, 0.5f),
 		0.25f
+	});
+
+	// Cubes drawn with the lighting shader, sorted by material so each material is selected once per frame
+	struct CubeDraw
+	{
+		glm::vec3 position;
+		uint32_t material;
+		int outlineId;		// Outline mask ID, 0 when not selected
 	};
+	CubeDraw cubeDraws[] = {
+		{ glm::vec3(0.0f, 0.0f, 0.0f), gold, 1 },
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), ruby, 0 },
+		{ glm::vec3(1.0f, 0.0f, 0.0f), mat, 0 }
+	};
+	std::vector<MaterialDraw> cubeOrder;
+	for (uint32_t i = 0; i < sizeof(cubeDraws) / sizeof(*cubeDraws); i++)
+		cubeOrder.push_back(MaterialDraw{ cubeDraws[i].material, i });
+	std::sort(cubeOrder.begin(), cubeOrder.end());
+
+	// The orbiting light, bright enough at its orbit radius to match the unattenuated light it replaced
+	Light orbit;
+	orbit.color = lightColor;
+	orbit.intensity = 9.0f;
+	orbit.range = 10.0f;
+	uint32_t orbitLight = lights.add(orbit);
+	for (int i = 0; i < extraLights; i++)
+	{
+		Light extra;
+		float angle = i * 2.39996f;		// Golden angle spiral
+		float distance = 1.5f + 0.05f * i;
+		extra.position = glm::vec3(cos(angle) * distance, sin(i * 0.7f), sin(angle) * distance);
+		extra.color = glm::vec3(0.5f + 0.5f * cos(angle), 0.5f + 0.5f * sin(angle), 0.5f);
+		extra.range = 1.5f;
+		lights.add(extra);
+	}
+
+	// Particle fountain rising from the top of the center cube
+	ParticleEmitter fountain;
+	fountain.position = glm::vec3(0.0f, 0.6f, 0.0f);
+	fountain.rate = particleRate;
+	if (gpuParticles && !particleCompute.init(glExt, particleRenderer, maxParticles))
+	{
+		std::cout << "ERROR::PARTICLES::COMPUTE_NOT_SUPPORTED, simulating on the CPU" << std::endl;
+		gpuParticles = false;
+	}
+	if (gpuParticles)
+		particleCompute.addEmitter(fountain);
+	else
+	{
+		particles.init(maxParticles);
+		particles.addEmitter(fountain);
+	}
+	double particleMs = 0.0;
+	double simulatedParticles = 0.0;
+
+	// The benchmark drives the camera itself, so it takes precedence over recording or replaying input
+	if (benchmarking && (recordPath || replayPath))
+		std::cout << "ERROR::INPUT_RECORDER::IGNORED_WHILE_BENCHMARKING" << std::endl;
+	else if (replayPath && !inputRecorder.startReplay(replayPath, camera))
+		return -1;
+	else if (recordPath && !inputRecorder.startRecording(recordPath, camera))
+		return -1;
 
 	// Render loop
-	double lastTime = glfwGetTime();
-	int nbFrames = 0;
 	do
 	{
-		// Calculate delta time
+		frameArena.reset();
+		allocationCheck.beginFrame();
+		dynamicResolution.beginFrame();
+		renderStats.beginFrame();
+
+		// Calculate delta time, a fixed step along the camera path when benchmarking
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
-
-		// Calculate FPS
-		nbFrames++;
-		calcFPS(nbFrames, lastTime);
+		if (benchmarking)
+		{
+			deltaTime = benchmark.timestep();
+			benchmark.beginFrame(camera);
+		}
+		else if (!inputRecorder.beginFrame(deltaTime))
+			glfwSetWindowShouldClose(window, true);		// Replay finished
+
+		// Frame rate and render stats of the last second
+		renderStats.report(glfwGetTime());
+
+		// Scene goes to an offscreen target for the post chain, straight to the window without it
+		RenderTarget* sceneTarget = NULL;
+		glm::ivec2 renderSize(width, height);
+		if (postProcessing && width > 0 && height > 0)
+		{
+			// Always window sized, dynamic resolution only draws into its bottom left renderSize
+			sceneTarget = renderTargets.acquire(RenderTargetDesc{ width, height, sceneFormat, true });
+			renderSize = dynamicResolution.renderSize(width, height);
+			glBindFramebuffer(GL_FRAMEBUFFER, sceneTarget->fbo);
+			glViewport(0, 0, renderSize.x, renderSize.y);
+		}
 
 		// Clear previous color and depth buffer
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClearStencil(0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// Handle input
-		processInput(window);
+		// Handle input, the benchmark owns the camera
+		if (!benchmarking)
+			processInput(window);
+		else if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+			glfwSetWindowShouldClose(window, true);
+
+		// Stream pending texture rows
+		debugPushGroup("Texture upload");
+		textureUploader.update(uploadBytesPerFrame);
+		debugPopGroup();
 
 		// Update time values
-		float timeValue = glfwGetTime();
+		float timeValue = benchmarking ? benchmark.time() : inputRecorder.mode() != INPUT_LIVE ? (float)inputRecorder.time() : glfwGetTime();
 		float colorValue = (sin(timeValue) / 2.0f) + 0.5f;
 		float posValue = sin(timeValue);
 
@@ -189,15 +591,50 @@ int main()
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
 
+		// Request streamed mips for the projected size of the gallery quads sampling them, when they are in view
+		float pixelsPerUnit = renderSize.y / (2.0f * tan(glm::radians(camera.Zoom) * 0.5f));
+		for (size_t i = 0; i < streamedTextures.size(); i++)
+		{
+			glm::vec3 center(galleryModel(1 + (int)(galleryTextures.size() + i), gallerySlots)[3]);
+			glm::vec4 clip = projection * view * glm::vec4(center, 1.0f);
+			float reach = clip.w + 0.71f * projection[1][1];	// Quad half diagonal past the center
+			if (clip.w > 0.0f && std::fabs(clip.x) <= reach && std::fabs(clip.y) <= reach)
+				textureStreamer.request(streamedTextures[i], pixelsPerUnit / std::max(glm::distance(camera.Position, center), 0.1f));
+		}
+		debugPushGroup("Texture streaming");
+		textureStreamer.update();
+		debugPopGroup();
+
 		// Light movement
 		int radius = 3;
 		//lightPos = lightOffset;
 		lightPos = glm::vec3(cos(timeValue) * radius, 0.0f, sin(timeValue) * radius);
 		//lightColor = glm::vec3(cos(timeValue), 0.0f, sin(timeValue));
-		glm::vec3 diffuseColor = lightColor;
 		glm::vec3 ambientColor = lightColor;
+		lights.setPosition(orbitLight, lightPos);
+		lights.cull(glm::value_ptr(projection * view));
+		lights.upload(lightBufferUnit);
+		int lightList[LIGHTS_PER_OBJECT];
+		int lightCount;
+
+		// Simulate particles, the CPU path writes its instances straight into the mapped stream buffer
+		debugPushGroup("Particle simulation");
+		if (gpuParticles)
+			particleCompute.update(deltaTime);
+		else
+		{
+			auto particleStart = std::chrono::steady_clock::now();
+			particles.emit(deltaTime);
+			ParticleInstance* instances = particleRenderer.map(particles.slotCount());
+			particles.simulate(deltaTime, instances);
+			particleRenderer.unmap();
+			particleMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - particleStart).count();
+			simulatedParticles += particles.slotCount();
+		}
+		debugPopGroup();
 
 		// Render Light
+		debugPushGroup("Scene");
 		glBindVertexArray(lightVAO);
 		lightShader.use();
 
@@ -213,71 +650,254 @@ int main()
 		lightShader.setMat3("tiModel", glm::value_ptr(tiLightModel));
 		glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
 
-		Light light = {
-			lightPos,
-			ambientColor,
-			diffuseColor,
-			lightColor,
-		};
-
 		// Render Object
 		glBindVertexArray(objectVAO);
 		lightingShader.use();
+		materials.upload();
 
-		model = glm::mat4(1.0f);
-		glm::mat3 tiModel = glm::transpose(glm::inverse(model));
-
-		lightingShader.setMaterial(gold);
-		lightingShader.setLight(light);
-		lightingShader.setVec3("ViewPos", camera.Position);
-
-		lightingShader.setMat4("model", glm::value_ptr(model));
+		lightingShader.setVec3("ambientColor", ambientColor);
+		lightingShader.setBool("octNormals", false);
+		lightingShader.setVec3("viewPos", camera.Position);
 		lightingShader.setMat4("view", glm::value_ptr(view));
 		lightingShader.setMat4("projection", glm::value_ptr(projection));
-		lightingShader.setMat3("tiModel", glm::value_ptr(tiModel));
-		glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
-
-		model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 0.0f));
-		tiModel = glm::transpose(glm::inverse(model));
-		lightingShader.setMat4("model", glm::value_ptr(model));
-		lightingShader.setMat3("tiModel", glm::value_ptr(tiModel));
-		lightingShader.setMaterial(ruby);
-		glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
-
-		model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-		tiModel = glm::transpose(glm::inverse(model));
-		lightingShader.setMat4("model", glm::value_ptr(model));
-		lightingShader.setMat3("tiModel", glm::value_ptr(tiModel));
-		lightingShader.setMaterial(mat);
-		glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
-
-		// Render the mesh into the stencil buffer.
-		//glEnable(GL_STENCIL_TEST);
-
-		//glStencilFunc(GL_ALWAYS, 1, -1);
-		//glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-
-		//glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
-
-		//// Render the thick wireframe version.
-		//glStencilFunc(GL_NOTEQUAL, 1, -1);
-		//glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-
-		//glLineWidth(3);
-		//glPolygonMode(GL_FRONT, GL_LINE);
-
-		//lightShader.use();
-		//lightShader.setFloat3("lightColor", 1.0f, 0.0f, 0.0f);
-		//lightShader.setMat4("model", glm::value_ptr(wireModel));
-		//glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
-
 
-		// Call events and swap buffers
+		glm::mat3 tiModel;
+		uint32_t currentMaterial = UINT32_MAX;
+		for (const MaterialDraw& item : cubeOrder)
+		{
+			if (item.material != currentMaterial)
+			{
+				materials.use(lightingShader, item.material);
+				currentMaterial = item.material;
+			}
+			lightCount = lights.gather(cubeDraws[item.draw].position, 0.87f, lightList);
+			lights.apply(lightingShader, lightList, lightCount);
+			model = glm::translate(glm::mat4(1.0f), cubeDraws[item.draw].position);
+			tiModel = glm::transpose(glm::inverse(model));
+			lightingShader.setMat4("model", glm::value_ptr(model));
+			lightingShader.setMat3("tiModel", glm::value_ptr(tiModel));
+			glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
+		}
+
+		// Loaded models all share one material, and one light list for the box they are fitted into
+		if (currentMaterial != mat)
+			materials.use(lightingShader, mat);
+		lightCount = lights.gather(glm::vec3(0.0f, 0.0f, -3.0f), 1.74f, lightList);
+		lights.apply(lightingShader, lightList, lightCount);
+
+		// Render loaded model
+		if (objVAO)
+		{
+			// Quantized positions decode through the model matrix, normals must not see that scale
+			model = assetModel * dequantizeMatrix(objLayout);
+			tiModel = glm::transpose(glm::inverse(assetModel));
+			lightingShader.setMat4("model", glm::value_ptr(model));
+			lightingShader.setMat3("tiModel", glm::value_ptr(tiModel));
+			lightingShader.setBool("octNormals", (objLayout.flags & VERTEX_OCT_NORMALS) != 0);
+			glBindVertexArray(objVAO);
+			if (meshletCulling)
+			{
+				// Cull in the mesh's own space: planes from the full transform, camera brought back by the inverse model
+				MeshletCullView cullView;
+				glm::mat4 mvp = projection * view * assetModel;
+				meshletFrustumPlanes(glm::value_ptr(mvp), cullView);
+				glm::vec4 localCamera = glm::inverse(assetModel) * glm::vec4(camera.Position, 1.0f);
+				cullView.camera[0] = localCamera.x;
+				cullView.camera[1] = localCamera.y;
+				cullView.camera[2] = localCamera.z;
+				FrameVector<uint32_t> visibleMeshlets(frameArena);
+				visibleMeshlets.reserve(objMeshlets.meshlets.size());
+				cullMeshlets(objMeshlets.bounds, cullView, visibleMeshlets);
+				meshletRenderer.draw(objMeshlets, visibleMeshlets, GL_UNSIGNED_INT);
+			}
+			else
+			{
+				glDrawElements(GL_TRIANGLES, (GLsizei)objMesh.indices.size(), GL_UNSIGNED_INT, 0);
+			}
+		}
+		lightingShader.setBool("octNormals", false);
+		for (const GltfDraw& draw : gltfModel.draws)
+		{
+			model = assetModel * draw.transform;
+			tiModel = glm::transpose(glm::inverse(model));
+			lightingShader.setMat4("model", glm::value_ptr(model));
+			lightingShader.setMat3("tiModel", glm::value_ptr(tiModel));
+			gltfModel.draw(draw);
+		}
+		for (uint32_t i = 0; i < packVAOs.size(); i++)
+		{
+			// Pack meshes in a row behind the cubes, each drawing the coarsest LOD that stays under a pixel of error
+			const MeshPackEntry& entry = meshPack.entry(i);
+			model = fitModelMatrix(entry.boundsMin, entry.boundsMax, glm::vec3(2.5f * i, 0.0f, -3.0f), 2.0f);
+			glm::vec3 center = glm::vec3(model * glm::vec4(entry.sphere[0], entry.sphere[1], entry.sphere[2], 1.0f));
+			float scale = glm::length(glm::vec3(model[0]));
+			const MeshPackLod& lod = entry.lods[meshPackSelectLod(entry, scale, glm::distance(center, camera.Position), pixelsPerUnit)];
+
+			lightCount = lights.gather(center, entry.sphere[3] * scale, lightList);
+			lights.apply(lightingShader, lightList, lightCount);
+
+			tiModel = glm::transpose(glm::inverse(model));
+			model = model * dequantizeMatrix(entry.layout);
+			lightingShader.setMat4("model", glm::value_ptr(model));
+			lightingShader.setMat3("tiModel", glm::value_ptr(tiModel));
+			lightingShader.setBool("octNormals", (entry.layout.flags & VERTEX_OCT_NORMALS) != 0);
+			glBindVertexArray(packVAOs[i]);
+			size_t indexSize = entry.indexType == MESH_UNSIGNED_SHORT ? 2 : 4;
+			glDrawElements(GL_TRIANGLES, lod.indexCount, entry.indexType, (void*)(lod.firstIndex * indexSize));
+		}
+		debugPopGroup();
+
+		// Texture gallery: the array (mixed with up / down) first, then each standalone texture, then the streamed ones
+		debugPushGroup("Texture gallery");
+		glBindVertexArray(quadVAO);
+		glActiveTexture(GL_TEXTURE0);
+		shader2.use();
+		shader2.setMat4("view", glm::value_ptr(view));
+		shader2.setMat4("projection", glm::value_ptr(projection));
+		shader2.setMat4("model", glm::value_ptr(galleryModel(0, gallerySlots)));
+		shader2.setFloat("mixValue", mixValue);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, resources.get(textureArray));
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		texturedShader.use();
+		texturedShader.setMat4("view", glm::value_ptr(view));
+		texturedShader.setMat4("projection", glm::value_ptr(projection));
+		for (size_t i = 0; i < galleryTextures.size(); i++)
+		{
+			texturedShader.setMat4("model", glm::value_ptr(galleryModel(1 + (int)i, gallerySlots)));
+			glBindTexture(GL_TEXTURE_2D, resources.get(galleryTextures[i]));
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+		for (size_t i = 0; i < streamedTextures.size(); i++)
+		{
+			texturedShader.setMat4("model", glm::value_ptr(galleryModel(1 + (int)(galleryTextures.size() + i), gallerySlots)));
+			glBindTexture(GL_TEXTURE_2D, textureStreamer.texture(streamedTextures[i]));
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		debugPopGroup();
+
+		// Particles after every opaque draw, blended over the scene
+		debugPushGroup("Particles");
+		size_t particleSlots = gpuParticles ? particleCompute.slotCount() : particles.slotCount();
+		if (gpuParticles)
+			particleRenderer.draw(particleShader, view, projection, particleSlots, particleCompute.instanceVAO());
+		else
+			particleRenderer.draw(particleShader, view, projection, particleSlots);
+		debugPopGroup();
+
+		// Post-process into the window, overlays below draw on top of the result
+		if (sceneTarget)
+		{
+			debugPushGroup("Post-processing");
+			autoExposure.update(*sceneTarget, renderSize.x, renderSize.y, deltaTime);
+			autoExposure.bind(exposureTextureUnit);
+			if (upscaleProgram)
+			{
+				upscaleProgram->use();
+				upscaleProgram->setFloat("sharpness", dynamicResolution.sharpness());
+			}
+			postChain.run(renderTargets, *sceneTarget, renderSize.x, renderSize.y, width, height);
+			renderTargets.release(sceneTarget);
+			debugPopGroup();
+		}
+
+		// Outline the selected objects: each drawn once into the ID mask, then one flood and blend for all of them
+		if (outlineSelection)
+		{
+			debugPushGroup("Outline");
+			const Shader& maskShader = outline.beginMask(width, height);
+			maskShader.setMat4("view", glm::value_ptr(view));
+			maskShader.setMat4("projection", glm::value_ptr(projection));
+			maskShader.setBool("octNormals", false);
+			glBindVertexArray(objectVAO);
+			for (const CubeDraw& cube : cubeDraws)
+			{
+				if (cube.outlineId == 0)
+					continue;
+				model = glm::translate(glm::mat4(1.0f), cube.position);
+				maskShader.setMat4("model", glm::value_ptr(model));
+				maskShader.setInt("objectId", cube.outlineId);
+				glDrawArrays(GL_TRIANGLES, 0, cubeVertexCount);
+			}
+			if (objVAO)
+			{
+				model = assetModel * dequantizeMatrix(objLayout);
+				maskShader.setMat4("model", glm::value_ptr(model));
+				maskShader.setInt("objectId", 2);
+				glBindVertexArray(objVAO);
+				glDrawElements(GL_TRIANGLES, (GLsizei)objMesh.indices.size(), GL_UNSIGNED_INT, 0);
+			}
+			outline.endMask();
+			outline.render();
+			debugPopGroup();
+		}
+
+		dynamicResolution.endFrame();
+		renderStats.endFrame();
+		debugOutput.endFrame();
+		if (benchmarking && benchmark.endFrame(renderStats.last()))
+			glfwSetWindowShouldClose(window, true);
+
+		// Call events and swap buffers, a replay feeds its recorded events where the live ones would have arrived
 		glfwPollEvents();
-		glfwSwapBuffers(window);
+		inputRecorder.dispatch(window, mouse_callback, scroll_callback);
+		framePacer.swap(window);
+		resources.endFrame();
+		renderTargets.endFrame();
+		allocationCheck.endFrame();
 
 	} while (!glfwWindowShouldClose(window));
 
+	inputRecorder.finish(camera);
+	if (benchmarking && benchmark.done())
+	{
+		benchmark.addMemory("buffers", resources.bytes(RESOURCE_BUFFER));
+		benchmark.addMemory("textures", resources.bytes(RESOURCE_TEXTURE));
+		benchmark.addMemory("renderTargets", renderTargets.bytes());
+		benchmark.addMemory("streamedTextures", textureStreamer.statistics().residentBytes);
+		if (benchmark.write(benchmarkOutput))
+			printf("Benchmark results written to %s\n", benchmarkOutput);
+		benchmark.printReport();
+	}
+	textureStreamer.statistics().print();
+	autoExposure.printReport();
+	dynamicResolution.printReport();
+	framePacer.printReport();
+	renderStats.printReport();
+	debugOutput.printReport();
+	postChain.printReport();
+	renderTargets.printReport();
+	if (gpuParticles)
+		printf("Particles: %.0f per ms (compute shader)\n", particleCompute.particlesPerMs());
+	else if (particleMs > 0.0)
+		printf("Particles: %.0f per ms (CPU, %d threads)\n", simulatedParticles / particleMs, defaultThreadCount());
+	textureUploader.release();	// Needs the context, so before glfwTerminate
+	textureStreamer.release();
+	gltfModel.release();
+	meshletRenderer.release();
+	materials.release();
+	lights.release();
+	particleCompute.release();
+	particleRenderer.release();
+	outline.release();
+	postChain.release();
+	autoExposure.release();
+	dynamicResolution.release();
+	renderTargets.release();
+
+	// Drop the demo's references, deletion then goes through the fences as it would at runtime. Objects the report
+	// still counts were never released.
+	for (BufferHandle& buffer : sceneBuffers)
+		resources.release(buffer);
+	for (TextureHandle& texture : galleryTextures)
+		resources.release(texture);
+	resources.release(textureArray);
+	for (ProgramHandle& program : programs)
+		resources.release(program);
+	resources.finish();
+	printf("Resources left after release (leaks):\n");
+	resources.printReport();
+	resources.shutdown();
 	glfwTerminate();
 	return 0;
 }
@@ -285,55 +905,57 @@ int main()
 /* Resize OpenGL viewport when window size changes */
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
+	::width = width;		// Offscreen targets follow the framebuffer size
+	::height = height;
 	glViewport(0, 0, width, height);
 }
 
-/* Handle inputs on the window */
+/* Handle inputs on the window, keys go through the input recorder so they can be recorded and replayed */
 void processInput(GLFWwindow* window)
 {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
 		glfwSetWindowShouldClose(window, true);
 	}
-	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_UP) == GLFW_PRESS)
 	{
 		if (mixValue < 1.0f)
 			mixValue += 0.01f;
 	}
-	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
 	{
 		if (mixValue > 0.0f)
 			mixValue -= 0.01f;
 	}
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_W) == GLFW_PRESS)
 	{
 		camera.ProcessKeyboard(FORWARD, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_S) == GLFW_PRESS)
 	{
 		camera.ProcessKeyboard(BACKWARD, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_A) == GLFW_PRESS)
 	{
 		camera.ProcessKeyboard(LEFT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_D) == GLFW_PRESS)
 	{
 		camera.ProcessKeyboard(RIGHT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
 	{
 		camera.ProcessKeyboard(UP, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
 	{
 		camera.ProcessKeyboard(DOWN, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+	if (inputRecorder.getKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
 	{
 		camera.boost = true;
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
+	if (inputRecorder.getKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
 	{
 		camera.boost = false;
 	}
@@ -342,12 +964,16 @@ void processInput(GLFWwindow* window)
 /* Handles mouse input */
 void mouse_callback(GLFWwindow* window, double xPos, double yPos)
 {
+	if (!inputRecorder.cursorEvent(xPos, yPos))
+		return;
 	camera.ProcessMouseMovement(xPos, yPos);
 }
 
 /* Handles scroll input */
 void scroll_callback(GLFWwindow* window, double xOffset, double yOffset)
 {
+	if (!inputRecorder.scrollEvent(yOffset))
+		return;
 	camera.ProcessMouseScroll(yOffset);
 }
 
@@ -359,6 +985,8 @@ GLFWwindow* initWindow(int& width, int& height)
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);				   // Set OpenGL major version [3]
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);				   // Set OpenGL minor version 3.[3]
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Set Modern OpenGL
+	if (debugContext)
+		glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 
 	// Create window object
 	GLFWwindow* window = glfwCreateWindow(width, height, "LearnOpenGL", NULL, NULL);
@@ -369,7 +997,6 @@ GLFWwindow* initWindow(int& width, int& height)
 		return window;
 	}
 	glfwMakeContextCurrent(window); // Make the window the main context on this thread
-	//glfwSwapInterval(0);				// Uncap fps
 
 	// Initialize GLAD
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -378,6 +1005,11 @@ GLFWwindow* initWindow(int& width, int& height)
 		glfwTerminate();
 		return NULL;
 	}
+	glExt.load();
+	renderStats.init(glExt);		// Before anything copies a GLExtensions entry point
+	debugOutput.init(glExt);		// Before anything is created, so every object gets its label
+	framePacer.setSwapMode(swapMode, glExt);
+	framePacer.targetFps = targetFps;
 
 	// Setup Viewport
 	glViewport(0, 0, width, height);								   // Set OpenGL viewport size
@@ -401,13 +1033,13 @@ unsigned int createVAO()
 	return VAO;
 }
 
-/* Create a VBO */
-void createVBO(float* vertices, int byteSize, int vertexLen)
+/* Create a VBO, or share the existing one holding the same vertices. Left bound to GL_ARRAY_BUFFER. */
+BufferHandle createVBO(const float* vertices, int byteSize, int vertexLen, const char* label)
 {
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);											   // Generate Vertex Buffer Object
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);								   // Bind the Array Buffer to use the VBO
-	glBufferData(GL_ARRAY_BUFFER, byteSize, vertices, GL_STATIC_DRAW); // Copy the Vertices Array to the bound Array Buffer
+	BufferHandle handle = resources.createBuffer(GL_ARRAY_BUFFER, vertices, byteSize);
+	debugLabel(GL_BUFFER, resources.get(handle), label);
+	sceneBuffers.push_back(handle);
+	return handle;
 }
 
 /* Add a vertex attribute to a VBO for shaders to use */
@@ -417,17 +1049,103 @@ void addVertexAttrib(int location, int attribLen, int vertexLen, int offset)
 	glEnableVertexAttribArray(location);
 }
 
-/* Create EBO for indices */
-void createEBO(unsigned int* indices, int byteSize)
+/* Add a vertex attribute described by a mesh layout, offset and stride in bytes */
+void addVertexAttrib(const VertexAttrib& attrib, int stride)
+{
+	glVertexAttribPointer(attrib.location, attrib.components, attrib.type, attrib.normalized ? GL_TRUE : GL_FALSE, stride, (void*)(size_t)attrib.offset);
+	glEnableVertexAttribArray(attrib.location);
+}
+
+/* Create EBO for indices, bound to the current VAO */
+BufferHandle createEBO(const unsigned int* indices, int byteSize, const char* label)
+{
+	BufferHandle handle = resources.createBuffer(GL_ELEMENT_ARRAY_BUFFER, indices, byteSize);
+	debugLabel(GL_BUFFER, resources.get(handle), label);
+	sceneBuffers.push_back(handle);
+	return handle;
+}
+
+/* Create a VAO with VBO and EBO for a loaded mesh, attributes 0 / 1 / 2 are position / normal / uv. layout receives the vertex format used. */
+unsigned int createMeshVAO(const Mesh& mesh, VertexLayout& layout)
+{
+	unsigned int VAO = createVAO();
+	if (compressMeshVertices)
+	{
+		std::vector<unsigned char> packed;
+		layout = encodeVertices(mesh, meshVertexFormat, packed);
+		measureVertexError(mesh, layout, packed).print("Vertex compression");
+		BufferHandle vertices = resources.createBuffer(GL_ARRAY_BUFFER, packed.data(), packed.size());
+		debugLabel(GL_BUFFER, resources.get(vertices), "mesh vertices (packed)");
+		sceneBuffers.push_back(vertices);
+	}
+	else
+	{
+		layout = meshDefaultLayout();
+		createVBO(mesh.vertices.data(), (int)(mesh.vertices.size() * sizeof(float)), MESH_VERTEX_LEN, "mesh vertices");
+	}
+	for (uint32_t i = 0; i < layout.attribCount; i++)
+		addVertexAttrib(layout.attribs[i], layout.stride);
+	createEBO(mesh.indices.data(), (int)(mesh.indices.size() * sizeof(unsigned int)), "mesh indices");
+	glBindVertexArray(0);
+
+	return VAO;
+}
+
+/* Create a VAO for a cooked mesh, both buffers are filled straight from the pack's mapping (keyed by name, no hashing) */
+unsigned int createMeshVAO(const MeshPack& pack, const MeshPackEntry& entry)
+{
+	unsigned int VAO = createVAO();
+	std::string name = entry.name;
+	sceneBuffers.push_back(resources.createBuffer(GL_ARRAY_BUFFER, pack.vertexData(entry), entry.vertexSize, GL_STATIC_DRAW, name + ":vertices"));
+	for (uint32_t i = 0; i < entry.layout.attribCount; i++)
+		addVertexAttrib(entry.layout.attribs[i], entry.layout.stride);
+	sceneBuffers.push_back(resources.createBuffer(GL_ELEMENT_ARRAY_BUFFER, pack.indexData(entry), entry.indexSize, GL_STATIC_DRAW, name + ":indices"));
+	glBindVertexArray(0);
+
+	return VAO;
+}
+
+/* Model matrix that centers a bounding box at position and scales its largest side to size */
+glm::mat4 fitModelMatrix(const float* boundsMin, const float* boundsMax, glm::vec3 position, float size)
+{
+	glm::vec3 lo(boundsMin[0], boundsMin[1], boundsMin[2]);
+	glm::vec3 hi(boundsMax[0], boundsMax[1], boundsMax[2]);
+	glm::vec3 extent = hi - lo;
+	float largest = std::max(extent.x, std::max(extent.y, extent.z));
+	float scale = largest > 0.0f ? size / largest : 1.0f;
+
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+	model = glm::scale(model, glm::vec3(scale));
+	return glm::translate(model, -(lo + hi) * 0.5f);
+}
+
+/* Model matrix part that turns stored (quantized) positions back into object space */
+glm::mat4 dequantizeMatrix(const VertexLayout& layout)
+{
+	glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(layout.positionOffset[0], layout.positionOffset[1], layout.positionOffset[2]));
+	return glm::scale(matrix, glm::vec3(layout.positionScale[0], layout.positionScale[1], layout.positionScale[2]));
+}
+
+/* Model matrix of gallery quad slot out of slots, a centered row above the cubes */
+glm::mat4 galleryModel(int slot, int slots)
+{
+	return glm::translate(glm::mat4(1.0f), glm::vec3(1.1f * (slot - (slots - 1) * 0.5f), 1.25f, 0.0f));
+}
+
+/* Create a texture from given path, or share the one already loaded from it */
+TextureHandle createTexture(const char* path)
+{
+	return resources.loadTexture(path, GL_TEXTURE_2D, [path]() { return uploadTexture(path); });
+}
+
+/* Create a texture from a cooked pack, or share the one already loaded from the same path */
+TextureHandle createTexture(const TexturePack& pack, const char* path)
 {
-	unsigned int EBO;
-	glGenBuffers(1, &EBO);													  // Generate Element Buffer Object
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);								  // Bind the EBO
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, byteSize, indices, GL_STATIC_DRAW); // Set the EBO data to be indices
+	return resources.loadTexture(path, GL_TEXTURE_2D, [&pack, path]() { return uploadTexture(pack, path); });
 }
 
-/* Create a texture from given path */
-unsigned int createTexture(const char* path)
+/* Decode and upload a texture from given path */
+unsigned int uploadTexture(const char* path)
 {
 	unsigned int texture;
 	glGenTextures(1, &texture);
@@ -443,10 +1161,40 @@ unsigned int createTexture(const char* path)
 	stbi_set_flip_vertically_on_load(true);
 	unsigned char* data = stbi_load(path, &tWidth, &tHeight, &nrChannels, 0);
 	// Create texture
-	if (data)
+	BCFormat compression = isCompressionSupported(loadTimeCompression) ? loadTimeCompression : BC_NONE;
+	if (data && compression != BC_NONE)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tWidth, tHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, data); // Generate texture from data
-		glGenerateMipmap(GL_TEXTURE_2D);															// Generate mipmaps
+		// Compressed levels can't be generated by the driver, build the chain on the CPU and encode each level
+		std::vector<MipLevel> chain = generateMipChain(data, tWidth, tHeight, nrChannels, 16, loadTimeMipOptions);
+		std::vector<unsigned char> blocks;
+		for (size_t level = 0; level < chain.size(); level++)
+		{
+			blocks.resize(bcCompressedSize(compression, chain[level].width, chain[level].height));
+			bcCompress(chain[level].pixels.data(), chain[level].width, chain[level].height, nrChannels, compression, loadTimeQuality, blocks.data());
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, bcGLFormat(compression), chain[level].width, chain[level].height, 0, (GLsizei)blocks.size(), blocks.data());
+		}
+	}
+	else if (data && cpuMipmaps)
+	{
+		TextureFormat format = textureFormatForChannels(nrChannels);
+		setTextureSwizzle(format);
+		std::vector<MipLevel> chain = generateMipChain(data, tWidth, tHeight, nrChannels, 16, loadTimeMipOptions);
+		for (size_t level = 0; level < chain.size(); level++)
+		{
+			// Smaller levels have rows that aren't a multiple of 4 bytes
+			glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignmentFor((size_t)chain[level].width * nrChannels));
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, format.internalFormat, chain[level].width, chain[level].height, 0, format.format, GL_UNSIGNED_BYTE, chain[level].pixels.data());
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	else if (data)
+	{
+		TextureFormat format = textureFormatForChannels(nrChannels);
+		setTextureSwizzle(format);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignmentFor((size_t)tWidth * nrChannels));
+		glTexImage2D(GL_TEXTURE_2D, 0, format.internalFormat, tWidth, tHeight, 0, format.format, GL_UNSIGNED_BYTE, data); // Generate texture from data
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);																						// Generate mipmaps
 	}
 	else
 		std::cout << "Failed to load texture!" << std::endl;
@@ -455,17 +1203,115 @@ unsigned int createTexture(const char* path)
 	return texture;
 }
 
-/* Calculate and log fps to the console */
-void calcFPS(int& nbFrames, double& lastTime)
+/* Upload a texture from a cooked pack, every mip directly from the mapped file */
+unsigned int uploadTexture(const TexturePack& pack, const char* path)
 {
-	double currentTime = glfwGetTime();
-	nbFrames++;
-	if (currentTime - lastTime >= 1.0)
-	{ // If last prinf() was more than 1 sec ago
-		// printf and reset timer
-		printf("%f fps\n", 1000.0 / (1000.0 / double(nbFrames)));
-		printf("%f ms/frame\n", 1000.0 / double(nbFrames));
-		nbFrames = 0;
-		lastTime += 1.0;
+	const TexturePackEntry* entry = pack.isOpen() ? pack.find(path) : NULL;
+	if (entry == NULL)
+		return uploadTexture(path);
+
+	TextureFormat format = textureFormatForChannels(entry->channels);
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry->mipCount - 1);	// Chains may be capped short of 1x1
+
+	BCFormat compression = (BCFormat)entry->format;
+	if (compression != BC_NONE && isCompressionSupported(compression))
+	{
+		for (uint32_t level = 0; level < entry->mipCount; level++)
+		{
+			const TexturePackMip& mip = entry->mips[level];
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, bcGLFormat(compression), mip.width, mip.height, 0, (GLsizei)mip.size, pack.mipData(*entry, level));
+		}
+	}
+	else if (compression != BC_NONE)
+	{
+		// The driver lacks the format, decode on the CPU instead
+		std::vector<unsigned char> rgba;
+		for (uint32_t level = 0; level < entry->mipCount; level++)
+		{
+			const TexturePackMip& mip = entry->mips[level];
+			rgba.resize((size_t)mip.width * mip.height * 4);
+			bcDecompress(pack.mipData(*entry, level), mip.width, mip.height, compression, rgba.data());
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		}
 	}
+	else
+	{
+		// Rows in the pack are padded to match the unpack alignment
+		setTextureSwizzle(format);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, TEXPACK_ROW_ALIGNMENT);
+		for (uint32_t level = 0; level < entry->mipCount; level++)
+		{
+			const TexturePackMip& mip = entry->mips[level];
+			glTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, mip.width, mip.height, 0, format.format, GL_UNSIGNED_BYTE, pack.mipData(*entry, level));
+		}
+	}
+
+	return texture;
+}
+
+/* Create a texture whose levels stream in over the next frames, or share the one already loaded from path */
+TextureHandle createTextureAsync(TextureUploader& uploader, const char* path)
+{
+	return resources.loadTexture(path, GL_TEXTURE_2D, [&uploader, path]() { return uploadTextureAsync(uploader, path); });
+}
+
+/* Allocate a texture and queue its levels, smallest first, on the uploader's pixel buffers */
+unsigned int uploadTextureAsync(TextureUploader& uploader, const char* path)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	int tWidth, tHeight, nrChannels;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* data = stbi_load(path, &tWidth, &tHeight, &nrChannels, 0);
+	if (!data)
+	{
+		std::cout << "Failed to load texture!" << std::endl;
+		return texture;
+	}
+	std::vector<MipLevel> chain = generateMipChain(data, tWidth, tHeight, nrChannels, 16, loadTimeMipOptions);
+	stbi_image_free(data);
+
+	TextureUploader::allocate(texture, tWidth, tHeight, nrChannels, (int)chain.size());
+	for (int level = (int)chain.size() - 1; level >= 0; level--)
+		uploader.upload(texture, level, chain[level].width, chain[level].height, nrChannels, std::move(chain[level].pixels));
+
+	return texture;
+}
+
+/* Check whether the driver can sample a block compressed format */
+bool isCompressionSupported(BCFormat format)
+{
+	if (format == BC1 || format == BC3)
+		return glExt.textureCompressionS3TC;
+	if (format == BC7)
+		return glExt.textureCompressionBPTC;
+	return false;
+}
+
+/* Override settings from a benchmark's scene description, anything it leaves out keeps its default */
+void applyBenchmarkScene(const JsonValue& scene)
+{
+	extraLights = scene["extraLights"].asInt(extraLights);
+	particleRate = (float)scene["particleRate"].asNumber(particleRate);
+	maxParticles = (size_t)scene["maxParticles"].asNumber((double)maxParticles);
+	gpuParticles = scene["gpuParticles"].asBool(gpuParticles);
+	meshletCulling = scene["meshletCulling"].asBool(meshletCulling);
+	compressMeshVertices = scene["compressMeshVertices"].asBool(compressMeshVertices);
+	postProcessing = scene["postProcessing"].asBool(postProcessing);
+	outlineSelection = scene["outlineSelection"].asBool(outlineSelection);
+	dynamicResolution.enabled = scene["dynamicResolution"].asBool(dynamicResolution.enabled);
 }
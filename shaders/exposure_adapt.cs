@@ -0,0 +1,55 @@
+#version 430 core
+
+// Averages the luminance histogram between two percentiles and moves the exposure towards exposing that average
+// at keyValue. Clears the histogram for the next frame. One group of 256 invocations, one per bin.
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 0) buffer Histogram {
+	uint bins[256];
+};
+
+layout (r32f, binding = 0) uniform image2D exposure;
+
+uniform float minLogLuminance;
+uniform float logRange;
+uniform float keyValue;
+uniform float adaptation;		// Fraction of the way to the target covered this frame
+uniform float lowPercent;
+uniform float highPercent;
+
+shared uint counts[256];
+
+void main() {
+	uint i = gl_LocalInvocationIndex;
+	counts[i] = bins[i];
+	bins[i] = 0u;
+	barrier();
+
+	if (i != 0u)
+		return;
+	float total = 0.0;
+	for (int b = 1; b < 256; b++)
+		total += float(counts[b]);
+	if (total == 0.0)
+		return;		// All black, keep the exposure
+
+	// Only the part of each bin between the low and high percentiles counts
+	float low = total * lowPercent;
+	float high = total * highPercent;
+	float seen = 0.0;
+	float sum = 0.0;
+	float weight = 0.0;
+	for (int b = 1; b < 256; b++) {
+		float count = float(counts[b]);
+		float taken = clamp(seen + count, low, high) - clamp(seen, low, high);
+		seen += count;
+		sum += taken * (float(b) - 0.5) / 254.0;
+		weight += taken;
+	}
+	if (weight <= 0.0)
+		return;
+	float logAverage = sum / weight * logRange + minLogLuminance;
+	float target = keyValue / exp2(logAverage);
+	float current = imageLoad(exposure, ivec2(0)).r;
+	imageStore(exposure, ivec2(0), vec4(current + (target - current) * adaptation));
+}
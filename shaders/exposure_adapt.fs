@@ -0,0 +1,17 @@
+#version 330 core
+
+// Mip chain fallback of exposure_adapt.cs: the top mip holds the average log luminance, no percentile clipping
+uniform sampler2D logLuminance;
+uniform sampler2D previous;
+uniform float topLevel;
+uniform float keyValue;
+uniform float adaptation;
+
+out float Exposure;
+
+void main() {
+	float logAverage = textureLod(logLuminance, vec2(0.5), topLevel).r;
+	float target = keyValue / exp2(logAverage);
+	float current = texelFetch(previous, ivec2(0), 0).r;
+	Exposure = current + (target - current) * adaptation;
+}
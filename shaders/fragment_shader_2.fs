@@ -1,17 +1,30 @@
 #version 330 core
 
+#define MAX_TEXTURES 32
+
 out vec4 FragColor;
 in vec3 ourColor;
 in vec3 colorOffset;
 in vec2 TexCoord;
 
-uniform sampler2D texture1;
-uniform sampler2D texture2;
+// Every texture lives in one array (see TextureArray.h), materials pick them by index
+uniform sampler2DArray textures;
+uniform vec4 textureRects[MAX_TEXTURES];	// xy offset, zw scale inside the layer
+uniform int textureLayers[MAX_TEXTURES];
+uniform int texture1;
+uniform int texture2;
 uniform float mixValue;
 
+vec4 sampleTexture(int index, vec2 uv) {
+	vec4 rect = textureRects[index];
+	// Repeat inside the atlas region, gradients come from the unwrapped UVs so the mip level doesn't jump at the seams
+	vec2 atlasUV = rect.xy + fract(uv) * rect.zw;
+	return textureGrad(textures, vec3(atlasUV, textureLayers[index]), dFdx(uv) * rect.zw, dFdy(uv) * rect.zw);
+}
+
  void main() {
 	  //FragColor = vec4(colorOffset, 1.0f);
-	  //FragColor = texture(texture1, TexCoord);
-	  //FragColor = texture(texture1, TexCoord) * vec4(colorOffset, 1.0f);
-	  FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), mixValue);
- }
\ No newline at end of file
+	  //FragColor = sampleTexture(texture1, TexCoord);
+	  //FragColor = sampleTexture(texture1, TexCoord) * vec4(colorOffset, 1.0f);
+	  FragColor = mix(sampleTexture(texture1, TexCoord), sampleTexture(texture2, TexCoord), mixValue);
+ }
@@ -0,0 +1,10 @@
+#version 330 core
+
+// One triangle covering the screen, no vertex buffer: draw 3 vertices with any VAO bound
+out vec2 TexCoords;
+
+void main() {
+	vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+	TexCoords = corner;
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+
+// One jump flood step: keep the nearest seed among this pixel's and those of the 8 pixels stepSize away
+uniform usampler2D seeds;
+uniform int stepSize;
+
+out uvec2 Seed;
+
+void main() {
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	ivec2 limit = textureSize(seeds, 0) - 1;
+	uvec2 best = uvec2(0u);
+	float bestDistance = 1e20;
+	for (int y = -1; y <= 1; y++) {
+		for (int x = -1; x <= 1; x++) {
+			uvec2 seed = texelFetch(seeds, clamp(pixel + ivec2(x, y) * stepSize, ivec2(0), limit), 0).xy;
+			if (seed.x == 0u)
+				continue;
+			vec2 offset = vec2(ivec2(seed) - 1 - pixel);
+			float lengthSquared = dot(offset, offset);
+			if (lengthSquared < bestDistance) {
+				bestDistance = lengthSquared;
+				best = seed;
+			}
+		}
+	}
+	Seed = best;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+uniform sampler2D mask;
+
+out uvec2 Seed;		// Nearest masked pixel + 1, 0 when none is known yet
+
+void main() {
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	Seed = texelFetch(mask, pixel, 0).r > 0.0 ? uvec2(pixel) + 1u : uvec2(0u);
+}
@@ -7,43 +7,67 @@ struct Material {
 	float shininess;
 };
 
-struct Light {
-	vec3 position;
-
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-};
-
 in vec3 FragPos;
 in vec3 Normal;
 
-uniform Material material;
-uniform Light light;
+// Every material, see MaterialRegistry.h. The array size is MATERIAL_BLOCK_SIZE.
+layout (std140) uniform Materials {
+	Material materials[256];
+};
+uniform int materialIndex;
+
+// Every light, 3 texels each (see LightManager.h): position and range (0 for directional),
+// direction and spot scale, color times intensity and spot offset
+uniform samplerBuffer lights;
+uniform int lightCount;
+uniform int lightIndices[8];	// LIGHTS_PER_OBJECT strongest lights reaching this draw
+uniform vec3 ambientColor;
 
 uniform vec3 viewPos;
 
 out vec4 FragColor;
 
 void main() {
-	// ambient
-    vec3 ambient = light.ambient * material.ambient;
-  	
-    // diffuse 
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(light.position - FragPos);
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * (diff * material.diffuse);
-    
-    // specular
-    vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(norm, -lightDir);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 128 * material.shininess);
-    vec3 specular = vec3(0.0);
-    if(diff > 0.0) {
-        specular = light.specular * (spec * material.specular);  
-    }
-        
-    vec3 result = ambient + diffuse + specular;
-    FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+	Material material = materials[materialIndex];
+
+	vec3 norm = normalize(Normal);
+	vec3 viewDir = normalize(viewPos - FragPos);
+	vec3 result = ambientColor * material.ambient;
+
+	for (int i = 0; i < lightCount; i++) {
+		int base = lightIndices[i] * 3;
+		vec4 positionRange = texelFetch(lights, base);
+		vec4 directionScale = texelFetch(lights, base + 1);
+		vec4 colorOffset = texelFetch(lights, base + 2);
+
+		vec3 lightDir = -directionScale.xyz;
+		float attenuation = 1.0;
+		if (positionRange.w > 0.0) {
+			// Inverse square, windowed to reach zero at the range, then the spot cone (1 for point lights)
+			vec3 toLight = positionRange.xyz - FragPos;
+			float distanceSquared = dot(toLight, toLight);
+			lightDir = toLight * inversesqrt(max(distanceSquared, 1e-8));
+			float ratio = distanceSquared / (positionRange.w * positionRange.w);
+			float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+			attenuation = window * window / max(distanceSquared, 1e-4);
+			float cone = clamp(dot(-lightDir, directionScale.xyz) * directionScale.w + colorOffset.w, 0.0, 1.0);
+			attenuation *= cone * cone;
+		}
+		vec3 radiance = colorOffset.rgb * attenuation;
+
+		// diffuse
+		float diff = max(dot(norm, lightDir), 0.0);
+		vec3 diffuse = radiance * (diff * material.diffuse);
+
+		// specular
+		vec3 reflectDir = reflect(norm, -lightDir);
+		float spec = pow(max(dot(viewDir, reflectDir), 0.0), 128 * material.shininess);
+		vec3 specular = vec3(0.0);
+		if(diff > 0.0) {
+			specular = radiance * (spec * material.specular);
+		}
+		result += diffuse + specular;
+	}
+
+	FragColor = vec4(result, 1.0);
+}
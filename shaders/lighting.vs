@@ -1,19 +1,30 @@
 #version 330 core
 
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec3 aNormal;		// xy hold an octahedral normal when octNormals is set
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 tiModel;
+uniform bool octNormals;
 
 out vec3 FragPos;
 out vec3 Normal;
 
+// Inverse of the octahedral mapping in VertexCompression.h
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main() {
+	vec3 normal = octNormals ? octDecode(aNormal.xy) : aNormal;
 	FragPos = vec3(model * vec4(aPos, 1.0));
-	Normal = tiModel * aNormal;  
+	Normal = tiModel * normal;  
 
 	gl_Position = projection * view * vec4(FragPos, 1.0f);
 }
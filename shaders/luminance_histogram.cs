@@ -0,0 +1,35 @@
+#version 430 core
+
+// Bins the log luminance of every EXPOSURE_SAMPLE_STEP-th pixel, see AutoExposure. 16 x 16 invocations, one per bin.
+layout (local_size_x = 16, local_size_y = 16) in;
+
+layout (std430, binding = 0) buffer Histogram {
+	uint bins[256];
+};
+
+uniform sampler2D hdr;
+uniform ivec2 viewSize;
+uniform int sampleStep;
+uniform float minLogLuminance;
+uniform float inverseLogRange;
+
+shared uint localBins[256];
+
+void main() {
+	localBins[gl_LocalInvocationIndex] = 0u;
+	barrier();
+
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy) * sampleStep + sampleStep / 2;
+	if (all(lessThan(pixel, viewSize))) {
+		float luminance = dot(texelFetch(hdr, pixel, 0).rgb, vec3(0.2126, 0.7152, 0.0722));
+		uint bin = 0u;		// Black
+		if (luminance > 1e-5)
+			bin = uint(clamp((log2(luminance) - minLogLuminance) * inverseLogRange, 0.0, 1.0) * 254.0 + 1.0);
+		atomicAdd(localBins[bin], 1u);
+	}
+	barrier();
+
+	uint count = localBins[gl_LocalInvocationIndex];
+	if (count != 0u)
+		atomicAdd(bins[gl_LocalInvocationIndex], count);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+// Log luminance of the HDR scene for the mip chain fallback of AutoExposure
+in vec2 TexCoords;
+
+uniform sampler2D hdr;
+uniform vec2 sourceUVScale;
+uniform float minLogLuminance;
+uniform float maxLogLuminance;
+
+out float LogLuminance;
+
+void main() {
+	float luminance = dot(texture(hdr, TexCoords * sourceUVScale).rgb, vec3(0.2126, 0.7152, 0.0722));
+	LogLuminance = clamp(log2(max(luminance, 1e-5)), minLogLuminance, maxLogLuminance);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+uniform sampler2D mask;
+uniform usampler2D seeds;
+uniform int downscale;		// Screen pixels per mask pixel
+uniform float width;		// Outline width in screen pixels
+uniform vec4 colors[4];		// OUTLINE_COLORS, picked by the ID of the nearest masked object
+
+out vec4 FragColor;
+
+void main() {
+	ivec2 pixel = ivec2(gl_FragCoord.xy) / downscale;
+	uvec2 seed = texelFetch(seeds, pixel, 0).xy;
+	// Outside the selected objects only, and only where the flood found one
+	if (seed.x == 0u || texelFetch(mask, pixel, 0).r > 0.0)
+		discard;
+	vec2 seedCenter = (vec2(ivec2(seed) - 1) + 0.5) * float(downscale);
+	float seedDistance = length(gl_FragCoord.xy - seedCenter);
+	float coverage = clamp(width + 0.5 - seedDistance, 0.0, 1.0);
+	if (coverage <= 0.0)
+		discard;
+	int id = int(texelFetch(mask, ivec2(seed) - 1, 0).r * 255.0 + 0.5);
+	vec4 color = colors[id % 4];
+	FragColor = vec4(color.rgb, color.a * coverage);
+}
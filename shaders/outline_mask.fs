@@ -0,0 +1,9 @@
+#version 330 core
+
+uniform int objectId;		// 1 - 255, 0 is the cleared background
+
+out float MaskId;
+
+void main() {
+	MaskId = float(objectId) / 255.0;
+}
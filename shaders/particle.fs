@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec2 Corner;
+in vec4 Color;
+
+out vec4 FragColor;
+
+void main() {
+	// Round soft sprite, fading out towards the edge of the quad
+	float falloff = max(1.0 - dot(Corner, Corner), 0.0);
+	FragColor = vec4(Color.rgb, Color.a * falloff * falloff);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+
+layout (location = 0) in vec2 aCorner;		// Quad corner in [-0.5, 0.5]
+layout (location = 1) in vec4 aCenter;		// xyz world position, w size (0 for a dead particle)
+layout (location = 2) in vec4 aColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec2 Corner;
+out vec4 Color;
+
+void main() {
+	// Camera right and up are the first two rows of the view matrix's rotation
+	vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+	vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+	vec3 position = aCenter.xyz + (right * aCorner.x + up * aCorner.y) * aCenter.w;
+	Corner = aCorner * 2.0;
+	Color = aColor;
+
+	gl_Position = projection * view * vec4(position, 1.0);
+}
@@ -0,0 +1,50 @@
+#version 430 core
+
+// ParticleSystem::updateRange on the GPU, one invocation per particle slot
+layout (local_size_x = 256) in;
+
+struct Particle {
+	vec4 positionAge;
+	vec4 velocityInvLife;
+};
+
+layout (std430, binding = 0) buffer State {
+	Particle particles[];
+};
+
+// ParticleInstance records, 5 words each: center, size, RGBA8 color
+layout (std430, binding = 1) writeonly buffer Instances {
+	uint instances[];
+};
+
+uniform int count;
+uniform float dt;
+uniform float damping;
+uniform vec3 gravityStep;
+uniform float sizeStart;
+uniform float sizeDelta;
+uniform vec4 colorCurve[32];		// PARTICLE_CURVE_SIZE
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= uint(count))
+		return;
+
+	Particle p = particles[i];
+	vec3 velocity = p.velocityInvLife.xyz * damping + gravityStep;
+	vec3 position = p.positionAge.xyz + velocity * dt;
+	float age = p.positionAge.w + dt;
+	particles[i].positionAge = vec4(position, age);
+	particles[i].velocityInvLife.xyz = velocity;
+
+	float t = age * p.velocityInvLife.w;
+	float size = t < 1.0 ? sizeStart + sizeDelta * t : 0.0;
+	vec4 color = colorCurve[int(clamp(t * 31.0, 0.0, 31.0))];
+
+	uint base = i * 5u;
+	instances[base + 0u] = floatBitsToUint(position.x);
+	instances[base + 1u] = floatBitsToUint(position.y);
+	instances[base + 2u] = floatBitsToUint(position.z);
+	instances[base + 3u] = floatBitsToUint(size);
+	instances[base + 4u] = packUnorm4x8(color);
+}
@@ -0,0 +1,11 @@
+// Saturation and contrast around mid grey, then a tint. POST_PIXEL pass, see PostChain.
+uniform float gradeSaturation = 1.1;
+uniform float gradeContrast = 1.05;
+uniform vec3 gradeTint = vec3(1.0, 0.98, 0.95);
+
+vec4 colorGrade(vec4 color, vec2 uv) {
+	float luma = dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));
+	vec3 graded = mix(vec3(luma), color.rgb, gradeSaturation);
+	graded = (graded - 0.5) * gradeContrast + 0.5;
+	return vec4(max(graded * gradeTint, 0.0), color.a);
+}
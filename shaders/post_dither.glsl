@@ -0,0 +1,7 @@
+// Up to half an 8 bit step of noise so gradients don't band, animated by frame. POST_PIXEL pass, see PostChain.
+vec4 dither(vec4 color, vec2 uv) {
+	// Interleaved gradient noise (Jimenez 2014)
+	vec2 pixel = gl_FragCoord.xy + float(frame % 64) * vec2(5.588238, 5.588238);
+	float noise = fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+	return vec4(color.rgb + (noise - 0.5) / 255.0, color.a);
+}
@@ -0,0 +1,10 @@
+// Applies the exposure AutoExposure left in exposureTexture, then the ACES filmic curve (Narkowicz's fit) and
+// the display gamma. POST_PIXEL pass, see PostChain. Must come first, later passes work on display values.
+uniform sampler2D exposureTexture;
+uniform float exposureCompensation = 0.0;	// In stops
+
+vec4 tonemap(vec4 color, vec2 uv) {
+	vec3 x = color.rgb * texelFetch(exposureTexture, ivec2(0), 0).r * exp2(exposureCompensation);
+	vec3 mapped = clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+	return vec4(pow(mapped, vec3(1.0 / 2.2)), color.a);
+}
@@ -0,0 +1,34 @@
+// Bilinear upscale of the dynamic resolution sub-rect with contrast adaptive sharpening (after AMD's CAS) to win back
+// the detail lost. Neighbours are weighed in a reversible tonemapped space so HDR highlights don't ring.
+// POST_SAMPLE pass, see PostChain.
+uniform float sharpness = 0.0;		// 0 off, 1 strongest, DynamicResolution raises it as the scale drops
+
+vec3 casCompress(vec3 color) {
+	return color / (1.0 + max(color.r, max(color.g, color.b)));
+}
+
+vec3 casExpand(vec3 color) {
+	return color / max(1.0 - max(color.r, max(color.g, color.b)), 1e-4);
+}
+
+vec4 upscale(vec2 uv) {
+	// Stay half a texel inside the sub-rect, outside it is whatever a larger scale left behind
+	vec2 sourceUV = clamp(uv * sourceUVScale, texelSize * 0.5, sourceUVScale - texelSize * 0.5);
+	vec4 center = texture(source, sourceUV);
+	if (sharpness <= 0.0)
+		return center;
+
+	vec3 c = casCompress(center.rgb);
+	vec3 n = casCompress(texture(source, sourceUV + vec2(0.0, texelSize.y)).rgb);
+	vec3 s = casCompress(texture(source, sourceUV - vec2(0.0, texelSize.y)).rgb);
+	vec3 e = casCompress(texture(source, sourceUV + vec2(texelSize.x, 0.0)).rgb);
+	vec3 w = casCompress(texture(source, sourceUV - vec2(texelSize.x, 0.0)).rgb);
+	vec3 lowest = min(c, min(min(n, s), min(e, w)));
+	vec3 highest = max(c, max(max(n, s), max(e, w)));
+
+	// Less sharpening where the neighbourhood already spans the whole range
+	vec3 amount = sqrt(clamp(min(lowest, 1.0 - highest) / max(highest, 1e-4), 0.0, 1.0));
+	vec3 weight = -amount * mix(0.125, 0.2, sharpness);
+	vec3 sharpened = clamp((c + (n + s + e + w) * weight) / (1.0 + 4.0 * weight), 0.0, 0.999);
+	return vec4(casExpand(sharpened), center.a);
+}
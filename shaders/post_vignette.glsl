@@ -0,0 +1,9 @@
+// Darkens towards the corners. POST_PIXEL pass, see PostChain.
+uniform float vignetteStrength = 0.35;
+uniform float vignetteRadius = 0.75;
+
+vec4 vignette(vec4 color, vec2 uv) {
+	float edge = length(uv - 0.5) * 1.41421356;
+	float shade = 1.0 - vignetteStrength * smoothstep(vignetteRadius, 1.0 + vignetteRadius * 0.25, edge);
+	return vec4(color.rgb * shade, color.a);
+}
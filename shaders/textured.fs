@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec3 ourColor;
+in vec3 colorOffset;
+in vec2 TexCoord;
+
+// A single GL_TEXTURE_2D, for the textures that don't live in the array (the gallery quads in main.cpp)
+uniform sampler2D image;
+
+void main() {
+	FragColor = texture(image, TexCoord);
+}
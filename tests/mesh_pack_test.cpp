@@ -0,0 +1,102 @@
+// MeshPack checks: a cooked pack must open, and a pack whose header or entry was corrupted (attribute count, LOD
+// count and ranges, index type, blob sizes and offsets) or that was truncated must be rejected at open.
+
+#include "../headers/MeshPack.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Two triangles and two LODs, enough for every field to be meaningful
+static bool writePack(const char* path)
+{
+	Mesh mesh;
+	const float quad[] = { 0, 0, 0, 0, 0, 1, 0, 0,  1, 0, 0, 0, 0, 1, 1, 0,  1, 1, 0, 0, 0, 1, 1, 1,  0, 1, 0, 0, 0, 1, 0, 1 };
+	mesh.vertices.assign(quad, quad + sizeof(quad) / sizeof(*quad));
+	mesh.computeBounds();
+	std::vector<std::vector<unsigned int>> lods = { { 0, 1, 2, 0, 2, 3 }, { 0, 1, 2 } };
+	std::vector<float> errors = { 0.0f, 0.5f };
+	MeshPackWriter writer;
+	return writer.open(path) && writer.add("quad.obj", mesh, meshDefaultLayout(), mesh.vertices.data(), lods, errors) && writer.finish();
+}
+
+static std::vector<unsigned char> readFile(const char* path)
+{
+	std::vector<unsigned char> bytes;
+	FILE* in = fopen(path, "rb");
+	if (!in)
+		return bytes;
+	unsigned char chunk[4096];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0)
+		bytes.insert(bytes.end(), chunk, chunk + read);
+	fclose(in);
+	return bytes;
+}
+
+static bool opens(const char* path, const std::vector<unsigned char>& bytes)
+{
+	FILE* out = fopen(path, "wb");
+	if (!out)
+		return false;
+	fwrite(bytes.data(), 1, bytes.size(), out);
+	fclose(out);
+	MeshPack pack;
+	return pack.open(path) && pack.size() == 1;
+}
+
+// Overwrite one field of the entry with value
+template <typename T>
+static std::vector<unsigned char> patched(std::vector<unsigned char> bytes, size_t fieldOffset, T value)
+{
+	MeshPackHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	memcpy(&bytes[(size_t)header.indexOffset + fieldOffset], &value, sizeof(T));
+	return bytes;
+}
+
+int main()
+{
+	const char* path = "mesh_pack_test.pack";
+	if (!writePack(path)) {
+		printf("FAIL: can't write %s\n", path);
+		return 1;
+	}
+	std::vector<unsigned char> good = readFile(path);
+	int failures = 0;
+	if (!opens(path, good)) {
+		printf("FAIL: cooked pack rejected\n");
+		failures++;
+	}
+
+	struct Corruption {
+		const char* what;
+		std::vector<unsigned char> bytes;
+	};
+	const size_t layout = offsetof(MeshPackEntry, layout);
+	std::vector<Corruption> corruptions = {
+		{ "truncated", std::vector<unsigned char>(good.begin(), good.begin() + good.size() / 2) },
+		{ "attribCount", patched(good, layout + offsetof(VertexLayout, attribCount), (uint32_t)(MESH_MAX_ATTRIBS + 1)) },
+		{ "attrib offset", patched(good, layout + offsetof(VertexLayout, attribs) + offsetof(VertexAttrib, offset), (uint32_t)30) },
+		{ "attrib type", patched(good, layout + offsetof(VertexLayout, attribs) + offsetof(VertexAttrib, type), (uint32_t)0x1234) },
+		{ "lodCount 0", patched(good, offsetof(MeshPackEntry, lodCount), (uint32_t)0) },
+		{ "lodCount", patched(good, offsetof(MeshPackEntry, lodCount), (uint32_t)(MESHPACK_MAX_LODS + 1)) },
+		{ "LOD range", patched(good, offsetof(MeshPackEntry, lods) + sizeof(MeshPackLod) + offsetof(MeshPackLod, firstIndex), (uint32_t)7) },
+		{ "indexType", patched(good, offsetof(MeshPackEntry, indexType), (uint32_t)MESH_FLOAT) },
+		{ "vertexCount", patched(good, offsetof(MeshPackEntry, vertexCount), (uint32_t)5) },
+		{ "indexCount", patched(good, offsetof(MeshPackEntry, indexCount), (uint32_t)100) },
+		{ "vertexOffset", patched(good, offsetof(MeshPackEntry, vertexOffset), (uint64_t)good.size()) },
+		{ "indexSize overflow", patched(good, offsetof(MeshPackEntry, indexSize), ~(uint64_t)0) },
+	};
+	for (const Corruption& c : corruptions) {
+		bool rejected = !opens(path, c.bytes);
+		printf("%s: %s\n", c.what, rejected ? "rejected" : "accepted");
+		if (!rejected) {
+			printf("FAIL: corrupt %s accepted\n", c.what);
+			failures++;
+		}
+	}
+	remove(path);
+	return failures == 0 ? 0 : 1;
+}
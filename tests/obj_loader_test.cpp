@@ -0,0 +1,164 @@
+// ObjLoader checks: a file whose faces use relative (negative) indices must load the same triangles whatever
+// the thread count, including faces whose vertices were parsed by an earlier chunk, and every corner must resolve
+// to the position, uv and normal it names.
+
+#include "../headers/ObjLoader.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+// A triangle strip where every face points back at the last three vertices, in a file large enough to split
+// into many chunks. Vertices are written in runs so faces also reach back over whole runs of other faces.
+static bool writeRelativeObj(const char* path, int triangles)
+{
+	FILE* out = fopen(path, "wb");
+	if (!out)
+		return false;
+	fprintf(out, "v 0 0 0\nv 1 0 0\n");
+	for (int i = 0; i < triangles; i += 4) {
+		int run = std::min(4, triangles - i);
+		for (int k = 0; k < run; k++)
+			fprintf(out, "v %d %d 0\n", (i + k + 2) / 2, (i + k) % 2 + 1);
+		for (int k = 0; k < run; k++)
+			fprintf(out, "f %d %d %d\n", k - run - 2, k - run - 1, k - run);
+	}
+	fclose(out);
+	return true;
+}
+
+// Vertex i (1 based) of the attribute fixture, every stream distinct so a corner resolved against the wrong one shows
+static void fixturePosition(int i, float* p) { p[0] = (float)i; p[1] = i + 0.5f; p[2] = (float)-i; }
+static void fixtureUv(int i, float* uv) { uv[0] = i * 0.125f; uv[1] = 1.0f - i * 0.0625f; }
+static void fixtureNormal(int i, float* n) { n[0] = 0.25f * i; n[1] = 1.0f; n[2] = -0.5f * i; }
+
+struct FixtureCorner {
+	int v, vt, vn;	// Absolute, 1 based
+	bool relative;	// Written as a negative index
+};
+
+const int FIXTURE_VERTICES = 10;
+const int FIXTURE_FIRST_CHUNK = 8;	// Vertices written before the padding, the rest right before the faces
+
+// Triangles only, so face t is output triangle t. Most corners reach back over the padding into the first chunk,
+// the first face mixes those with local and absolute ones.
+static const FixtureCorner fixtureFaces[][3] = {
+	{ { 10, 10, 10, true }, { 9, 9, 9, true }, { 1, 1, 1, true } },
+	{ { 6, 6, 6, true }, { 5, 5, 5, true }, { 4, 4, 4, true } },
+	{ { 8, 7, 6, true }, { 3, 4, 5, true }, { 2, 3, 4, false } },
+	{ { 1, 2, 3, true }, { 2, 3, 1, true }, { 3, 1, 2, true } },
+};
+const int FIXTURE_FACES = sizeof(fixtureFaces) / sizeof(*fixtureFaces);
+
+static void writeFixtureVertex(FILE* out, int i)
+{
+	float p[3], uv[2], n[3];
+	fixturePosition(i, p);
+	fixtureUv(i, uv);
+	fixtureNormal(i, n);
+	fprintf(out, "v %g %g %g\nvt %g %g\nvn %g %g %g\n", p[0], p[1], p[2], uv[0], uv[1], n[0], n[1], n[2]);
+}
+
+// Comment padding between the first vertices and the faces makes the file several 64 KB chunks long, so even one
+// thread parses the vertices and the faces that reach back to them in different chunks
+static bool writeAttributeObj(const char* path)
+{
+	FILE* out = fopen(path, "wb");
+	if (!out)
+		return false;
+	for (int i = 1; i <= FIXTURE_FIRST_CHUNK; i++)
+		writeFixtureVertex(out, i);
+	for (int line = 0; line < 4096; line++)
+		fprintf(out, "# padding line %04d that pushes the faces a few chunks past the vertices they use\n", line);
+	for (int i = FIXTURE_FIRST_CHUNK + 1; i <= FIXTURE_VERTICES; i++)
+		writeFixtureVertex(out, i);
+	for (int f = 0; f < FIXTURE_FACES; f++) {
+		fprintf(out, "f");
+		for (const FixtureCorner& c : fixtureFaces[f]) {
+			int back = c.relative ? FIXTURE_VERTICES + 1 : 0;
+			fprintf(out, " %d/%d/%d", c.v - back, c.vt - back, c.vn - back);
+		}
+		fprintf(out, "\n");
+	}
+	fclose(out);
+	return true;
+}
+
+static bool near(const float* a, const float* b, int n)
+{
+	for (int i = 0; i < n; i++) {
+		if (std::fabs(a[i] - b[i]) > 1e-5f)
+			return false;
+	}
+	return true;
+}
+
+// Every corner of every face must come back with the attributes it names
+static int checkAttributes(const char* path, int threads)
+{
+	Mesh mesh;
+	if (!loadObj(path, mesh, NULL, threads)) {
+		printf("FAIL: attributes, %d threads: load failed\n", threads);
+		return 1;
+	}
+	if (mesh.indices.size() != (size_t)FIXTURE_FACES * 3) {
+		printf("FAIL: attributes, %d threads: %zu triangles, expected %d\n", threads, mesh.indices.size() / 3, FIXTURE_FACES);
+		return 1;
+	}
+	int failures = 0;
+	for (int f = 0; f < FIXTURE_FACES; f++) {
+		for (int k = 0; k < 3; k++) {
+			const FixtureCorner& c = fixtureFaces[f][k];
+			const float* vertex = &mesh.vertices[(size_t)mesh.indices[f * 3 + k] * MESH_VERTEX_LEN];
+			float p[3], n[3], uv[2];
+			fixturePosition(c.v, p);
+			fixtureNormal(c.vn, n);
+			fixtureUv(c.vt, uv);
+			if (!near(vertex, p, 3) || !near(vertex + 3, n, 3) || !near(vertex + 6, uv, 2)) {
+				printf("FAIL: attributes, %d threads: face %d corner %d should be v %d, vt %d, vn %d\n", threads, f, k, c.v, c.vt, c.vn);
+				failures++;
+			}
+		}
+	}
+	if (failures == 0)
+		printf("%d threads: every corner resolved to its attributes\n", threads);
+	return failures;
+}
+
+int main()
+{
+	const char* path = "obj_loader_test_relative.obj";
+	const int triangles = 40000;
+	if (!writeRelativeObj(path, triangles)) {
+		printf("FAIL: can't write %s\n", path);
+		return 1;
+	}
+
+	int failures = 0;
+	const int threadCounts[] = { 1, 2, 8 };
+	for (int threads : threadCounts) {
+		Mesh mesh;
+		if (!loadObj(path, mesh, NULL, threads)) {
+			printf("FAIL: %d threads: load failed\n", threads);
+			failures++;
+			continue;
+		}
+		size_t loaded = mesh.indices.size() / 3;
+		printf("%d threads: %zu triangles\n", threads, loaded);
+		if (loaded != (size_t)triangles) {
+			printf("FAIL: %d threads: expected %d triangles\n", threads, triangles);
+			failures++;
+		}
+	}
+	remove(path);
+
+	const char* attributePath = "obj_loader_test_attributes.obj";
+	if (!writeAttributeObj(attributePath)) {
+		printf("FAIL: can't write %s\n", attributePath);
+		return 1;
+	}
+	for (int threads : threadCounts)
+		failures += checkAttributes(attributePath, threads);
+	remove(attributePath);
+	return failures == 0 ? 0 : 1;
+}
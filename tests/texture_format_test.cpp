@@ -0,0 +1,70 @@
+// Texture format checks: the grey test images must sample as (grey, grey, grey, alpha) once uploaded in the format
+// textureFormatForChannels picks and read through its swizzle, and colour images must sample unchanged.
+//
+// Usage: texture_format_test <rsc/imgs directory>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../headers/stb_image.h"
+#include "../headers/TextureUploader.h"
+
+#include <cstdio>
+#include <string>
+
+// What the GPU stores for one texel of a format: missing colour channels read 0, missing alpha 1
+static void storedTexel(const TextureFormat& format, const unsigned char* in, int channels, int out[4])
+{
+	int stored = format.format == GL_RED ? 1 : format.format == GL_RG ? 2 : format.format == GL_RGB ? 3 : 4;
+	for (int c = 0; c < 4; c++)
+		out[c] = c < stored && c < channels ? in[c] : (c == 3 ? 255 : 0);
+}
+
+// What a shader's texture() returns for that texel after the swizzle
+static int swizzled(GLint source, const int stored[4])
+{
+	switch (source) {
+	case GL_RED: return stored[0];
+	case GL_GREEN: return stored[1];
+	case GL_BLUE: return stored[2];
+	case GL_ALPHA: return stored[3];
+	case GL_ONE: return 255;
+	default: return 0;
+	}
+}
+
+static bool check(const std::string& path, int expectedChannels)
+{
+	int width, height, channels;
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+	if (!data) {
+		printf("FAIL: can't load %s\n", path.c_str());
+		return false;
+	}
+	bool ok = channels == expectedChannels;
+	TextureFormat format = textureFormatForChannels(channels);
+	for (int i = 0; ok && i < width * height; i++) {
+		const unsigned char* in = data + (size_t)i * channels;
+		int stored[4], sampled[4], expected[4];
+		storedTexel(format, in, channels, stored);
+		for (int c = 0; c < 4; c++)
+			sampled[c] = swizzled(format.swizzle[c], stored);
+		bool grey = channels < 3;
+		for (int c = 0; c < 3; c++)
+			expected[c] = grey ? in[0] : in[c];
+		expected[3] = channels == 2 || channels == 4 ? in[channels - 1] : 255;
+		for (int c = 0; c < 4; c++)
+			ok = ok && sampled[c] == expected[c];
+	}
+	stbi_image_free(data);
+	printf("%s: %d channels, %s\n", path.c_str(), channels, ok ? "samples as expected" : "wrong colour");
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir = argc > 1 ? argv[1] : "rsc/imgs";
+	int failures = 0;
+	failures += !check(dir + "/grey.png", 1);
+	failures += !check(dir + "/grey_alpha.png", 2);
+	failures += !check(dir + "/image.png", 3);
+	return failures == 0 ? 0 : 1;
+}
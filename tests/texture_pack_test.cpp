@@ -0,0 +1,113 @@
+// TexturePack checks: a pack cooked in every format texcook writes (raw, BC1, BC3, BC7) must open and hand back
+// exactly the mip data that went in, and a pack with a corrupt entry must be rejected at open.
+
+#include "../headers/MipGenerator.h"
+#include "../headers/TexturePack.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Odd sized so the last block row and column are partial
+static std::vector<unsigned char> testImage(int width, int height, int channels)
+{
+	std::vector<unsigned char> pixels((size_t)width * height * channels);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			for (int c = 0; c < channels; c++)
+				pixels[((size_t)y * width + x) * channels + c] = (unsigned char)(x * 7 + y * 13 + c * 61);
+		}
+	}
+	return pixels;
+}
+
+// Cook one texture the way texcook does, returns the levels written
+static bool writePack(const char* path, BCFormat format, int width, int height, int channels, std::vector<std::vector<unsigned char>>& levels)
+{
+	std::vector<unsigned char> pixels = testImage(width, height, channels);
+	std::vector<MipLevel> chain = generateMipChain(pixels.data(), width, height, channels, TEXPACK_MAX_MIPS);
+	levels.clear();
+	for (MipLevel& mip : chain) {
+		if (format == BC_NONE) {
+			levels.push_back(mip.pixels);
+			continue;
+		}
+		levels.emplace_back(bcCompressedSize(format, mip.width, mip.height));
+		bcCompress(mip.pixels.data(), mip.width, mip.height, channels, format, BC_QUALITY_FAST, levels.back().data());
+	}
+	TexturePackWriter writer;
+	return writer.open(path) && writer.add("test.png", width, height, channels, format, levels) && writer.finish();
+}
+
+static bool sameLevels(const TexturePack& pack, const TexturePackEntry& entry, const std::vector<std::vector<unsigned char>>& levels)
+{
+	if (entry.mipCount != levels.size())
+		return false;
+	for (uint32_t level = 0; level < entry.mipCount; level++) {
+		const TexturePackMip& mip = entry.mips[level];
+		const unsigned char* data = pack.mipData(entry, level);
+		if (entry.format != BC_NONE) {
+			if (mip.size != levels[level].size() || memcmp(data, levels[level].data(), levels[level].size()) != 0)
+				return false;
+			continue;
+		}
+		size_t row = (size_t)mip.width * entry.channels;
+		for (uint32_t y = 0; y < mip.height; y++) {
+			if (memcmp(data + (size_t)y * mip.rowPitch, &levels[level][y * row], row) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const char* path = "texture_pack_test.pack";
+	const BCFormat formats[] = { BC_NONE, BC1, BC3, BC7 };
+	const char* names[] = { "raw", "bc1", "bc3", "bc7" };
+	int failures = 0;
+
+	for (int f = 0; f < 4; f++) {
+		std::vector<std::vector<unsigned char>> levels;
+		int channels = formats[f] == BC1 ? 3 : 4;
+		if (!writePack(path, formats[f], 37, 21, channels, levels)) {
+			printf("FAIL: %s: can't write %s\n", names[f], path);
+			failures++;
+			continue;
+		}
+		TexturePack pack;
+		const TexturePackEntry* entry = pack.open(path) ? pack.find("test.png") : NULL;
+		if (entry == NULL || pack.size() != 1) {
+			printf("FAIL: %s: pack rejected\n", names[f]);
+			failures++;
+			continue;
+		}
+		bool ok = entry->format == (uint32_t)formats[f] && entry->width == 37 && entry->height == 21 && sameLevels(pack, *entry, levels);
+		printf("%s: %u mips, %s\n", names[f], entry->mipCount, ok ? "round trip ok" : "data differs");
+		if (!ok)
+			failures++;
+	}
+
+	// An unknown format in the index must fail the open, not reach an upload
+	std::vector<std::vector<unsigned char>> levels;
+	if (writePack(path, BC7, 8, 8, 4, levels)) {
+		FILE* file = fopen(path, "r+b");
+		TexturePackHeader header = {};
+		uint32_t badFormat = 5;
+		bool patched = file && fread(&header, sizeof(header), 1, file) == 1 &&
+			fseek(file, (long)(header.indexOffset + offsetof(TexturePackEntry, format)), SEEK_SET) == 0 &&
+			fwrite(&badFormat, sizeof(badFormat), 1, file) == 1;
+		if (file)
+			fclose(file);
+		TexturePack pack;
+		if (!patched || pack.open(path)) {
+			printf("FAIL: corrupt format accepted\n");
+			failures++;
+		}
+		else
+			printf("corrupt format: rejected\n");
+	}
+	remove(path);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+// Block compression benchmark: encodes each image with every format / quality level and reports
+// encoder throughput in MPix/s and PSNR of the decoded result against the stbi_load source.
+//
+// Usage: bcbench [threads = all] [images... = rsc/imgs/image.png rsc/imgs/pattern.jpg]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../headers/stb_image.h"
+#include "../headers/BlockCompress.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// PSNR over the channels the source actually has, alpha only counts for 2 / 4 channel images
+static double psnr(const unsigned char* source, int channels, const unsigned char* rgba, int pixelCount)
+{
+	double sum = 0.0;
+	int compared = channels >= 3 ? 3 : 1;
+	bool alpha = channels == 2 || channels == 4;
+	for (int i = 0; i < pixelCount; i++) {
+		const unsigned char* s = source + (size_t)i * channels;
+		const unsigned char* d = rgba + (size_t)i * 4;
+		for (int c = 0; c < compared; c++) {
+			double diff = (double)s[c] - d[c];
+			sum += diff * diff;
+		}
+		if (alpha) {
+			double diff = (double)s[channels - 1] - d[3];
+			sum += diff * diff;
+		}
+	}
+	double mse = sum / ((double)pixelCount * (compared + (alpha ? 1 : 0)));
+	return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+int main(int argc, char** argv)
+{
+	int threads = argc > 1 ? atoi(argv[1]) : 0;
+	std::vector<std::string> paths;
+	for (int i = 2; i < argc; i++)
+		paths.push_back(argv[i]);
+	if (paths.empty())
+		paths = { "rsc/imgs/image.png", "rsc/imgs/pattern.jpg" };
+
+	const BCFormat formats[] = { BC1, BC3, BC7 };
+	const char* qualityNames[] = { "fast", "normal", "high" };
+
+	printf("threads: %d\n", threads > 0 ? threads : defaultThreadCount());
+	printf("%-28s %-5s %-7s %10s %10s\n", "image", "fmt", "quality", "MPix/s", "PSNR dB");
+	for (const std::string& path : paths) {
+		int width, height, channels;
+		unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+		if (!pixels) {
+			printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+			continue;
+		}
+
+		std::vector<unsigned char> blocks;
+		std::vector<unsigned char> decoded((size_t)width * height * 4);
+		for (BCFormat format : formats) {
+			blocks.resize(bcCompressedSize(format, width, height));
+			for (int q = BC_QUALITY_FAST; q <= BC_QUALITY_HIGH; q++) {
+				// Repeat until the measurement covers at least a quarter second
+				int runs = 0;
+				double seconds = 0.0;
+				auto start = std::chrono::steady_clock::now();
+				do {
+					bcCompress(pixels, width, height, channels, format, (BCQuality)q, blocks.data(), threads);
+					runs++;
+					seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				} while (seconds < 0.25);
+
+				bcDecompress(blocks.data(), width, height, format, decoded.data());
+				double mpixPerSecond = (double)width * height * runs / seconds / 1e6;
+				printf("%-28s BC%-3d %-7s %10.2f %10.2f\n", path.c_str(), (int)format, qualityNames[q], mpixPerSecond,
+					psnr(pixels, channels, decoded.data(), width * height));
+			}
+		}
+		stbi_image_free(pixels);
+	}
+	return 0;
+}
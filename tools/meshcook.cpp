@@ -0,0 +1,186 @@
+// Offline mesh cooker: parses every OBJ under a directory once, builds LODs and writes the GPU ready
+// vertex and index blobs into a pack file that the renderer maps and uploads without any parsing.
+//
+// Usage: meshcook [--lods n] [--compress] [--positions unorm16|half|float] [input dir = rsc/models] [output = rsc/meshes.pack]
+//   --lods caps the number of levels, including the full mesh (default 4, at most MESHPACK_MAX_LODS)
+//   --compress stores 16 byte vertices (quantized positions, octahedral normals, half UVs) and reports the error
+
+#include "../headers/MeshPack.h"
+#include "../headers/ObjLoader.h"
+#include "../headers/VertexCompression.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static bool isMesh(const fs::path& path)
+{
+	std::string ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".obj";
+}
+
+// Vertex clustering: snap vertices to a grid of `cells` along the longest axis, each occupied cell keeps the vertex
+// closest to the average of its members, and triangles that collapse are dropped. The LOD keeps indexing the full
+// vertex buffer, so no vertex data is duplicated. Returns the worst case deviation (the cell diagonal).
+static float simplifyClustered(const Mesh& mesh, int cells, std::vector<unsigned int>& out)
+{
+	float extent = 0.0f;
+	for (int c = 0; c < 3; c++)
+		extent = std::max(extent, mesh.boundsMax[c] - mesh.boundsMin[c]);
+	float cellSize = extent > 0.0f ? extent / cells : 1.0f;
+
+	size_t vertexCount = mesh.vertexCount();
+	std::vector<uint64_t> cellOf(vertexCount);
+	std::unordered_map<uint64_t, size_t> cellIndex;
+	std::vector<float> sums;	// xyz sum and count per cell
+	for (size_t i = 0; i < vertexCount; i++) {
+		const float* p = &mesh.vertices[i * MESH_VERTEX_LEN];
+		uint64_t key = 0;
+		for (int c = 0; c < 3; c++)
+			key = (key << 21) | (uint64_t)std::min((int)((p[c] - mesh.boundsMin[c]) / cellSize), cells);
+		auto it = cellIndex.emplace(key, sums.size() / 4);
+		if (it.second)
+			sums.insert(sums.end(), 4, 0.0f);
+		size_t cell = it.first->second;
+		cellOf[i] = cell;
+		for (int c = 0; c < 3; c++)
+			sums[cell * 4 + c] += p[c];
+		sums[cell * 4 + 3] += 1.0f;
+	}
+
+	std::vector<unsigned int> representative(sums.size() / 4, 0);
+	std::vector<float> bestDistance(sums.size() / 4, 1e30f);
+	for (size_t i = 0; i < vertexCount; i++) {
+		size_t cell = cellOf[i];
+		const float* p = &mesh.vertices[i * MESH_VERTEX_LEN];
+		float d = 0.0f;
+		for (int c = 0; c < 3; c++) {
+			float delta = p[c] - sums[cell * 4 + c] / sums[cell * 4 + 3];
+			d += delta * delta;
+		}
+		if (d < bestDistance[cell]) {
+			bestDistance[cell] = d;
+			representative[cell] = (unsigned int)i;
+		}
+	}
+
+	out.clear();
+	for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+		unsigned int a = representative[cellOf[mesh.indices[t]]];
+		unsigned int b = representative[cellOf[mesh.indices[t + 1]]];
+		unsigned int c = representative[cellOf[mesh.indices[t + 2]]];
+		if (a == b || b == c || a == c)
+			continue;
+		out.push_back(a);
+		out.push_back(b);
+		out.push_back(c);
+	}
+	return cellSize * std::sqrt(3.0f);
+}
+
+int main(int argc, char** argv)
+{
+	std::string inputDir = "rsc/models";
+	std::string outputPath = "rsc/meshes.pack";
+	int maxLods = 4;
+	bool compress = false;
+	VertexFormat format;
+
+	int positional = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+			maxLods = std::min(std::max(atoi(argv[++i]), 1), MESHPACK_MAX_LODS);
+		else if (strcmp(argv[i], "--compress") == 0)
+			compress = true;
+		else if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc) {
+			std::string p = argv[++i];
+			format.position = p == "float" ? VERTEX_POSITION_FLOAT : (p == "half" ? VERTEX_POSITION_HALF : VERTEX_POSITION_UNORM16);
+		}
+		else if (positional == 0) {
+			inputDir = argv[i];
+			positional++;
+		}
+		else
+			outputPath = argv[i];
+	}
+
+	if (!fs::is_directory(inputDir)) {
+		std::cout << "Input directory not found: " << inputDir << std::endl;
+		return 1;
+	}
+
+	// Sort so the pack is byte-identical between runs
+	std::vector<fs::path> meshes;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(inputDir)) {
+		if (entry.is_regular_file() && isMesh(entry.path()))
+			meshes.push_back(entry.path());
+	}
+	std::sort(meshes.begin(), meshes.end());
+
+	MeshPackWriter writer;
+	if (!writer.open(outputPath.c_str())) {
+		std::cout << "Failed to open output: " << outputPath << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	int cooked = 0;
+	for (const fs::path& path : meshes) {
+		// Key meshes by the same path the renderer would load them from
+		std::string name = (fs::path(inputDir) / fs::relative(path, inputDir)).generic_string();
+
+		Mesh mesh;
+		if (!loadObj(path.string().c_str(), mesh) || mesh.indices.empty()) {
+			std::cout << "Skipping " << name << ": no triangles" << std::endl;
+			continue;
+		}
+
+		// Halve the grid per level until the reduction stalls or the mesh gets tiny
+		std::vector<std::vector<unsigned int>> lods(1, mesh.indices);
+		std::vector<float> errors(1, 0.0f);
+		for (int cells = 128; (int)lods.size() < maxLods && cells >= 4; cells /= 2) {
+			std::vector<unsigned int> lod;
+			float error = simplifyClustered(mesh, cells, lod);
+			if (lod.size() < 3 * 12)
+				break;
+			if (lod.size() > lods.back().size() * 3 / 4)
+				continue;	// Grid still finer than the mesh, try a coarser one
+			lods.push_back(std::move(lod));
+			errors.push_back(error);
+		}
+
+		VertexLayout layout = meshDefaultLayout();
+		std::vector<unsigned char> packed;
+		if (compress) {
+			layout = encodeVertices(mesh, format, packed);
+			measureVertexError(mesh, layout, packed).print(name.c_str());
+		}
+		const void* vertices = compress ? (const void*)packed.data() : (const void*)mesh.vertices.data();
+		if (!writer.add(name.c_str(), mesh, layout, vertices, lods, errors)) {
+			std::cout << "Skipping " << name << ": name too long" << std::endl;
+			continue;
+		}
+		std::cout << name << " " << mesh.vertexCount() << " vertices, LOD triangles";
+		for (const std::vector<unsigned int>& lod : lods)
+			std::cout << " " << lod.size() / 3;
+		std::cout << std::endl;
+		cooked++;
+	}
+
+	if (!writer.finish()) {
+		std::cout << "Failed to write " << outputPath << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Cooked " << cooked << " meshes into " << outputPath << " (" << writer.bytesWritten() << " bytes) in " << seconds << " s" << std::endl;
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Offline texture cooker: decodes every image under a directory once, builds the full mip chain
+// and writes everything into a pack file that the renderer maps and uploads without decoding.
+//
+// Usage: texcook [--format raw|auto|bc1|bc3|bc7] [--quality fast|normal|high] [--filter box|kaiser|lanczos] [--linear]
+//                [input dir = rsc/imgs] [output = rsc/textures.pack]
+//   --format auto picks BC1 for opaque images and BC3 when they carry alpha
+//   --linear filters mips on the raw values instead of decoding sRGB first (for normal maps and other data)
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../headers/stb_image.h"
+#include "../headers/MipGenerator.h"
+#include "../headers/TexturePack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static bool isImage(const fs::path& path)
+{
+	std::string ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga";
+}
+
+int main(int argc, char** argv)
+{
+	std::string inputDir = "rsc/imgs";
+	std::string outputPath = "rsc/textures.pack";
+	std::string formatName = "raw";
+	BCQuality quality = BC_QUALITY_NORMAL;
+	MipOptions mipOptions;
+	mipOptions.filter = MIP_FILTER_KAISER;
+
+	int positional = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+			formatName = argv[++i];
+		else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+			std::string q = argv[++i];
+			quality = q == "fast" ? BC_QUALITY_FAST : (q == "high" ? BC_QUALITY_HIGH : BC_QUALITY_NORMAL);
+		}
+		else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			std::string f = argv[++i];
+			mipOptions.filter = f == "box" ? MIP_FILTER_BOX : (f == "lanczos" ? MIP_FILTER_LANCZOS : MIP_FILTER_KAISER);
+		}
+		else if (strcmp(argv[i], "--linear") == 0)
+			mipOptions.srgb = false;
+		else if (positional == 0) {
+			inputDir = argv[i];
+			positional++;
+		}
+		else
+			outputPath = argv[i];
+	}
+	if (formatName != "raw" && formatName != "auto" && formatName != "bc1" && formatName != "bc3" && formatName != "bc7") {
+		std::cout << "Unknown format: " << formatName << std::endl;
+		return 1;
+	}
+
+	if (!fs::is_directory(inputDir)) {
+		std::cout << "Input directory not found: " << inputDir << std::endl;
+		return 1;
+	}
+
+	// Sort so the pack is byte-identical between runs
+	std::vector<fs::path> images;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(inputDir)) {
+		if (entry.is_regular_file() && isImage(entry.path()))
+			images.push_back(entry.path());
+	}
+	std::sort(images.begin(), images.end());
+
+	TexturePackWriter writer;
+	if (!writer.open(outputPath.c_str())) {
+		std::cout << "Failed to open output: " << outputPath << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	stbi_set_flip_vertically_on_load(true);	// Match the orientation createTexture uploads with
+	int cooked = 0;
+	for (const fs::path& path : images) {
+		// Key textures by the same path the renderer passes to createTexture
+		std::string name = (fs::path(inputDir) / fs::relative(path, inputDir)).generic_string();
+
+		int width, height, channels;
+		unsigned char* data = stbi_load(path.string().c_str(), &width, &height, &channels, 0);
+		if (!data) {
+			std::cout << "Skipping " << name << ": " << stbi_failure_reason() << std::endl;
+			continue;
+		}
+
+		std::vector<MipLevel> chain = generateMipChain(data, width, height, channels, TEXPACK_MAX_MIPS, mipOptions);
+		stbi_image_free(data);
+
+		BCFormat format = BC_NONE;
+		if (formatName == "auto")
+			format = bcDefaultFormat(channels);
+		else if (formatName != "raw")
+			format = formatName == "bc1" ? BC1 : (formatName == "bc3" ? BC3 : BC7);
+
+		std::vector<std::vector<unsigned char>> levels;
+		for (MipLevel& mip : chain) {
+			if (format == BC_NONE) {
+				levels.push_back(std::move(mip.pixels));
+				continue;
+			}
+			levels.emplace_back(bcCompressedSize(format, mip.width, mip.height));
+			bcCompress(mip.pixels.data(), mip.width, mip.height, channels, format, quality, levels.back().data());
+		}
+
+		if (!writer.add(name.c_str(), width, height, channels, format, levels)) {
+			std::cout << "Skipping " << name << ": name too long or too many mips" << std::endl;
+			continue;
+		}
+		std::cout << name << " " << width << "x" << height << "x" << channels << ", " << levels.size() << " mips";
+		if (format != BC_NONE)
+			std::cout << ", BC" << (int)format;
+		std::cout << std::endl;
+		cooked++;
+	}
+
+	if (!writer.finish()) {
+		std::cout << "Failed to write " << outputPath << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Cooked " << cooked << " textures into " << outputPath << " (" << writer.bytesWritten() << " bytes) in " << seconds << " s" << std::endl;
+	return 0;
+}